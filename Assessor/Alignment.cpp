@@ -0,0 +1,111 @@
+#include "Alignment.h"
+
+namespace
+{
+
+bool fromSource(WordAction action)
+{
+    return action == WordAction::KEPT
+            || action == WordAction::INSERTED
+            || action == WordAction::SKIP_SOURCE
+            || action == WordAction::MOVED;
+}
+
+} //! end anonymous namespace
+
+Alignment::Alignment(const QString& source, const QString& input,
+                     std::vector<Token> sourceTokens,
+                     std::vector<Token> inputTokens,
+                     std::vector<Run> runs)
+    : source(source)
+    , input(input)
+    , sourceTokens(std::move(sourceTokens))
+    , inputTokens(std::move(inputTokens))
+    , runs(std::move(runs))
+{
+}
+
+QStringRef Alignment::getText(const Run& run) const
+{
+    if (run.length == 0)
+    {
+        return QStringRef();
+    }
+
+    bool side = fromSource(run.action);
+
+    const auto& tokens = side ? sourceTokens : inputTokens;
+    int first = side ? run.sourceOffset : run.inputOffset;
+
+    const Token& head = tokens[first];
+    const Token& tail = tokens[first + run.length - 1];
+
+    return (side ? source : input)
+            .midRef(head.offset, tail.offset + tail.length - head.offset);
+}
+
+int Alignment::countWords(WordAction action) const
+{
+    int count = 0;
+
+    for (const Run& run : runs)
+    {
+        if (run.action != action)
+        {
+            continue;
+        }
+
+        bool side = fromSource(run.action);
+
+        const auto& tokens = side ? sourceTokens : inputTokens;
+        int first = side ? run.sourceOffset : run.inputOffset;
+
+        for (int i = first; i < first + run.length; ++i)
+        {
+            count += tokens[i].skippable ? 0 : 1;
+        }
+    }
+
+    return count;
+}
+
+void Alignment::visit(
+        const std::function<void(WordAction, const QStringRef&)>& visitor) const
+{
+    static const QString space(" ");
+
+    bool afterWord = false;
+
+    for (const Run& run : runs)
+    {
+        if (run.action == WordAction::SKIP_INPUT || run.length == 0)
+        {
+            continue;
+        }
+
+        bool side = fromSource(run.action);
+
+        const auto& tokens = side ? sourceTokens : inputTokens;
+        int first = side ? run.sourceOffset : run.inputOffset;
+
+        if (afterWord && !tokens[first].skippable)
+        {
+            visitor(WordAction::SKIP_SOURCE, QStringRef(&space));
+        }
+
+        visitor(run.action, getText(run));
+
+        afterWord = !tokens[first + run.length - 1].skippable;
+    }
+}
+
+QString Alignment::toPlainText() const
+{
+    QString text;
+
+    text.reserve(source.size() + input.size());
+
+    visit([&](WordAction, const QStringRef& piece) { text.append(piece); });
+
+    return text;
+}
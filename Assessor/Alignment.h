@@ -0,0 +1,90 @@
+#ifndef ALIGNMENT_H
+#define ALIGNMENT_H
+
+#include <functional>
+#include <vector>
+
+#include <QString>
+#include <QStringRef>
+
+#include "Tokenizer.h"
+#include "WordAction.h"
+
+// 连续若干个动作相同的词
+struct Run
+{
+    WordAction action;
+    // 原文和输入中第一个词的序号
+    int sourceOffset;
+    int inputOffset;
+    // 词数
+    int length;
+};
+
+// 对齐结果。 只保存分段和词的位置， 文字都指回原文和输入
+class Alignment
+{
+public:
+    Alignment() = default;
+
+    Alignment(const QString& source, const QString& input,
+              std::vector<Token> sourceTokens,
+              std::vector<Token> inputTokens,
+              std::vector<Run> runs);
+
+    const std::vector<Run>& getRuns() const
+    {
+        return runs;
+    }
+
+    std::vector<Run>::const_iterator begin() const
+    {
+        return runs.cbegin();
+    }
+
+    std::vector<Run>::const_iterator end() const
+    {
+        return runs.cend();
+    }
+
+    const QString& getSource() const
+    {
+        return source;
+    }
+
+    const QString& getInput() const
+    {
+        return input;
+    }
+
+    const std::vector<Token>& getSourceTokens() const
+    {
+        return sourceTokens;
+    }
+
+    const std::vector<Token>& getInputTokens() const
+    {
+        return inputTokens;
+    }
+
+    // 这一段在原文 (KEPT, INSERTED, SKIP_SOURCE, MOVED) 或输入中对应的文字
+    QStringRef getText(const Run& run) const;
+
+    // 某种动作涉及的单词数， 不算分隔符
+    int countWords(WordAction action) const;
+
+    // 按显示顺序给出每一段文字： 输入里的分隔符不显示，
+    // 两个单词之间缺了分隔符时补一个空格 (动作记为 SKIP_SOURCE)
+    void visit(const std::function<void(WordAction, const QStringRef&)>& visitor) const;
+
+    QString toPlainText() const;
+
+private:
+    QString source;
+    QString input;
+    std::vector<Token> sourceTokens;
+    std::vector<Token> inputTokens;
+    std::vector<Run> runs;
+};
+
+#endif // ALIGNMENT_H
@@ -1,178 +1,930 @@
-#include <map>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <set>
+#include <thread>
+#include <unordered_map>
 #include <vector>
-#include <list>
-#include <QRegularExpression>
-#include "Word.h"
 #include "Assessor.h"
 
-using Index = int;
-
-struct Coordinate
+namespace
 {
-    Index answerIndex;
-    Index inputIndex;
-};
 
-bool operator < (const Coordinate& lhs, const Coordinate& rhs)
-{
-    return std::tie(lhs.answerIndex, lhs.inputIndex)
-            < std::tie(rhs.answerIndex, rhs.inputIndex);
-}
+using Index = int;
 
 using Expense = int;
 
-struct Node
+const Expense SKIP_SOURCE_EXPENSE = 0;
+const Expense SKIP_INPUT_EXPENSE = 0;
+const Expense KEEP_EXPENSE = 0;
+const Expense REMOVE_EXPENSE = 1;
+const Expense INSERT_EXPENSE = 1;
+
+// 假定的每核 L2 大小， 用来决定 tile 的边长
+const int L2_CACHE_BYTES = 256 * 1024;
+
+// tile 内的动作表 (每格一个字节) 加两行滚动的代价要能放进半个 L2
+constexpr int tileSize()
 {
-    Coordinate next;
-    Expense expense;
-    WordAction action;
-};
+    int size = 16;
 
-using Memo = std::map<Coordinate, Node>;
+    while ((2 * size) * (2 * size) * int(sizeof(WordAction))
+           + 2 * (2 * size + 1) * int(sizeof(Expense)) <= L2_CACHE_BYTES / 2)
+    {
+        size *= 2;
+    }
 
-Expense SKIP_SOURCE_EXPENSE = 0;
-Expense SKIP_INPUT_EXPENSE = 0;
-Expense KEEP_EXPENSE = 0;
-Expense REMOVE_EXPENSE = 1;
-Expense INSERT_EXPENSE = 1;
+    return size;
+}
+
+const int TILE_SIZE = tileSize();
+
+// 格子数少于这个值时单线程更快
+const long long PARALLEL_THRESHOLD = 1LL << 20;
 
-int search(const std::vector<QString>* sourceWords,
-           const std::vector<QString>* inputWords,
-           Index sourceIndex, Index inputIndex,
-           Memo* memo)
+// 到了 barrier 的线程等所有人都到了再一起往下走
+class Barrier
 {
-    if (sourceIndex >= (int)sourceWords->size())
+public:
+    explicit Barrier(int count)
+        : count(count)
+        , waiting(0)
+        , generation(0)
     {
-        return (inputWords->size() - inputIndex) * REMOVE_EXPENSE;
     }
-    else if (inputIndex >= (int)inputWords->size())
+
+    void wait()
     {
-        return (sourceWords->size() - sourceIndex) * INSERT_EXPENSE;
+        std::unique_lock<std::mutex> lock(mutex);
+
+        int current = generation;
+
+        if (++waiting == count)
+        {
+            waiting = 0;
+            ++generation;
+            condition.notify_all();
+        }
+        else
+        {
+            condition.wait(lock, [&] { return generation != current; });
+        }
     }
-    else
+
+private:
+    std::mutex mutex;
+    std::condition_variable condition;
+    int count;
+    int waiting;
+    int generation;
+};
+
+// 自底向上的编辑距离表， 按 tile 沿反对角线推进。
+// expense(s, i) 表示从 (s, i) 走到终点的最小代价， 依赖右、下、右下三格，
+// 所以同一条反对角线上的 tile 互不依赖， 可以交给不同线程。
+// 每个 tile 只读写自己所在行带和列带的边界， 结果与单线程逐格计算完全一致。
+class Aligner
+{
+public:
+    Aligner(const std::vector<Token>* source, const std::vector<Token>* input,
+            Monitor* monitor)
+        : monitor(monitor)
+        , source(source->data())
+        , input(input->data())
+        , rows(source->size())
+        , columns(input->size())
+        , rowTiles((rows + TILE_SIZE - 1) / TILE_SIZE)
+        , columnTiles((columns + TILE_SIZE - 1) / TILE_SIZE)
+        , actions(size_t(rows) * columns)
+        , verticals(rowTiles)
+        , horizontals(columnTiles)
     {
-        auto iter = memo->find({ sourceIndex, inputIndex });
+        // 最下面一行： 原文用完了， 剩下的输入都是多余的
+        for (int tj = 0; tj < columnTiles; ++tj)
+        {
+            Index first = tj * TILE_SIZE;
+            Index last = std::min(first + TILE_SIZE, columns);
 
-        if (iter == memo->end())
+            for (Index i = first; i <= last; ++i)
+            {
+                horizontals[tj].push_back((columns - i) * REMOVE_EXPENSE);
+            }
+        }
+
+        // 最右边一列： 输入用完了， 剩下的原文都是遗漏的
+        for (int ti = 0; ti < rowTiles; ++ti)
         {
-            const auto& source = sourceWords->at(sourceIndex);
-            const auto& input = inputWords->at(inputIndex);
+            Index first = ti * TILE_SIZE;
+            Index last = std::min(first + TILE_SIZE, rows);
 
-            auto searchNext = [&](Index nextSourceIndex, Index nextInputIndex)
+            for (Index s = first; s <= last; ++s)
             {
-                return search(sourceWords, inputWords,
-                              nextSourceIndex, nextInputIndex, memo);
-            };
+                verticals[ti].push_back((rows - s) * INSERT_EXPENSE);
+            }
+        }
+    }
+
+    void run()
+    {
+        if (rows == 0 || columns == 0)
+        {
+            return;
+        }
 
-            Node node {};
+        int diagonals = rowTiles + columnTiles - 1;
+        int workers = 1;
 
-            if (input == source)
+        if ((long long)rows * columns >= PARALLEL_THRESHOLD)
+        {
+            int cores = std::max(1u, std::thread::hardware_concurrency());
+            workers = std::min(cores, std::min(rowTiles, columnTiles));
+        }
+
+        if (workers <= 1)
+        {
+            for (int d = 0; d < diagonals; ++d)
             {
-                Expense kept = KEEP_EXPENSE +
-                        searchNext(sourceIndex + 1, inputIndex + 1);
+                for (int k = first(d); k <= last(d); ++k)
+                {
+                    computeDiagonalTile(d, k);
+                }
 
-                node = Node { { sourceIndex + 1, inputIndex + 1 },
-                        kept, WordAction::KEPT };
+                report(d + 1, diagonals);
             }
-            else
+
+            return;
+        }
+
+        std::unique_ptr<std::atomic<int>[]> cursors(
+                    new std::atomic<int>[diagonals]());
+
+        Barrier barrier(workers);
+
+        auto caller = std::this_thread::get_id();
+
+        auto work = [&]()
+        {
+            for (int d = 0; d < diagonals; ++d)
             {
-                if (!source.at(0).isLetterOrNumber())
+                int k = 0;
+
+                while ((k = first(d) + cursors[d].fetch_add(1)) <= last(d))
                 {
-                    node = Node { { sourceIndex + 1, inputIndex },
-                            SKIP_SOURCE_EXPENSE, WordAction::SKIP_SOURCE };
+                    computeDiagonalTile(d, k);
                 }
-                else if (!input.at(0).isLetterOrNumber())
+
+                barrier.wait();
+
+                if (std::this_thread::get_id() == caller)
                 {
-                    node = Node { { sourceIndex, inputIndex + 1 },
-                            SKIP_INPUT_EXPENSE, WordAction::SKIP_INPUT };
+                    report(d + 1, diagonals);
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+
+        for (int t = 1; t < workers; ++t)
+        {
+            threads.emplace_back(work);
+        }
+
+        work();
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    WordAction action(Index s, Index i) const
+    {
+        return actions[size_t(s) * columns + i];
+    }
+
+private:
+    // 第 d 条反对角线上， 从右下角数起的行 tile 序号范围
+    int first(int d) const
+    {
+        return std::max(0, d - (columnTiles - 1));
+    }
+
+    int last(int d) const
+    {
+        return std::min(d, rowTiles - 1);
+    }
+
+    bool cancelled() const
+    {
+        return monitor && monitor->cancelled.load(std::memory_order_relaxed);
+    }
+
+    void report(int done, int total) const
+    {
+        if (monitor && monitor->report)
+        {
+            monitor->report(done, total);
+        }
+    }
+
+    void computeDiagonalTile(int d, int k)
+    {
+        // 取消之后剩下的 tile 直接跳过， 结果不再使用
+        if (cancelled())
+        {
+            return;
+        }
+
+        int ti = rowTiles - 1 - k;
+        int tj = columnTiles - 1 - (d - k);
+
+        computeTile(ti, tj);
+    }
+
+    void computeTile(int ti, int tj)
+    {
+        Index top = ti * TILE_SIZE;
+        Index bottom = std::min(top + TILE_SIZE, rows);
+        Index left = tj * TILE_SIZE;
+        Index right = std::min(left + TILE_SIZE, columns);
+
+        int width = right - left;
+
+        // 右边 tile 的最左列， 下边 tile 的最上行
+        std::vector<Expense>& vertical = verticals[ti];
+        std::vector<Expense>& horizontal = horizontals[tj];
+
+        std::vector<Expense> below(horizontal);
+        std::vector<Expense> current(width + 1);
+        std::vector<Expense> leftColumn(bottom - top + 1);
+
+        leftColumn[bottom - top] = below[0];
+
+        for (Index s = bottom - 1; s >= top; --s)
+        {
+            current[width] = vertical[s - top];
+
+            WordAction* row = &actions[size_t(s) * columns];
+
+            for (Index i = right - 1; i >= left; --i)
+            {
+                int c = i - left;
+
+                Expense expense = 0;
+                WordAction action = WordAction::KEPT;
+
+                if (source[s].id == input[i].id)
+                {
+                    expense = KEEP_EXPENSE + below[c + 1];
+                    action = WordAction::KEPT;
+                }
+                else if (source[s].skippable)
+                {
+                    expense = SKIP_SOURCE_EXPENSE + below[c];
+                    action = WordAction::SKIP_SOURCE;
+                }
+                else if (input[i].skippable)
+                {
+                    expense = SKIP_INPUT_EXPENSE + current[c + 1];
+                    action = WordAction::SKIP_INPUT;
                 }
                 else
                 {
-                    Expense removed = REMOVE_EXPENSE +
-                            searchNext(sourceIndex, inputIndex + 1);
-
-                    Expense inserted = INSERT_EXPENSE
-                            + searchNext(sourceIndex + 1, inputIndex);
+                    Expense removed = REMOVE_EXPENSE + current[c + 1];
+                    Expense inserted = INSERT_EXPENSE + below[c];
 
                     if (removed <= inserted)
                     {
-                        node = Node { { sourceIndex, inputIndex + 1 },
-                                removed, WordAction::REMOVED };
+                        expense = removed;
+                        action = WordAction::REMOVED;
                     }
                     else
                     {
-                        node = Node { { sourceIndex + 1, inputIndex },
-                                inserted, WordAction::INSERTED };
+                        expense = inserted;
+                        action = WordAction::INSERTED;
                     }
                 }
+
+                current[c] = expense;
+                row[i] = action;
             }
 
-            memo->insert({ { sourceIndex, inputIndex }, node });
+            leftColumn[s - top] = current[0];
 
-            return node.expense;
+            std::swap(below, current);
         }
-        else
+
+        horizontal.swap(below);
+        vertical.swap(leftColumn);
+    }
+
+private:
+    Monitor* monitor;
+    const Token* source;
+    const Token* input;
+    Index rows;
+    Index columns;
+    int rowTiles;
+    int columnTiles;
+    std::vector<WordAction> actions;
+    std::vector<std::vector<Expense>> verticals;
+    std::vector<std::vector<Expense>> horizontals;
+};
+
+// 编辑路线上的一步
+struct Step
+{
+    WordAction action;
+    Index s;
+    Index i;
+};
+
+// 两个词以上的块不论挪了多远都算移动
+const int MIN_BLOCK = 2;
+
+// 单个词只有在这么多个词以内找到才算移动， 否则多半是碰巧相同的常用词
+const int LOCAL_SHIFT = 3;
+
+// 同一个词对在输入中最多看这么多处， 保证总代价接近线性
+const size_t MAX_CANDIDATES = 16;
+
+// 两串词中任意两处开始的最长相同长度。 把两串用分隔符接起来建后缀数组，
+// 相邻后缀的公共长度 (LCP) 上建稀疏表， 每次查询 O(1)
+class CommonPrefix
+{
+public:
+    CommonPrefix(const std::vector<int>& first, const std::vector<int>& second)
+        : offset(first.size() + 1)
+    {
+        // 分隔符只出现一次， 公共部分不会跨过它
+        std::vector<int> text(first);
+
+        text.push_back(-1);
+        text.insert(text.end(), second.begin(), second.end());
+
+        int n = static_cast<int>(text.size());
+
+        std::vector<int> order(n);
+        std::vector<int> next(n);
+
+        std::iota(order.begin(), order.end(), 0);
+        rank = text;
+
+        // 倍增: 每轮按前 2k 个词排序
+        for (int k = 1; ; k *= 2)
         {
-            return iter->second.expense;
+            auto following = [&](int i)
+            {
+                return i + k < n ? rank[i + k]
+                                 : std::numeric_limits<int>::min();
+            };
+
+            auto less = [&](int lhs, int rhs)
+            {
+                return rank[lhs] != rank[rhs] ? rank[lhs] < rank[rhs]
+                                              : following(lhs) < following(rhs);
+            };
+
+            std::sort(order.begin(), order.end(), less);
+
+            next[order[0]] = 0;
+
+            for (int r = 1; r < n; ++r)
+            {
+                next[order[r]] = next[order[r - 1]]
+                        + (less(order[r - 1], order[r]) ? 1 : 0);
+            }
+
+            rank.swap(next);
+
+            if (rank[order[n - 1]] == n - 1)
+            {
+                break;
+            }
+        }
+
+        // Kasai: lcp[r] 是排在第 r - 1 和第 r 的两个后缀的公共长度
+        std::vector<int> lcp(n, 0);
+
+        for (int i = 0, h = 0; i < n; ++i)
+        {
+            if (rank[i] == 0)
+            {
+                h = 0;
+                continue;
+            }
+
+            int j = order[rank[i] - 1];
+
+            while (i + h < n && j + h < n && text[i + h] == text[j + h])
+            {
+                ++h;
+            }
+
+            lcp[rank[i]] = h;
+            h = h > 0 ? h - 1 : 0;
+        }
+
+        table.push_back(std::move(lcp));
+
+        for (int width = 1; 2 * width <= n; width *= 2)
+        {
+            const std::vector<int>& previous = table.back();
+            std::vector<int> level(n - 2 * width + 1);
+
+            for (size_t r = 0; r < level.size(); ++r)
+            {
+                level[r] = std::min(previous[r], previous[r + width]);
+            }
+
+            table.push_back(std::move(level));
         }
     }
-}
 
-// 把 memo 中的路线提取出来
-using Path = std::shared_ptr<std::list<Word>>;
+    // first 从 a 开始、 second 从 b 开始的最长相同长度
+    size_t length(size_t a, size_t b) const
+    {
+        int lhs = rank[a];
+        int rhs = rank[offset + b];
+
+        int low = std::min(lhs, rhs) + 1;
+        int high = std::max(lhs, rhs) + 1;
+
+        int level = 0;
 
-Path search(const QString* source, const QString* input)
+        while ((2 << level) <= high - low)
+        {
+            ++level;
+        }
+
+        return static_cast<size_t>(
+                    std::min(table[level][low],
+                             table[level][high - (1 << level)]));
+    }
+
+private:
+    size_t offset;
+    // 每个后缀排第几
+    std::vector<int> rank;
+    // table[k][r] 是 lcp[r, r + 2^k) 的最小值
+    std::vector<std::vector<int>> table;
+};
+
+// 找出遗漏的词 (INSERTED) 和多余的词 (REMOVED) 中相同的词块，
+// 原文一侧改为 MOVED， 输入一侧改为 SKIP_INPUT。
+// 用相邻两个词的编号作种子查哈希表， 延伸的长度由后缀数组直接查出， 最长的块先认领
+class MoveDetector
 {
-    const auto& ss = source->split(QRegExp("\\b"));
-    const auto& is = input->split(QRegExp("\\b"));
+public:
+    MoveDetector(const std::vector<Token>& source,
+                 const std::vector<Token>& input,
+                 std::vector<Step>* steps)
+        : steps(*steps)
+    {
+        // 每个 token 前面有几个单词， 相差 1 说明中间只隔着分隔符
+        std::vector<Index> sourceOrdinals = ordinals(source);
+        std::vector<Index> inputOrdinals = ordinals(input);
 
-    std::vector<QString> sourceWords(ss.cend(), ss.cend());
-    std::vector<QString> inputWords(is.cbegin(), is.cend());
+        // 路线上的单词步数， 用来衡量单个词挪了多远
+        int order = 0;
 
-    Memo memo;
+        for (size_t k = 0; k < this->steps.size(); ++k)
+        {
+            const Step& step = this->steps[k];
 
-    ::search(&sourceWords, &inputWords, 0, 0, &memo);
+            // 结尾整段补上的遗漏和多余也包括分隔符， 只看单词
+            if (step.action == WordAction::INSERTED
+                    && !source[step.s].skippable)
+            {
+                collect(&missing, k, source[step.s].id,
+                        sourceOrdinals[step.s], order);
+            }
+            else if (step.action == WordAction::REMOVED
+                     && !input[step.i].skippable)
+            {
+                collect(&extra, k, input[step.i].id,
+                        inputOrdinals[step.i], order);
+            }
+
+            if (step.action == WordAction::KEPT
+                    || step.action == WordAction::INSERTED
+                    || step.action == WordAction::REMOVED)
+            {
+                ++order;
+            }
+        }
+    }
 
-    auto result = std::make_shared<std::list<Word>>();
+    void run()
+    {
+        if (missing.empty() || extra.empty())
+        {
+            return;
+        }
 
-    auto iter = memo.end();
+        matchBlocks();
+        matchWords();
+    }
 
-    Coordinate current { 0, 0 };
+private:
+    struct Word
+    {
+        size_t step;
+        int id;
+        // 在同侧的单词序号
+        Index ordinal;
+        int order;
+        // 与前一个词在文本中相邻
+        bool joined;
+        bool matched;
+    };
 
-    while ((iter = memo.find(current)) != memo.end())
+    struct Block
     {
-        auto action = iter->second.action;
+        size_t missing;
+        size_t extra;
+        size_t length;
+    };
 
-        if (action == WordAction::KEPT
-                || action == WordAction::INSERTED
-                || action == WordAction::SKIP_SOURCE)
+    static std::vector<Index> ordinals(const std::vector<Token>& tokens)
+    {
+        std::vector<Index> result(tokens.size());
+
+        Index count = 0;
+
+        for (size_t t = 0; t < tokens.size(); ++t)
         {
-            result->push_back(Word(source->at(current.answerIndex), action));
+            result[t] = count;
+            count += tokens[t].skippable ? 0 : 1;
         }
-        else
+
+        return result;
+    }
+
+    static void collect(std::vector<Word>* words, size_t step, int id,
+                        Index ordinal, int order)
+    {
+        bool joined = !words->empty()
+                && words->back().ordinal + 1 == ordinal;
+
+        words->push_back(Word { step, id, ordinal, order, joined, false });
+    }
+
+    static quint64 pairKey(int first, int second)
+    {
+        return (quint64(quint32(first)) << 32) | quint32(second);
+    }
+
+    bool same(size_t m, size_t e) const
+    {
+        return missing[m].id == extra[e].id;
+    }
+
+    void matchBlocks()
+    {
+        std::unordered_map<quint64, std::vector<size_t>> seeds;
+
+        for (size_t e = 0; e + 1 < extra.size(); ++e)
+        {
+            if (extra[e + 1].joined)
+            {
+                auto& list = seeds[pairKey(extra[e].id, extra[e + 1].id)];
+
+                if (list.size() < MAX_CANDIDATES)
+                {
+                    list.push_back(e);
+                }
+            }
+        }
+
+        CommonPrefix prefix(ids(missing), ids(extra));
+
+        std::vector<size_t> missingEnds = runEnds(missing);
+        std::vector<size_t> extraEnds = runEnds(extra);
+
+        std::vector<Block> blocks;
+
+        for (size_t m = 0; m + 1 < missing.size(); ++m)
+        {
+            if (!missing[m + 1].joined)
+            {
+                continue;
+            }
+
+            auto it = seeds.find(pairKey(missing[m].id, missing[m + 1].id));
+
+            if (it == seeds.end())
+            {
+                continue;
+            }
+
+            for (size_t e : it->second)
+            {
+                // 能往前延伸的话， 这条对角线由更早的种子负责
+                if (m > 0 && e > 0 && missing[m].joined && extra[e].joined
+                        && same(m - 1, e - 1))
+                {
+                    continue;
+                }
+
+                // 块不跨过文本中不相邻的地方
+                size_t length = std::min(prefix.length(m, e),
+                                         std::min(missingEnds[m] - m,
+                                                  extraEnds[e] - e));
+
+                if (length >= size_t(MIN_BLOCK))
+                {
+                    blocks.push_back(Block { m, e, length });
+                }
+            }
+        }
+
+        std::stable_sort(blocks.begin(), blocks.end(),
+                         [](const Block& lhs, const Block& rhs)
+        {
+            return lhs.length > rhs.length;
+        });
+
+        // 已认领的位置， 查一段里有没有被占用的只要一次查找
+        std::set<size_t> missingTaken;
+        std::set<size_t> extraTaken;
+
+        for (const Block& block : blocks)
+        {
+            if (overlaps(missingTaken, block.missing, block.length)
+                    || overlaps(extraTaken, block.extra, block.length))
+            {
+                continue;
+            }
+
+            for (size_t k = 0; k < block.length; ++k)
+            {
+                link(block.missing + k, block.extra + k);
+
+                missingTaken.insert(block.missing + k);
+                extraTaken.insert(block.extra + k);
+            }
+        }
+    }
+
+    static std::vector<int> ids(const std::vector<Word>& words)
+    {
+        std::vector<int> result(words.size());
+
+        for (size_t k = 0; k < words.size(); ++k)
+        {
+            result[k] = words[k].id;
+        }
+
+        return result;
+    }
+
+    // 每个词所在的相邻段的结尾
+    static std::vector<size_t> runEnds(const std::vector<Word>& words)
+    {
+        std::vector<size_t> result(words.size());
+
+        for (size_t k = words.size(); k-- > 0; )
+        {
+            result[k] = k + 1 < words.size() && words[k + 1].joined
+                    ? result[k + 1] : k + 1;
+        }
+
+        return result;
+    }
+
+    static bool overlaps(const std::set<size_t>& taken, size_t begin,
+                         size_t length)
+    {
+        auto it = taken.lower_bound(begin);
+
+        return it != taken.end() && *it < begin + length;
+    }
+
+    void matchWords()
+    {
+        // 每个词在多余的词中出现的位置， 按路线顺序
+        std::unordered_map<int, std::vector<size_t>> positions;
+
+        for (size_t e = 0; e < extra.size(); ++e)
         {
-            result->push_back(Word(input->at(current.inputIndex), action));
+            if (!extra[e].matched)
+            {
+                positions[extra[e].id].push_back(e);
+            }
         }
 
-        current = iter->second.next;
+        for (size_t m = 0; m < missing.size(); ++m)
+        {
+            if (missing[m].matched)
+            {
+                continue;
+            }
+
+            auto it = positions.find(missing[m].id);
+
+            if (it == positions.end())
+            {
+                continue;
+            }
+
+            int order = missing[m].order;
+
+            auto candidate = std::lower_bound(
+                        it->second.begin(), it->second.end(),
+                        order - LOCAL_SHIFT, [this](size_t e, int bound)
+            {
+                return extra[e].order < bound;
+            });
+
+            // 范围内最近的一个
+            size_t best = extra.size();
+            int distance = LOCAL_SHIFT + 1;
+
+            for (; candidate != it->second.end()
+                 && extra[*candidate].order <= order + LOCAL_SHIFT; ++candidate)
+            {
+                int d = std::abs(extra[*candidate].order - order);
+
+                if (!extra[*candidate].matched && d < distance)
+                {
+                    best = *candidate;
+                    distance = d;
+                }
+            }
+
+            if (best < extra.size())
+            {
+                link(m, best);
+            }
+        }
     }
 
-    if (current.answerIndex >= source->size())
+    void link(size_t m, size_t e)
+    {
+        missing[m].matched = true;
+        extra[e].matched = true;
+
+        steps[missing[m].step].action = WordAction::MOVED;
+        steps[extra[e].step].action = WordAction::SKIP_INPUT;
+    }
+
+private:
+    std::vector<Step>& steps;
+    std::vector<Word> missing;
+    std::vector<Word> extra;
+};
+
+// 对齐规则改动时加一
+const quint32 ALGORITHM_VERSION = 1;
+
+constexpr quint32 fingerprint(std::initializer_list<long long> values)
+{
+    // FNV-1a
+    quint32 h = 2166136261u;
+
+    for (long long value : values)
     {
-        for (int i = current.inputIndex, bound = input->size();
-             i < bound; ++i)
+        h ^= static_cast<quint32>(value);
+        h *= 16777619u;
+    }
+
+    return h;
+}
+
+// 对齐规则的指纹， 改了代价或阈值以后缓存的旧结果不再命中
+constexpr quint32 SETTINGS = fingerprint({
+    ALGORITHM_VERSION,
+    SKIP_SOURCE_EXPENSE, SKIP_INPUT_EXPENSE, KEEP_EXPENSE,
+    REMOVE_EXPENSE, INSERT_EXPENSE,
+    MIN_BLOCK, LOCAL_SHIFT, static_cast<long long>(MAX_CANDIDATES)
+});
+
+} //! end anonymous namespace
+
+std::shared_ptr<const Answer> prepare(const QString& text)
+{
+    auto answer = std::make_shared<Answer>();
+
+    answer->text = text;
+    answer->tokens = tokenize(answer->text, &answer->lexicon);
+
+    return answer;
+}
+
+Alignment assess(const QString* source, const QString* input,
+                 Monitor* monitor)
+{
+    return assess(*prepare(*source), input, monitor);
+}
+
+Alignment assess(const Answer& answer, const QString* input,
+                 Monitor* monitor, ResultCache* cache)
+{
+    // 复制的 lexicon 仍然指向 answer.text， 输入的词接着往后编号
+    Lexicon lexicon = answer.lexicon;
+
+    std::vector<Token> sourceTokens = answer.tokens;
+    std::vector<Token> inputTokens = tokenize(*input, &lexicon);
+
+    ResultCache::Key key;
+
+    if (cache)
+    {
+        key = ResultCache::key(sourceTokens, inputTokens, SETTINGS);
+
+        std::vector<Run> runs;
+
+        if (cache->find(key, static_cast<int>(sourceTokens.size()),
+                        static_cast<int>(inputTokens.size()), &runs))
+        {
+            return Alignment(answer.text, *input, std::move(sourceTokens),
+                             std::move(inputTokens), std::move(runs));
+        }
+    }
+
+    Aligner aligner(&sourceTokens, &inputTokens, monitor);
+
+    aligner.run();
+
+    if (monitor && monitor->cancelled)
+    {
+        return Alignment();
+    }
+
+    // 把动作表中的路线提取出来， 相同动作的连续词合成一段
+    std::vector<Step> steps;
+
+    Index sourceSize = sourceTokens.size();
+    Index inputSize = inputTokens.size();
+
+    Index s = 0;
+    Index i = 0;
+
+    while (s < sourceSize && i < inputSize)
+    {
+        auto action = aligner.action(s, i);
+
+        steps.push_back(Step { action, s, i });
+
+        switch (action)
         {
-            result->push_back(Word(input->at(i), WordAction::REMOVED));
+            case WordAction::KEPT:
+                ++s;
+                ++i;
+                break;
+
+            case WordAction::INSERTED:
+            case WordAction::SKIP_SOURCE:
+            case WordAction::MOVED:
+                ++s;
+                break;
+
+            case WordAction::REMOVED:
+            case WordAction::SKIP_INPUT:
+                ++i;
+                break;
         }
     }
-    else if (current.inputIndex >= input->size())
+
+    for (; i < inputSize; ++i)
+    {
+        steps.push_back(Step { WordAction::REMOVED, s, i });
+    }
+
+    for (; s < sourceSize; ++s)
+    {
+        steps.push_back(Step { WordAction::INSERTED, s, i });
+    }
+
+    // 遗漏和多余的词里相同的块是被挪了位置
+    MoveDetector(sourceTokens, inputTokens, &steps).run();
+
+    std::vector<Run> runs;
+
+    for (const Step& step : steps)
     {
-        for (int i = current.answerIndex, bound = source->size();
-             i < bound; ++i)
+        if (!runs.empty() && runs.back().action == step.action)
         {
-            result->push_back(Word(source->at(i), WordAction::INSERTED));
+            ++runs.back().length;
         }
+        else
+        {
+            runs.push_back(Run { step.action, step.s, step.i, 1 });
+        }
+    }
+
+    if (cache)
+    {
+        cache->insert(key, runs);
     }
 
-    return result;
+    return Alignment(answer.text, *input, std::move(sourceTokens),
+                     std::move(inputTokens), std::move(runs));
 }
@@ -1,14 +1,42 @@
 #ifndef ASSESSOR_H
 #define ASSESSOR_H
 
+#include <atomic>
+#include <functional>
 #include <memory>
 
-class QString;
-class Word;
+#include "Alignment.h"
+#include "ResultCache.h"
 
-using Path = std::shared_ptr<std::list<Word>>;
+// 长时间对齐的取消标志和进度回调。 cancelled 可以在任意线程里设置
+struct Monitor
+{
+    std::atomic<bool> cancelled { false };
 
-Path assess(const QString* source, const QString* input);
+    // 参数是已完成的和总共的步数， 在计算线程中调用
+    std::function<void(int, int)> report;
+};
+
+// 预先分好词的原文， 可以在多次评估之间共享。
+// lexicon 的键指向 text， 两者要一起保存
+struct Answer
+{
+    QString text;
+    Lexicon lexicon;
+    std::vector<Token> tokens;
+};
+
+std::shared_ptr<const Answer> prepare(const QString& text);
+
+// 对比原文与用户输入， 返回按动作分段的编辑路线。
+// 规模较大时沿反对角线把 tile 分给多个线程， 结果与单线程完全一致。
+// 被取消时返回空的 Alignment
+Alignment assess(const QString* source, const QString* input,
+                 Monitor* monitor = nullptr);
+
+// cache 不为空时先按分词结果查缓存， 没有命中再对齐并存进去
+Alignment assess(const Answer& answer, const QString* input,
+                 Monitor* monitor = nullptr, ResultCache* cache = nullptr);
 
 
 #endif // ASSESSOR_H
@@ -0,0 +1,167 @@
+#include <QFile>
+#include <QRunnable>
+#include <QTextStream>
+
+#include "Assessor.h"
+#include "Grader.h"
+
+namespace
+{
+
+class GradingJob : public QRunnable
+{
+public:
+    GradingJob(Grader* grader, quint64 generation,
+               std::shared_ptr<Monitor> monitor,
+               const QString& answerFile, const QString& input,
+               std::shared_ptr<const Answer> answer, ResultCache* cache)
+        : grader(grader)
+        , generation(generation)
+        , monitor(monitor)
+        , answerFile(answerFile)
+        , input(input)
+        , answer(answer)
+        , cache(cache)
+    {
+    }
+
+    void run() override
+    {
+        if (monitor->cancelled)
+        {
+            return;
+        }
+
+        if (!answer)
+        {
+            QFile file(answerFile);
+
+            // 有音频， 但是没有原文
+            if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+            {
+                emit grader->jobFailed(generation, "source text not found");
+                return;
+            }
+
+            QTextStream is(&file);
+
+            answer = prepare(is.readAll());
+        }
+
+        int reported = -1;
+
+        monitor->report = [&](int done, int total)
+        {
+            int percent = total > 0 ? 100 * done / total : 100;
+
+            if (percent != reported)
+            {
+                reported = percent;
+                emit grader->jobProgressed(generation, percent);
+            }
+        };
+
+        auto alignment = AlignmentPointer::create(
+                    assess(*answer, &input, monitor.get(), cache));
+
+        if (!monitor->cancelled)
+        {
+            emit grader->jobFinished(generation, alignment);
+        }
+    }
+
+private:
+    Grader* grader;
+    quint64 generation;
+    std::shared_ptr<Monitor> monitor;
+    QString answerFile;
+    QString input;
+    std::shared_ptr<const Answer> answer;
+    ResultCache* cache;
+};
+
+} //! end anonymous namespace
+
+Grader::Grader(QObject* parent)
+    : QObject(parent)
+    , generation(0)
+    , caching(true)
+{
+    qRegisterMetaType<AlignmentPointer>();
+
+    // 对齐本身会按需再开线程， 这里只要一个排队的线程
+    pool.setMaxThreadCount(1);
+
+    connect(this, &Grader::jobProgressed,
+            this, &Grader::onJobProgressed, Qt::QueuedConnection);
+
+    connect(this, &Grader::jobFinished,
+            this, &Grader::onJobFinished, Qt::QueuedConnection);
+
+    connect(this, &Grader::jobFailed,
+            this, &Grader::onJobFailed, Qt::QueuedConnection);
+}
+
+Grader::~Grader()
+{
+    cancel();
+
+    pool.waitForDone();
+}
+
+void Grader::submit(const QString& answerFile, const QString& input,
+                    std::shared_ptr<const Answer> answer)
+{
+    cancel();
+
+    current = std::make_shared<Monitor>();
+
+    pool.start(new GradingJob(this, ++generation, current,
+                              answerFile, input, answer,
+                              caching ? &cache : nullptr));
+}
+
+void Grader::setCacheDirectory(const QString& directory)
+{
+    cache.setDirectory(directory);
+}
+
+void Grader::setCacheEnabled(bool enabled)
+{
+    caching = enabled;
+}
+
+void Grader::cancel()
+{
+    if (current)
+    {
+        current->cancelled = true;
+        current.reset();
+    }
+}
+
+void Grader::onJobProgressed(quint64 generation, int percent)
+{
+    if (current && generation == this->generation)
+    {
+        emit progressed(percent);
+    }
+}
+
+void Grader::onJobFinished(quint64 generation, AlignmentPointer alignment)
+{
+    if (current && generation == this->generation)
+    {
+        current.reset();
+        emit finished(alignment);
+    }
+}
+
+void Grader::onJobFailed(quint64 generation, const QString& message)
+{
+    if (current && generation == this->generation)
+    {
+        current.reset();
+        emit failed(message);
+    }
+}
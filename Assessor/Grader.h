@@ -0,0 +1,79 @@
+#ifndef GRADER_H
+#define GRADER_H
+
+#include <memory>
+
+#include <QObject>
+#include <QSharedPointer>
+#include <QThreadPool>
+
+#include "Alignment.h"
+#include "ResultCache.h"
+
+struct Answer;
+struct Monitor;
+
+using AlignmentPointer = QSharedPointer<const Alignment>;
+
+// 在后台线程里读原文、 对齐， 完成后把整个结果一次性交回 GUI 线程。
+// 同一时刻只有最新提交的任务有效， 新的 submit 会取消旧的
+class Grader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Grader(QObject* parent = nullptr);
+
+    ~Grader();
+
+    // answer 是预取好的原文， 为空时在后台读 answerFile
+    void submit(const QString& answerFile, const QString& input,
+                std::shared_ptr<const Answer> answer = nullptr);
+
+    void cancel();
+
+    // 评估结果同时存到这个目录， 重复的提交不用再对齐
+    void setCacheDirectory(const QString& directory);
+
+    // 关掉时每次都重新对齐， 也不读写缓存目录。 默认打开
+    void setCacheEnabled(bool enabled);
+
+    bool isBusy() const
+    {
+        return current != nullptr;
+    }
+
+signals:
+    // 百分比
+    void progressed(int percent);
+
+    void finished(AlignmentPointer alignment);
+
+    void failed(const QString& message);
+
+    // 以下由工作线程发出， 排队到 GUI 线程后再过滤掉过期的任务
+    void jobProgressed(quint64 generation, int percent);
+
+    void jobFinished(quint64 generation, AlignmentPointer alignment);
+
+    void jobFailed(quint64 generation, const QString& message);
+
+private slots:
+    void onJobProgressed(quint64 generation, int percent);
+
+    void onJobFinished(quint64 generation, AlignmentPointer alignment);
+
+    void onJobFailed(quint64 generation, const QString& message);
+
+private:
+    QThreadPool pool;
+    quint64 generation;
+    std::shared_ptr<Monitor> current;
+    // 在工作线程里使用， 自己带锁
+    ResultCache cache;
+    bool caching;
+};
+
+Q_DECLARE_METATYPE(AlignmentPointer)
+
+#endif // GRADER_H
@@ -0,0 +1,311 @@
+#include <cstring>
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+
+#include "ResultCache.h"
+#include "common/Varint.h"
+
+namespace
+{
+
+const char MAGIC[4] = { 'L', 'R', 'C', '1' };
+
+// 每条路线在内存里除了编码以外的大致开销
+const qint64 SLOT_OVERHEAD = 64;
+
+// 目录超出预算时一次删到预算的这个比例， 不用每写一个文件就扫一遍目录
+const int DISK_KEEP_PERCENT = 75;
+
+// 动作占低 3 位
+const int ACTION_BITS = 3;
+
+bool advancesSource(WordAction action)
+{
+    return action == WordAction::KEPT
+            || action == WordAction::INSERTED
+            || action == WordAction::SKIP_SOURCE
+            || action == WordAction::MOVED;
+}
+
+bool advancesInput(WordAction action)
+{
+    return action == WordAction::KEPT
+            || action == WordAction::REMOVED
+            || action == WordAction::SKIP_INPUT;
+}
+
+// 每段一个数: 词数 << ACTION_BITS | 动作。 两边的起点按顺序累加就能算出来
+QByteArray encode(const std::vector<Run>& runs)
+{
+    QByteArray path;
+
+    for (const Run& run : runs)
+    {
+        writeNumber(&path, (quint32(run.length) << ACTION_BITS)
+                    | quint32(run.action));
+    }
+
+    return path;
+}
+
+bool decode(const QByteArray& path, int sourceSize, int inputSize,
+            std::vector<Run>* runs)
+{
+    auto cursor = reinterpret_cast<const uchar*>(path.constData());
+    auto end = cursor + path.size();
+
+    std::vector<Run> decoded;
+
+    int s = 0;
+    int i = 0;
+
+    while (cursor < end)
+    {
+        quint32 value = 0;
+
+        if (!readNumber(&cursor, end, &value))
+        {
+            return false;
+        }
+
+        quint32 code = value & ((1u << ACTION_BITS) - 1);
+        int length = static_cast<int>(value >> ACTION_BITS);
+
+        if (code > quint32(WordAction::MOVED) || length == 0)
+        {
+            return false;
+        }
+
+        auto action = static_cast<WordAction>(code);
+
+        decoded.push_back(Run { action, s, i, length });
+
+        s += advancesSource(action) ? length : 0;
+        i += advancesInput(action) ? length : 0;
+
+        if (s > sourceSize || i > inputSize)
+        {
+            return false;
+        }
+    }
+
+    if (s != sourceSize || i != inputSize)
+    {
+        return false;
+    }
+
+    runs->swap(decoded);
+
+    return true;
+}
+
+} //! end anonymous namespace
+
+ResultCache::ResultCache(const QString& directory, qint64 budget,
+                         qint64 diskBudget)
+    : directory(directory)
+    , budget(budget)
+    , used(0)
+    , diskBudget(diskBudget)
+    , diskUsed(-1)
+{
+}
+
+void ResultCache::setDirectory(const QString& directory)
+{
+    QMutexLocker locker(&mutex);
+
+    this->directory = directory;
+    diskUsed = -1;
+}
+
+ResultCache::Key ResultCache::key(const std::vector<Token>& source,
+                                  const std::vector<Token>& input,
+                                  quint32 settings)
+{
+    // 只看词号和能否跳过， 对齐只用到这两样
+    std::vector<qint32> words;
+
+    words.reserve(source.size() + input.size() + 3);
+
+    words.push_back(static_cast<qint32>(settings));
+    words.push_back(static_cast<qint32>(source.size()));
+    words.push_back(static_cast<qint32>(input.size()));
+
+    for (const auto* tokens : { &source, &input })
+    {
+        for (const Token& token : *tokens)
+        {
+            words.push_back(token.id * 2 + (token.skippable ? 1 : 0));
+        }
+    }
+
+    return QCryptographicHash::hash(
+                QByteArray::fromRawData(
+                    reinterpret_cast<const char*>(words.data()),
+                    static_cast<int>(words.size() * sizeof(qint32))),
+                QCryptographicHash::Sha1);
+}
+
+QString ResultCache::filePath(const Key& key) const
+{
+    return directory + '/' + QString::fromLatin1(key.toHex()) + ".path";
+}
+
+bool ResultCache::find(const Key& key, int sourceSize, int inputSize,
+                       std::vector<Run>* runs)
+{
+    QMutexLocker locker(&mutex);
+
+    auto iter = cache.find(key);
+
+    if (iter != cache.end())
+    {
+        recency.splice(recency.begin(), recency, iter->position);
+
+        return decode(iter->path, sourceSize, inputSize, runs);
+    }
+
+    if (directory.isEmpty())
+    {
+        return false;
+    }
+
+    QFile file(filePath(key));
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    QByteArray data = file.readAll();
+
+    if (data.size() < static_cast<int>(sizeof(MAGIC))
+            || std::memcmp(data.constData(), MAGIC, sizeof(MAGIC)) != 0)
+    {
+        return false;
+    }
+
+    QByteArray path = data.mid(sizeof(MAGIC));
+
+    if (!decode(path, sourceSize, inputSize, runs))
+    {
+        return false;
+    }
+
+    store(key, path);
+
+    return true;
+}
+
+void ResultCache::insert(const Key& key, const std::vector<Run>& runs)
+{
+    QByteArray path = encode(runs);
+    QString target;
+
+    {
+        QMutexLocker locker(&mutex);
+
+        if (cache.contains(key))
+        {
+            return;
+        }
+
+        store(key, path);
+
+        if (directory.isEmpty() || !QDir().mkpath(directory))
+        {
+            return;
+        }
+
+        target = filePath(key);
+    }
+
+    // 内容由键决定， 写一半的文件不会被当成结果
+    QSaveFile file(target);
+
+    if (file.open(QIODevice::WriteOnly)
+            && file.write(MAGIC, sizeof(MAGIC)) == qint64(sizeof(MAGIC))
+            && file.write(path) == path.size() && file.commit())
+    {
+        account(sizeof(MAGIC) + path.size());
+    }
+}
+
+void ResultCache::account(qint64 size)
+{
+    QMutexLocker locker(&mutex);
+
+    QDir cacheDir(directory);
+    QStringList filter("*.path");
+
+    if (diskUsed < 0)
+    {
+        // 扫出来的已经包含刚写的文件
+        diskUsed = 0;
+
+        for (const QFileInfo& file
+             : cacheDir.entryInfoList(filter, QDir::Files))
+        {
+            diskUsed += file.size();
+        }
+    }
+    else
+    {
+        diskUsed += size;
+    }
+
+    if (diskUsed <= diskBudget)
+    {
+        return;
+    }
+
+    // 最早写的在前面
+    QFileInfoList files = cacheDir.entryInfoList(
+                filter, QDir::Files, QDir::Time | QDir::Reversed);
+
+    diskUsed = 0;
+
+    for (const QFileInfo& file : files)
+    {
+        diskUsed += file.size();
+    }
+
+    qint64 keep = diskBudget * DISK_KEEP_PERCENT / 100;
+
+    for (const QFileInfo& file : files)
+    {
+        if (diskUsed <= keep)
+        {
+            break;
+        }
+
+        if (cacheDir.remove(file.fileName()))
+        {
+            diskUsed -= file.size();
+        }
+    }
+}
+
+void ResultCache::store(const Key& key, const QByteArray& path)
+{
+    recency.push_front(key);
+    cache.insert(key, Slot { path, recency.begin() });
+    used += path.size() + key.size() + SLOT_OVERHEAD;
+
+    // 超出预算就从最久没用的开始扔， 刚放进来的不扔
+    while (used > budget && recency.size() > 1)
+    {
+        auto victim = cache.find(recency.back());
+
+        used -= victim->path.size() + victim.key().size() + SLOT_OVERHEAD;
+
+        cache.erase(victim);
+        recency.pop_back();
+    }
+}
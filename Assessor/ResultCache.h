@@ -0,0 +1,71 @@
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include <list>
+#include <vector>
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+#include "Alignment.h"
+
+// 评估结果的缓存， 按 (原文的词, 输入的词, 对齐规则) 的哈希查找，
+// 只保存编辑路线: 每段的动作和词数。 词的位置命中后由重新分词得到，
+// 所以大小写、 排版符号不同的同一段输入也能命中。
+//
+// 内存里按 LRU 保留最近用过的路线， 每条路线同时写成目录下的一个文件
+// (<哈希>.path)， 重启以后也能命中。 目录超出 diskBudget 时从最早写的文件删起。
+// 可以在任意线程使用
+class ResultCache
+{
+public:
+    using Key = QByteArray;
+
+    // directory 为空时只缓存在内存里
+    explicit ResultCache(const QString& directory = QString(),
+                         qint64 budget = 4 * 1024 * 1024,
+                         qint64 diskBudget = 64 * 1024 * 1024);
+
+    void setDirectory(const QString& directory);
+
+    // settings 是对齐规则的指纹， 规则变了旧的结果自然不会命中
+    static Key key(const std::vector<Token>& source,
+                   const std::vector<Token>& input, quint32 settings);
+
+    // 命中时把路线还原成 runs。 词数对不上的 (文件损坏) 当作没有命中
+    bool find(const Key& key, int sourceSize, int inputSize,
+              std::vector<Run>* runs);
+
+    void insert(const Key& key, const std::vector<Run>& runs);
+
+private:
+    struct Slot
+    {
+        QByteArray path;
+        std::list<Key>::iterator position;
+    };
+
+    QString filePath(const Key& key) const;
+
+    // 放进内存， 超出预算时扔掉最久没用的
+    void store(const Key& key, const QByteArray& path);
+
+    // 记下新写的文件， 目录超出预算时删掉最早写的一批
+    void account(qint64 size);
+
+private:
+    QMutex mutex;
+    QString directory;
+    qint64 budget;
+    QHash<Key, Slot> cache;
+    // 最近使用的在前面
+    std::list<Key> recency;
+    qint64 used;
+    qint64 diskBudget;
+    // 目录里文件的总大小， 第一次写之前扫一遍目录， 没扫过时为 -1
+    qint64 diskUsed;
+};
+
+#endif // RESULTCACHE_H
@@ -0,0 +1,427 @@
+#include "Tokenizer.h"
+
+namespace
+{
+
+// 与 QRegExp 中的 \w 一致
+bool isWordCharacter(QChar c)
+{
+    return c.isLetterOrNumber() || c.isMark() || c == QChar('_');
+}
+
+// U+2010 到 U+2033 之间的排版符号折叠成 ASCII， 0 表示不折叠
+struct Punctuation
+{
+    static const ushort FIRST = 0x2010;
+    static const ushort LAST = 0x2033;
+
+    ushort folded[LAST - FIRST + 1];
+};
+
+constexpr Punctuation makePunctuation()
+{
+    Punctuation table {};
+
+    // 各种连字符和破折号
+    for (ushort c = 0x2010; c <= 0x2015; ++c)
+    {
+        table.folded[c - Punctuation::FIRST] = '-';
+    }
+
+    // 弯引号、 撇号和角分符号
+    table.folded[0x2018 - Punctuation::FIRST] = '\'';
+    table.folded[0x2019 - Punctuation::FIRST] = '\'';
+    table.folded[0x201B - Punctuation::FIRST] = '\'';
+    table.folded[0x2032 - Punctuation::FIRST] = '\'';
+    table.folded[0x201C - Punctuation::FIRST] = '"';
+    table.folded[0x201D - Punctuation::FIRST] = '"';
+    table.folded[0x201F - Punctuation::FIRST] = '"';
+    table.folded[0x2033 - Punctuation::FIRST] = '"';
+
+    return table;
+}
+
+constexpr Punctuation PUNCTUATION = makePunctuation();
+
+// 大小写和排版符号的差别都不算， 所以 ’ 和 ' 驻留成同一个编号
+ushort fold(QChar c)
+{
+    ushort u = c.unicode();
+
+    if (u < 0x80)
+    {
+        return u >= 'A' && u <= 'Z' ? u + ('a' - 'A') : u;
+    }
+
+    if (u >= Punctuation::FIRST && u <= Punctuation::LAST
+            && PUNCTUATION.folded[u - Punctuation::FIRST])
+    {
+        return PUNCTUATION.folded[u - Punctuation::FIRST];
+    }
+
+    // 修饰符撇号和不换行空格
+    if (u == 0x02BC)
+    {
+        return '\'';
+    }
+
+    if (u == 0x00A0)
+    {
+        return ' ';
+    }
+
+    return c.toCaseFolded().unicode();
+}
+
+// 规范化表的一项。 键是小写 ASCII， 值是同义的规范写法
+struct Rule
+{
+    const char* key;
+    const char16_t* value;
+};
+
+constexpr quint32 hashStep(quint32 hash, ushort c)
+{
+    return (hash ^ c) * 16777619u;
+}
+
+template <typename T>
+constexpr int length(const T* text)
+{
+    int n = 0;
+
+    while (text[n])
+    {
+        ++n;
+    }
+
+    return n;
+}
+
+constexpr int tableSize(int count)
+{
+    // 单个种子的完美哈希， 槽数取键数平方的量级才容易找到
+    int size = 16;
+
+    while (size < count * count / 2)
+    {
+        size *= 2;
+    }
+
+    return size;
+}
+
+// 编译期找一个种子， 让表中所有键落在不同的槽里。
+// 查找时只算一次哈希、 比一次键， 不分配内存
+template <int N>
+struct PerfectTable
+{
+    static const int SIZE = tableSize(N);
+    static const quint32 MAX_SEED = 100000;
+
+    const Rule* rules;
+    quint32 seed;
+    int maxLength;
+    // 键的首字符集合， 绝大多数词看第一个字符就能排除
+    quint64 firstCharacters[2];
+    int keyLengths[N];
+    int valueLengths[N];
+    // 规则下标加一， 0 为空槽
+    unsigned char slots[SIZE];
+
+    static constexpr quint32 hash(const char* key, quint32 seed)
+    {
+        quint32 hash = seed * 2166136261u;
+
+        for (int i = 0; key[i]; ++i)
+        {
+            hash = hashStep(hash, static_cast<unsigned char>(key[i]));
+        }
+
+        return hash;
+    }
+
+    // 找不到时返回 nullptr， 找到时 value 指向规范写法
+    const Rule* find(const QChar* data, int length, const QChar** value,
+                     int* valueLength) const
+    {
+        if (length == 0 || length > maxLength)
+        {
+            return nullptr;
+        }
+
+        ushort first = fold(data[0]);
+
+        if (first >= 0x80
+                || !(firstCharacters[first >> 6] & (1ULL << (first & 63))))
+        {
+            return nullptr;
+        }
+
+        quint32 h = seed * 2166136261u;
+
+        for (int i = 0; i < length; ++i)
+        {
+            ushort c = fold(data[i]);
+
+            if (c >= 0x80)
+            {
+                return nullptr;
+            }
+
+            h = hashStep(h, c);
+        }
+
+        int slot = slots[h & (SIZE - 1)];
+
+        if (slot == 0 || keyLengths[slot - 1] != length)
+        {
+            return nullptr;
+        }
+
+        const Rule& rule = rules[slot - 1];
+
+        for (int i = 0; i < length; ++i)
+        {
+            if (fold(data[i]) != static_cast<unsigned char>(rule.key[i]))
+            {
+                return nullptr;
+            }
+        }
+
+        *value = reinterpret_cast<const QChar*>(rule.value);
+        *valueLength = valueLengths[slot - 1];
+
+        return &rule;
+    }
+};
+
+template <int N>
+constexpr PerfectTable<N> makeTable(const Rule (&rules)[N])
+{
+    PerfectTable<N> table {};
+
+    table.rules = rules;
+
+    for (int r = 0; r < N; ++r)
+    {
+        table.keyLengths[r] = length(rules[r].key);
+        table.valueLengths[r] = length(rules[r].value);
+        table.maxLength = table.keyLengths[r] > table.maxLength
+                ? table.keyLengths[r] : table.maxLength;
+
+        auto first = static_cast<unsigned char>(rules[r].key[0]);
+
+        table.firstCharacters[first >> 6] |= 1ULL << (first & 63);
+    }
+
+    for (quint32 seed = 1; seed < PerfectTable<N>::MAX_SEED; ++seed)
+    {
+        for (int i = 0; i < PerfectTable<N>::SIZE; ++i)
+        {
+            table.slots[i] = 0;
+        }
+
+        bool collided = false;
+
+        for (int r = 0; r < N && !collided; ++r)
+        {
+            quint32 slot = PerfectTable<N>::hash(rules[r].key, seed)
+                    & (PerfectTable<N>::SIZE - 1);
+
+            collided = table.slots[slot] != 0;
+            table.slots[slot] = static_cast<unsigned char>(r + 1);
+        }
+
+        if (!collided)
+        {
+            table.seed = seed;
+            return table;
+        }
+    }
+
+    table.seed = 0;
+    return table;
+}
+
+// 数字写成阿拉伯数字和写成单词算同一个词
+constexpr Rule NUMBER_RULES[] =
+{
+    { "0", u"zero" }, { "1", u"one" }, { "2", u"two" }, { "3", u"three" },
+    { "4", u"four" }, { "5", u"five" }, { "6", u"six" }, { "7", u"seven" },
+    { "8", u"eight" }, { "9", u"nine" }, { "10", u"ten" },
+    { "11", u"eleven" }, { "12", u"twelve" }, { "13", u"thirteen" },
+    { "14", u"fourteen" }, { "15", u"fifteen" }, { "16", u"sixteen" },
+    { "17", u"seventeen" }, { "18", u"eighteen" }, { "19", u"nineteen" },
+    { "20", u"twenty" }, { "30", u"thirty" }, { "40", u"forty" },
+    { "50", u"fifty" }, { "60", u"sixty" }, { "70", u"seventy" },
+    { "80", u"eighty" }, { "90", u"ninety" },
+    { "1st", u"first" }, { "2nd", u"second" }, { "3rd", u"third" },
+    { "4th", u"fourth" }, { "5th", u"fifth" }, { "6th", u"sixth" },
+    { "7th", u"seventh" }, { "8th", u"eighth" }, { "9th", u"ninth" },
+    { "10th", u"tenth" }, { "11th", u"eleventh" }, { "12th", u"twelfth" },
+    { "20th", u"twentieth" }, { "30th", u"thirtieth" }
+};
+
+// 撇号后面的缩写。 's 一律当作 is， 所有格两边都是 's， 不影响对齐
+constexpr Rule SUFFIX_RULES[] =
+{
+    { "s", u"is" }, { "re", u"are" }, { "ve", u"have" }, { "ll", u"will" },
+    { "d", u"would" }, { "m", u"am" }, { "t", u"not" }
+};
+
+// n't 前面的部分
+constexpr Rule NEGATION_RULES[] =
+{
+    { "don", u"do" }, { "doesn", u"does" }, { "didn", u"did" },
+    { "isn", u"is" }, { "aren", u"are" }, { "wasn", u"was" },
+    { "weren", u"were" }, { "hasn", u"has" }, { "haven", u"have" },
+    { "hadn", u"had" }, { "couldn", u"could" }, { "wouldn", u"would" },
+    { "shouldn", u"should" }, { "mustn", u"must" }, { "needn", u"need" },
+    { "won", u"will" }, { "can", u"can" }, { "shan", u"shall" }
+};
+
+constexpr auto NUMBERS = makeTable(NUMBER_RULES);
+constexpr auto SUFFIXES = makeTable(SUFFIX_RULES);
+constexpr auto NEGATIONS = makeTable(NEGATION_RULES);
+
+static_assert(NUMBERS.seed && SUFFIXES.seed && NEGATIONS.seed,
+              "no perfect hash seed for a normalization table");
+
+// 单词按表换成规范写法再驻留， 表里的值是静态数据， 可以直接做键
+template <int N>
+bool internRule(const PerfectTable<N>& table, const QChar* data, int length,
+                Lexicon* lexicon, int* id)
+{
+    const QChar* value = nullptr;
+    int valueLength = 0;
+
+    if (!table.find(data, length, &value, &valueLength))
+    {
+        return false;
+    }
+
+    *id = lexicon->intern(value, valueLength);
+    return true;
+}
+
+// 刚切出的单词是 word ' suffix 的最后一段时， 把缩写展开：
+// that's 与 that is、 don't 与 do not 的编号逐词相同
+void expandContraction(std::vector<Token>* tokens, const QChar* data,
+                       Lexicon* lexicon)
+{
+    size_t n = tokens->size();
+
+    if (n < 3)
+    {
+        return;
+    }
+
+    Token& stem = (*tokens)[n - 3];
+    const Token& mark = (*tokens)[n - 2];
+    Token& suffix = (*tokens)[n - 1];
+
+    if (mark.length != 1 || fold(data[mark.offset]) != '\''
+            || !isWordCharacter(data[stem.offset]))
+    {
+        return;
+    }
+
+    int suffixId = 0;
+
+    if (!internRule(SUFFIXES, data + suffix.offset, suffix.length,
+                    lexicon, &suffixId))
+    {
+        return;
+    }
+
+    // 只有 n't 需要同时改前面的词
+    if (suffix.length == 1 && fold(data[suffix.offset]) == 't'
+            && !internRule(NEGATIONS, data + stem.offset, stem.length,
+                           lexicon, &stem.id))
+    {
+        return;
+    }
+
+    suffix.id = suffixId;
+}
+
+} //! end anonymous namespace
+
+size_t Lexicon::KeyHash::operator()(const Key& key) const
+{
+    // FNV-1a
+    size_t hash = 2166136261u;
+
+    for (int i = 0; i < key.length; ++i)
+    {
+        hash = (hash ^ fold(key.data[i])) * 16777619u;
+    }
+
+    return hash;
+}
+
+bool Lexicon::KeyEqual::operator()(const Key& lhs, const Key& rhs) const
+{
+    if (lhs.length != rhs.length)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < lhs.length; ++i)
+    {
+        if (fold(lhs.data[i]) != fold(rhs.data[i]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int Lexicon::intern(const QChar* data, int length)
+{
+    return ids.emplace(Key { data, length }, size()).first->second;
+}
+
+std::vector<Token> tokenize(const QString& text, Lexicon* lexicon)
+{
+    std::vector<Token> tokens;
+
+    const QChar* data = text.constData();
+    int size = text.size();
+
+    int begin = 0;
+
+    while (begin < size)
+    {
+        bool word = isWordCharacter(data[begin]);
+
+        int end = begin + 1;
+
+        while (end < size && isWordCharacter(data[end]) == word)
+        {
+            ++end;
+        }
+
+        int length = end - begin;
+        int id = 0;
+
+        if (!word || !internRule(NUMBERS, data + begin, length, lexicon, &id))
+        {
+            id = lexicon->intern(data + begin, length);
+        }
+
+        tokens.push_back(Token { begin, length, id,
+                                 !data[begin].isLetterOrNumber() });
+
+        if (word)
+        {
+            expandContraction(&tokens, data, lexicon);
+        }
+
+        begin = end;
+    }
+
+    return tokens;
+}
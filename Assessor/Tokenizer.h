@@ -0,0 +1,56 @@
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include <unordered_map>
+#include <vector>
+
+#include <QString>
+
+// 文本中的一个词或一段分隔符， 只记录位置， 不复制内容
+struct Token
+{
+    int offset;
+    int length;
+    // 驻留后的编号。 大小写或排版符号不同的同一个词编号相同，
+    // 数字与对应的英文单词、 缩写与展开后的词也相同
+    int id;
+    // 不以字母或数字开头的分隔符， 对齐时可以跳过
+    bool skippable;
+};
+
+// 词到编号的映射。 键直接指向被分词的文本， 所以文本要比 Lexicon 活得久
+class Lexicon
+{
+public:
+    int intern(const QChar* data, int length);
+
+    int size() const
+    {
+        return static_cast<int>(ids.size());
+    }
+
+private:
+    struct Key
+    {
+        const QChar* data;
+        int length;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct KeyEqual
+    {
+        bool operator()(const Key& lhs, const Key& rhs) const;
+    };
+
+    std::unordered_map<Key, int, KeyHash, KeyEqual> ids;
+};
+
+// 按单词边界切分， 与 split(QRegExp("\\b")) 相同， 但不产生子串。
+// 切分的同时按编译期生成的表做规范化， 不额外分配内存
+std::vector<Token> tokenize(const QString& text, Lexicon* lexicon);
+
+#endif // TOKENIZER_H
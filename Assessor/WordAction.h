@@ -1,9 +1,12 @@
 #ifndef WORDSTATE_H
 #define WORDSTATE_H
 
-enum class WordAction
+enum class WordAction : unsigned char
 {
-    KEPT, INSERTED, REMOVED, SKIP_SOURCE, SKIP_INPUT
+    KEPT, INSERTED, REMOVED, SKIP_SOURCE, SKIP_INPUT,
+    // 原文中的词在输入里出现了， 但位置不对。 记在原文一侧，
+    // 输入里对应的词改记为 SKIP_INPUT
+    MOVED
 };
 
 #endif // WORDSTATE_H
@@ -7,42 +7,104 @@
 SpellChecker::SpellChecker()
     : checker(nullptr)
 {
-    QString workingDirectory = QCoreApplication::applicationDirPath();
+    directory = QCoreApplication::applicationDirPath() + "/en_US";
 
-    QString aff = workingDirectory + "/en_US/en_US.aff";
-    QString dic = workingDirectory + "/en_US/en_US.dic";
-
-    if (!QFile(aff).exists())
+    if (!words.open(directory + "/en_US.words"))
     {
-        qDebug() << "aff file not found";
+        qDebug() << "word set not found, using hunspell only";
     }
 
-    if (!QFile(dic).exists())
+    if (!suggestions.open(directory + "/en_US.suggest"))
     {
-        qDebug() << "dict file not found";
+        qDebug() << "suggestion index not found";
     }
+}
 
-    checker = new Hunspell(aff.toLocal8Bit(), dic.toLocal8Bit());
+SpellChecker::~SpellChecker()
+{
+    if (checker)
+    {
+        delete checker;
+    }
+}
 
+Hunspell* SpellChecker::hunspell() const
+{
     if (!checker)
     {
-        qDebug() << "hunspell construction failed";
+        QString aff = directory + "/en_US.aff";
+        QString dic = directory + "/en_US.dic";
+
+        if (!QFile(aff).exists())
+        {
+            qDebug() << "aff file not found";
+        }
+
+        if (!QFile(dic).exists())
+        {
+            qDebug() << "dict file not found";
+        }
+
+        checker = new Hunspell(aff.toLocal8Bit(), dic.toLocal8Bit());
+
+        if (!checker)
+        {
+            qDebug() << "hunspell construction failed";
+        }
     }
+
+    return checker;
 }
 
-SpellChecker::~SpellChecker()
+// 与 hunspell 的大小写规则一致: 小写词可以首字母大写或全部大写，
+// 首字母大写的词 (专有名词) 可以全部大写。 其它大小写混合的交给 hunspell
+bool SpellChecker::isCommon(const QString& word) const
 {
-    if (checker)
+    if (words.contains(word))
     {
-        delete checker;
+        return true;
     }
+
+    if (word.isEmpty() || !word.at(0).isUpper())
+    {
+        return false;
+    }
+
+    QString lower = word.toLower();
+    QString rest = word.mid(1);
+
+    // 首字母大写， 其余小写
+    if (rest == rest.toLower())
+    {
+        return words.contains(lower);
+    }
+
+    // 全部大写
+    if (word == word.toUpper())
+    {
+        if (words.contains(lower))
+        {
+            return true;
+        }
+
+        lower[0] = lower.at(0).toUpper();
+
+        return words.contains(lower);
+    }
+
+    return false;
 }
 
 bool SpellChecker::isValid(const QString& word) const
 {
-    if (checker)
+    if (words.isOpen() && isCommon(word))
     {
-        return checker->spell(word.toLocal8Bit());
+        return true;
+    }
+
+    if (Hunspell* handle = hunspell())
+    {
+        return handle->spell(word.toLocal8Bit());
     }
     else
     {
@@ -51,3 +113,10 @@ bool SpellChecker::isValid(const QString& word) const
         return false;
     }
 }
+
+QStringList SpellChecker::suggest(const QString& word,
+                                  const QSet<QString>& boosted,
+                                  int limit) const
+{
+    return suggestions.suggest(word, boosted, limit);
+}
@@ -4,8 +4,13 @@
 #include <QString>
 #include <QList>
 
+#include "SuggestionIndex.h"
+#include "WordSet.h"
+
 class Hunspell;
 
+// 先查预先展开的词形集合， 查不到再交给 hunspell。
+// hunspell 加载很慢， 第一次需要它时才创建
 class SpellChecker
 {
 public:
@@ -15,8 +20,21 @@ public:
 
     bool isValid(const QString& word) const;
 
+    // 只查词形集合， 不碰 hunspell， 可以在多个线程里同时调用
+    bool isCommon(const QString& word) const;
+
+    // 拼写建议， boosted 是当前单元原文中的 (小写) 词
+    QStringList suggest(const QString& word, const QSet<QString>& boosted,
+                        int limit = 5) const;
+
+private:
+    Hunspell* hunspell() const;
+
 private:
-    Hunspell* checker;
+    QString directory;
+    WordSet words;
+    SuggestionIndex suggestions;
+    mutable Hunspell* checker;
 };
 
 #endif // DICTIONARY_H
@@ -28,17 +28,62 @@ DEFINES += QT_DEPRECATED_WARNINGS
 SOURCES += main.cpp \
     MainWindow.cpp \
     Dictionary.cpp \
+    ResultView.cpp \
+    SuggestionIndex.cpp \
+    WordSet.cpp \
+    common/Varint.cpp \
+    player/Loudness.cpp \
+    player/LoudnessAnalyzer.cpp \
+    player/Mp3Header.cpp \
+    player/Mp3Index.cpp \
     player/Player.cpp \
+    player/StretchDevice.cpp \
+    player/TimeStretcher.cpp \
     Assessor/Assessor.cpp \
-    Assessor/Word.cpp
+    Assessor/Alignment.cpp \
+    Assessor/Grader.cpp \
+    Assessor/ResultCache.cpp \
+    Assessor/Tokenizer.cpp \
+    diagnostics/Metrics.cpp \
+    resource/AssetManifest.cpp \
+    resource/CorpusIndex.cpp \
+    resource/Prefetcher.cpp \
+    resource/ResourcePack.cpp \
+    resource/SearchIndex.cpp \
+    session/DraftJournal.cpp \
+    session/SessionLog.cpp \
+    session/SessionReplayer.cpp
 
 HEADERS  += \
     MainWindow.h \
     Dictionary.h \
+    ResultView.h \
+    SuggestionIndex.h \
+    WordSet.h \
+    common/PoolJob.h \
+    common/Varint.h \
+    player/Loudness.h \
+    player/LoudnessAnalyzer.h \
+    player/Mp3Header.h \
+    player/Mp3Index.h \
     player/Player.h \
+    player/StretchDevice.h \
+    player/TimeStretcher.h \
     Assessor/Assessor.h \
-    Assessor/Word.h \
-    Assessor/WordAction.h
+    Assessor/Alignment.h \
+    Assessor/Grader.h \
+    Assessor/ResultCache.h \
+    Assessor/Tokenizer.h \
+    Assessor/WordAction.h \
+    diagnostics/Metrics.h \
+    resource/AssetManifest.h \
+    resource/CorpusIndex.h \
+    resource/Prefetcher.h \
+    resource/ResourcePack.h \
+    resource/SearchIndex.h \
+    session/DraftJournal.h \
+    session/SessionLog.h \
+    session/SessionReplayer.h
 
 FORMS    += \
     MainWindow.ui
@@ -1,22 +1,35 @@
-#include <QMediaPlayer>
 #include <QDesktopWidget>
 #include <QSharedPointer>
 #include <QWebEngineView>
 #include <QColor>
 #include <QFile>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QFontDatabase>
+#include <QKeyEvent>
+#include <QSaveFile>
+#include <QShortcut>
 #include <QThread>
+#include <QTime>
 #include <QTimer>
 #include <QDir>
 #include <QMimeData>
 #include <QTextBlock>
 #include <QSyntaxHighlighter>
 #include <QMenu>
-
-#include <hunspell/hunspell.h>
+#include <QTextDocument>
+#include <QVBoxLayout>
 
 #include "MainWindow.h"
 #include "ui_MainWindow.h"
-#include "Assessor/Assessor.h"
+#include "Dictionary.h"
+#include "ResultView.h"
+#include "common/PoolJob.h"
+#include "diagnostics/Metrics.h"
+#include "player/Loudness.h"
+#include "player/LoudnessAnalyzer.h"
+#include "player/Player.h"
+#include "session/DraftJournal.h"
 
 namespace
 {
@@ -24,39 +37,18 @@ namespace
 class WordHighlighter : QSyntaxHighlighter
 {
 public:
-    WordHighlighter(QWidget* parent)
+    WordHighlighter(QWidget* parent, const SpellChecker* checker)
         : QSyntaxHighlighter(parent)
-        , handle(nullptr)
+        , checker(checker)
         , pattern("\\w+")
     {
-        QString workingDirectory = QCoreApplication::applicationDirPath();
-
-        QString aff = workingDirectory + "/en_US/en_US.aff";
-        QString dic = workingDirectory + "/en_US/en_US.dic";
-
-        handle = Hunspell_create(aff.toLocal8Bit(), dic.toLocal8Bit());
-
         right.setForeground(Qt::black);
         error.setForeground(Qt::red);
     }
 
-    ~WordHighlighter()
-    {
-        if (handle)
-        {
-            Hunspell_destroy(handle);
-        }
-    }
-
 protected:
     void highlightBlock(const QString& text) override
     {
-        if (!handle)
-        {
-            setFormat(0, text.length(), right);
-            return;
-        }
-
         int index = 0;
         int length = 0;
 
@@ -64,7 +56,8 @@ protected:
         {
             length = pattern.matchedLength();
 
-            if (Hunspell_spell(handle, text.mid(index, length).toLocal8Bit()))
+            // 绝大多数词在预先展开的词形集合里就能查到
+            if (checker->isValid(text.mid(index, length)))
             {
                 setFormat(index, length, right);
             }
@@ -76,26 +69,50 @@ protected:
     }
 
 private:
-    Hunhandle* handle;
+    const SpellChecker* checker;
     QRegExp pattern;
     QTextCharFormat right;
     QTextCharFormat error;
 };
 
+// 听写正确过的词， 每行一个， 只追加
+QString knownWordsPath()
+{
+    return QCoreApplication::applicationDirPath() + "/english_data.known";
+}
+
 } //! end anonymous namespace
 
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
     ui(new Ui::MainWindow),
-    player(new QMediaPlayer(this)),
-    resourceMenu(new QMenu(this))
+    player(new Player(this)),
+    grader(new Grader(this)),
+    loudness(new LoudnessAnalyzer(QCoreApplication::applicationDirPath()
+                                  + "/english_data.loudness", this)),
+    drafts(new DraftJournal(QCoreApplication::applicationDirPath()
+                            + "/english_data.drafts", this)),
+    spellChecker(new SpellChecker),
+    resourceMenu(new QMenu(this)),
+    packUnit(-1),
+    corpusReady(false),
+    autosave(true),
+    restoringDraft(false),
+    resultPending(false),
+    diagnosticsTimer(new QTimer(this))
 {
     ui->setupUi(this);
 
     webView = new QWebEngineView(ui->search_frame);
 
-    new WordHighlighter(ui->script_edit);
+    resultView = new ResultView(ui->result_frame);
+
+    auto resultLayout = new QVBoxLayout(ui->result_frame);
+    resultLayout->setContentsMargins(0, 0, 0, 0);
+    resultLayout->addWidget(resultView);
+
+    new WordHighlighter(ui->script_edit, spellChecker);
 
     initWindow();
 
@@ -114,12 +131,81 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(ui->volume_slider, &QSlider::sliderMoved,
             this, &MainWindow::updateVolume);
 
-    connect(player, &QMediaPlayer::positionChanged,
+    connect(ui->speed_box,
+            static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            this, &MainWindow::updateSpeed);
+
+    connect(player, &Player::positionChanged,
             this, &MainWindow::updateProgressByTick);
 
     connect(ui->submit_button, &QPushButton::clicked,
             this, &MainWindow::evaluate);
 
+    // 正在播放的单元分析完了， 马上把音量拉齐
+    connect(loudness, &LoudnessAnalyzer::analyzed,
+            [this](const QString& unit, double lufs)
+    {
+        if (unit == unitFile)
+        {
+            player->setGain(normalizationGain(lufs));
+        }
+    });
+
+    loadKnownWords();
+
+    // 重复提交和重新打开的结果直接从缓存里取
+    grader->setCacheDirectory(QCoreApplication::applicationDirPath()
+                              + "/english_data.results");
+
+    connect(grader, &Grader::finished,
+            this, &MainWindow::showAlignment);
+
+    connect(grader, &Grader::progressed, [this](int percent)
+    {
+        statusBar()->showMessage(QString("grading ... %1%").arg(percent));
+    });
+
+    connect(grader, &Grader::failed, [this](const QString& message)
+    {
+        Metrics::endGrading();
+        submitClock.invalidate();
+
+        statusBar()->showMessage(message, 2000);
+
+        emit gradingDone();
+    });
+
+    connect(ui->next_error_button, &QPushButton::clicked,
+            resultView, &ResultView::nextError);
+
+    connect(resultView, &ResultView::currentErrorChanged,
+            [this](int index, int count)
+    {
+        if (count == 0)
+        {
+            statusBar()->showMessage("no errors", 2000);
+        }
+        else if (index >= 0)
+        {
+            statusBar()->showMessage(QString("error %1 of %2")
+                                     .arg(index + 1).arg(count));
+        }
+    });
+
+    // 查询在映射的索引上进行， 不到一毫秒， 可以边输入边过滤
+    connect(ui->search_edit, &QLineEdit::textChanged,
+            this, &MainWindow::searchUnits);
+
+    // 索引在后台建好之前不能搜索
+    ui->search_edit->setEnabled(false);
+
+    qRegisterMetaType<CorpusPointer>();
+
+    indexPool.setMaxThreadCount(1);
+
+    connect(this, &MainWindow::corpusIndexed,
+            this, &MainWindow::applyCorpus, Qt::QueuedConnection);
+
     connect(ui->resource_list, &QTreeWidget::itemDoubleClicked,
             this, &MainWindow::selectResource);
 
@@ -129,6 +215,59 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(ui->resource_list, &QTreeWidget::customContextMenuRequested,
             this, &MainWindow::popResourceMenu);
 
+    connect(ui->script_edit, &QTextEdit::customContextMenuRequested,
+            this, &MainWindow::popEditMenu);
+
+    connect(ui->script_edit->document(), &QTextDocument::contentsChange,
+            this, &MainWindow::recordEdit);
+
+    // 选中单元和拖动进度条的延迟等播放器报告
+    connect(player, &Player::ready, [this]()
+    {
+        if (selectClock.isValid())
+        {
+            Metrics::record(Metrics::SELECT_READY, selectClock.nsecsElapsed());
+            selectClock.invalidate();
+        }
+    });
+
+    connect(player, &Player::audioResumed, [this]()
+    {
+        if (seekClock.isValid())
+        {
+            Metrics::record(Metrics::SEEK_AUDIO, seekClock.nsecsElapsed());
+            seekClock.invalidate();
+        }
+    });
+
+    ui->script_edit->installEventFilter(this);
+    ui->script_edit->viewport()->installEventFilter(this);
+    resultView->viewport()->installEventFilter(this);
+
+    new QShortcut(QKeySequence("Ctrl+Shift+D"), this,
+                  [this]() { toggleDiagnostics(); });
+
+    connect(ui->export_button, &QPushButton::clicked,
+            this, &MainWindow::exportDiagnostics);
+
+    diagnosticsTimer->setInterval(1000);
+
+    connect(diagnosticsTimer, &QTimer::timeout,
+            this, &MainWindow::refreshDiagnostics);
+
+    connect(ui->tabWidget, &QTabWidget::currentChanged, [this](int)
+    {
+        if (ui->tabWidget->currentWidget() == ui->diagnostics_tab)
+        {
+            refreshDiagnostics();
+            diagnosticsTimer->start();
+        }
+        else
+        {
+            diagnosticsTimer->stop();
+        }
+    });
+
     checkResource();
 
     ui->tabWidget->setCurrentIndex(0);
@@ -136,7 +275,11 @@ MainWindow::MainWindow(QWidget *parent) :
 
 MainWindow::~MainWindow()
 {
+    // 后台任务还在读 pack 和 assets
+    indexPool.waitForDone();
+
     delete ui;
+    delete spellChecker;
 }
 
 void MainWindow::initWindow()
@@ -150,13 +293,27 @@ void MainWindow::initWindow()
 
     ui->resource_list->setContextMenuPolicy(Qt::CustomContextMenu);
 
+    ui->resource_list->setColumnCount(3);
+
+    ui->resource_list->setHeaderLabels({ "unit", "note", "difficulty" });
+
+    ui->script_edit->setContextMenuPolicy(Qt::CustomContextMenu);
+
+    ui->diagnostics_edit->setFont(
+                QFontDatabase::systemFont(QFontDatabase::FixedFont));
+
+    // 诊断页给开发者看， 默认不显示
+    ui->tabWidget->removeTab(ui->tabWidget->indexOf(ui->diagnostics_tab));
+
     // 窗口重定位到桌面中央
     QDesktopWidget* desktop = QApplication::desktop();
 
     move(desktop->width() / 2 - width() / 2,
          desktop->height() / 2 - height() / 2);
 
-    player->setVolume(40);
+    player->adjustVolume(0.4);
+
+    ui->speed_box->setCurrentIndex(2);
 
     webView->setZoomFactor(0.9);
 
@@ -166,7 +323,7 @@ void MainWindow::initWindow()
 void MainWindow::start()
 {
     // 如果用户还没有指定要播放的音频， status bar报错
-    if (player->isMetaDataAvailable())
+    if (player->isReady())
     {
         player->play();
     }
@@ -178,13 +335,16 @@ void MainWindow::start()
 
 void MainWindow::pause()
 {
+    // 暂停期间定位不会出声， 不算延迟
+    seekClock.invalidate();
+
     player->pause();
 }
 
 // 根据音频进度更新进度条
 void MainWindow::updateProgressByTick()
 {
-    if (player->state() == QMediaPlayer::State::PlayingState)
+    if (player->isPlaying())
     {
         double progress = 100.0 * player->position() / player->duration();
 
@@ -197,390 +357,546 @@ void MainWindow::updateProgressByTick()
 // 根据进度条更新音频进度
 void MainWindow::updateProgressBySlider()
 {
+    recorder.write(SessionEvent::SEEK, ui->progress_slider->value());
+
+    // 只量播放中的定位， 否则量到的是用户下次按播放的时间
+    if (player->isPlaying())
+    {
+        seekClock.start();
+    }
+    else
+    {
+        seekClock.invalidate();
+    }
+
     double rate = ui->progress_slider->value() / 100.0;
 
-    int current = static_cast<int>(rate * player->duration());
+    player->adjustProgress(rate);
 
     ui->progress_time_lable->setText(timeString());
 
-    player->setPosition(current);
-
     player->play();
 }
 
 void MainWindow::updateVolume()
 {
-    player->setVolume(ui->volume_slider->value());
+    player->adjustVolume(ui->volume_slider->value() / 100.0);
 }
 
-// 匿名空间里的东西全部都是为了 评估 用户提交的听写内容
-// 核心： 求最短编辑距离（动态规划）， 返回编辑方法 
-namespace
-{
-// 标识每个单词的状态
-enum class State
+// 变速不变调， 选项的文字形如 "0.75x"
+void MainWindow::updateSpeed()
 {
-    KEPT, REMOVED, INSERTED
-};
+    QString text = ui->speed_box->currentText();
+
+    player->setRate(text.left(text.size() - 1).toDouble());
+}
 
-class WordAction
+void MainWindow::evaluate()
 {
-public:
-    WordAction(const QString& word, State state)
-        : word(word)
-        , state(state)
+    recorder.write(SessionEvent::SUBMIT);
+
+    // 用户还没有指定音频
+    if (textFile.isEmpty())
     {
+        statusBar()->showMessage("resource not assigned", 2000);
+
+        emit gradingDone();
+        return;
     }
 
-    const QString& getWord() const
+    // 读原文和对齐都在后台进行， 之前没做完的评估会被取消
+    std::shared_ptr<const Answer> answer = currentAnswer();
+
+    if (packUnit >= 0 && !answer)
     {
-        return word;
+        statusBar()->showMessage("source text not found", 2000);
+
+        emit gradingDone();
+        return;
     }
 
-    State getState() const
+    submitClock.start();
+    Metrics::beginGrading();
+
+    grader->submit(textFile, ui->script_edit->toPlainText(), answer);
+
+    statusBar()->showMessage("grading ...");
+}
+
+void MainWindow::showAlignment(AlignmentPointer alignment)
+{
+    Metrics::endGrading();
+
+    // 用户的输入留在编辑区， 结果单独显示， 长文章也只画看得见的几行
+    resultView->setAlignment(alignment);
+
+    resultPending = submitClock.isValid();
+
+    // 听写正确的词算作已掌握， 只是顺序写错的也算， 单元的难度随之更新
+    const QString& source = alignment->getSource();
+    QStringList learned;
+
+    for (const Run& run : *alignment)
     {
-        return state;
+        if (run.action != WordAction::KEPT && run.action != WordAction::MOVED)
+        {
+            continue;
+        }
+
+        for (int i = run.sourceOffset; i < run.sourceOffset + run.length; ++i)
+        {
+            const Token& token = alignment->getSourceTokens()[i];
+
+            QString word = source.mid(token.offset, token.length).toLower();
+
+            if (!token.skippable && !knownWords.contains(word))
+            {
+                knownWords.insert(word);
+                learned.append(word);
+            }
+        }
     }
 
-private:
-    QString word;
-    State state;
-};
+    saveKnownWords(learned);
 
-using Expense = int;
+    updateDifficulty();
 
-using Index = int;
+    ui->tabWidget->setCurrentWidget(ui->result_tab);
 
-using Coordinate = std::pair<Index, Index>;
+    resultView->setFocus();
 
-using Node = std::tuple<Coordinate, Expense, State>;
+    statusBar()->showMessage(QString("graded, %1 errors")
+                             .arg(resultView->errorCount()), 2000);
 
-Coordinate makeCoordinate(int x, int y)
-{
-    return std::make_pair(x, y);
+    emit gradingDone();
 }
 
-Index getX(const Coordinate& coordinate)
+enum TreeItemType
 {
-    return coordinate.first;
-}
+    UNIT = 1,
+    SECTION
+};
 
-Index getY(const Coordinate& coordinate)
+void MainWindow::checkResource()
 {
-    return coordinate.second;
-}
+    QString path = QCoreApplication::applicationDirPath();
 
-constexpr Node makeNode(Coordinate coordinate,
-                        Expense expense, State state)
-{
-    return std::make_tuple(coordinate, expense, state);
-}
+    // 有资源包时只需打开并映射一次， 不用遍历目录
+    if (pack.open(path + "/english_data.pack"))
+    {
+        QStringList units;
+        QHash<QString, int> packed;
 
-#define define_getter(target, i) \
-    auto get ## target (const Node& node) \
-{ \
-    return std::get<i>(node); \
-}
+        for (int s = 0; s < pack.sectionCount(); ++s)
+        {
+            auto section = new QTreeWidgetItem(ui->resource_list,
+                                               TreeItemType::SECTION);
 
-define_getter(NextCoordinate, 0)
-define_getter(Expense, 1)
-define_getter(State, 2)
+            section->setText(0, pack.sectionName(s));
 
-#undef define_getter
+            for (int u = pack.firstUnit(s),
+                 bound = u + pack.unitCountOf(s); u < bound; ++u)
+            {
+                auto unit = new QTreeWidgetItem(section, TreeItemType::UNIT);
 
+                unit->setText(0, pack.unitName(u));
+                unit->setData(0, Qt::UserRole, u);
 
-using Memo = QMap<Coordinate, Node>;
+                units.push_back(unitPath(unit));
+                packed.insert(units.back(), u);
 
-const int REMOVE_EXPENSE = 2;
-const int INSERT_EXPENSE = 2;
-const int KEEP_EXPENSE = 0;
+                loudness->enqueue(units.back(), pack.audioHash(u),
+                                  QString(), pack.audio(u));
 
-// 递归求最短距离， 并把编辑路线记在 memo 里面
-int search(const QStringList* answerWords,
-           const QStringList* scriptWords,
-           int answerId, int scriptId,
-           Memo* memo)
-{
-    //    KEPT, REMOVED, INSERTED, REPLACED
+                if (!pack.hasAnswer(u))
+                {
+                    unit->setText(1, "source text not fount");
+                }
+            }
+        }
 
-    if (answerId >= answerWords->size())
-    {
-        return (scriptWords->size() - scriptId) * REMOVE_EXPENSE;
+        // 包里的原文用打包时的哈希当版本戳
+        indexCorpus(units, [this, packed](const QString& unit)
+        {
+            return pack.answerHash(packed.value(unit));
+        },
+        [this, packed](const QString& unit)
+        {
+            return pack.answer(packed.value(unit));
+        });
+
+        return;
     }
-    else if (scriptId >= scriptWords->size())
+
+    QDir dataDirectory(path + "/english_data");
+
+    if (!dataDirectory.exists())
     {
-        return (answerWords->size() - answerId) * INSERT_EXPENSE;
+        qDebug() << "resource not found";
+        return;
     }
-    else
+
+    assets.load(path + "/english_data.assets",
+                dataDirectory.absolutePath());
+
+    QRegExp pattern("(.+)\\.mp3");
+
+    // 资源树里单元的顺序， 预取时按这个顺序猜下一个
+    QStringList units;
+
+    auto sectionDirectories = dataDirectory
+            .entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot);
+
+    for (auto& sectionDir : sectionDirectories)
     {
-        auto iter = memo->find({ answerId, scriptId });
+        const auto& sectionPath = QDir(sectionDir.absoluteFilePath());
 
-        if (iter == memo->end())
-        {
-            const auto& answer = answerWords->at(answerId);
-            const auto& script = scriptWords->at(scriptId);
+        auto section = new QTreeWidgetItem(ui->resource_list,
+                                           TreeItemType::SECTION);
 
-            int better = -1;
-            Node node;
+        section->setText(0, sectionDir.fileName());
 
-            if (script == answer)
+        for (const auto& file: sectionPath.entryInfoList(QDir::Files))
+        {
+            if (pattern.indexIn(file.absoluteFilePath()) != -1)
             {
-                better = KEEP_EXPENSE + search(answerWords, scriptWords,
-                                               answerId + 1, scriptId + 1,
-                                               memo);
+                auto unit = new QTreeWidgetItem(section, TreeItemType::UNIT);
 
-                node = makeNode(makeCoordinate(answerId + 1, scriptId + 1),
-                                better, State::KEPT);
+                unit->setText(0, file.fileName());
 
-            }
-            else
-            {
-                int removed = REMOVE_EXPENSE + search(answerWords, scriptWords,
-                                                      answerId, scriptId + 1,
-                                                      memo);
+                units.push_back(unitPath(unit));
 
-                int inserted = INSERT_EXPENSE + search(answerWords, scriptWords,
-                                                       answerId + 1, scriptId,
-                                                       memo);
+                loudness->enqueue(units.back(),
+                                  LoudnessAnalyzer::fileStamp(units.back()),
+                                  units.back());
 
-                if (removed <= inserted)
+                // 不用打开音频就能显示时长
+                if (auto entry = assets.find(units.back()))
                 {
-                    better = removed;
-
-                    node = makeNode(makeCoordinate(answerId, scriptId + 1),
-                                    better, State::REMOVED);
+                    unit->setToolTip(0, QTime(0, 0).addMSecs(entry->duration)
+                                     .toString("mm:ss"));
                 }
-                else
-                {
-                    better = inserted;
 
-                    node = makeNode(makeCoordinate(answerId + 1, scriptId),
-                                    better, State::INSERTED);
+                // no effect
+                if (!QFile(pattern.capturedTexts().at(1)).exists())
+                {
+                    unit->setText(1, "source text not fount");
                 }
             }
+        }
+    }
 
-            memo->insert({ answerId, scriptId }, node);
+    prefetcher.setOrder(units);
 
-            return better;
-        }
-        else
+    // 预先建好的语料索引用原文的内容哈希当版本戳
+    if (assets.hasIndexes())
+    {
+        indexCorpus(units, [this](const QString& unit)
         {
-            return getExpense(iter.value());
-        }
+            return assets.answerStamp(unit);
+        },
+        &CorpusIndex::readFile);
+
+        return;
     }
+
+    indexCorpus(units, &CorpusIndex::fileStamp, &CorpusIndex::readFile);
 }
 
-// 把 memo 中的路线提取出来
-QSharedPointer<QList<WordAction>> search(const QStringList* answerWords,
-                                        const QStringList* scriptWords)
+void MainWindow::indexCorpus(const QStringList& units,
+                             const CorpusIndex::Stamp& stamp,
+                             const CorpusIndex::Reader& reader)
 {
-    Memo memo;
+    // 预先建好的索引过期时， 更新写到程序自己的文件里， 不覆盖 tools/assets 的输出
+    QString ownPath = QCoreApplication::applicationDirPath()
+            + "/english_data.index";
+    QString ownSearchPath = QCoreApplication::applicationDirPath()
+            + "/english_data.search";
+
+    // 上次已经在预先建好的基础上更新过， 就接着用自己的
+    bool prebuilt = assets.hasIndexes()
+            && !(QFileInfo::exists(ownPath)
+                 && QFileInfo(ownPath).lastModified()
+                    >= QFileInfo(assets.indexPath()).lastModified());
+
+    QString path = prebuilt ? assets.indexPath() : ownPath;
+    QString searchPath = prebuilt ? assets.searchPath() : ownSearchPath;
+
+    // 第一次打开大的资源库时分词和建倒排索引要很久， 不能卡住界面
+    indexPool.start(new PoolJob([this, units, stamp, reader, path, searchPath,
+                                ownPath, ownSearchPath]()
+    {
+        auto index = QSharedPointer<CorpusIndex>::create();
 
-    search(answerWords, scriptWords, 0, 0, &memo);
+        // 只有新增和改过的单元需要重新分词
+        index->load(path);
 
-    auto wordStateList = QSharedPointer<QList<WordAction>>::create();
+        bool changed = index->update(units, stamp, reader) > 0;
 
-    auto current = makeCoordinate(0, 0);
-    auto iter = memo.end();
+        if (changed)
+        {
+            index->save(ownPath);
+        }
 
-    while ((iter = memo.find(current)) != memo.end())
-    {
-        auto state = getState(*iter);
-        auto next = getNextCoordinate(*iter);
+        // 倒排索引不能增量更新， 原文有变化时整个重建
+        SearchIndex existing;
 
-        const QString* word = nullptr;
+        bool current = !changed && existing.open(searchPath)
+                && existing.unitCount() == units.size();
 
-        if (state == State::KEPT || state == State::INSERTED)
-        {
-            word = &answerWords->at(getX(current));
+        // 写之前先解除映射
+        existing.close();
 
-            wordStateList->push_back(WordAction(*word, state));
+        if (current)
+        {
+            emit corpusIndexed(index, searchPath);
+            return;
         }
-        else
+
+        // 两个索引成对写在程序自己的文件里， 下次启动直接用
+        if (!changed)
         {
-            word = &scriptWords->at(getY(current));
+            index->save(ownPath);
+        }
 
-            wordStateList->push_back(WordAction(*word, state));
+        if (!SearchIndex::build(units, reader, ownSearchPath))
+        {
+            qDebug() << "cannot build search index";
         }
 
-        current = next;
-    }
+        emit corpusIndexed(index, ownSearchPath);
+    }));
+}
 
-    if (getX(current) >= answerWords->size())
-    {
-        for (int i = getY(current), bound = scriptWords->size();
-             i < bound; ++i)
-        {
-            auto w = WordAction(scriptWords->at(i), State::REMOVED);
+void MainWindow::applyCorpus(CorpusPointer corpus, const QString& searchPath)
+{
+    this->corpus = *corpus;
 
-            wordStateList->push_back(w);
-        }
-    }
-    else if (getY(current) >= scriptWords->size())
+    if (search.open(searchPath))
     {
-        for (int i = getX(current), bound = answerWords->size();
-             i < bound; ++i)
-        {
-            auto w = WordAction(answerWords->at(i), State::INSERTED);
-
-            wordStateList->push_back(w);
-        }
+        ui->search_edit->setEnabled(true);
     }
 
-    return wordStateList;
-}
+    corpusReady = true;
 
-} //! end anonymous namespace
+    updateDifficulty();
+}
 
-void MainWindow::evaluate()
+void MainWindow::searchUnits(const QString& query)
 {
-    // 用户还没有指定音频
-    if (textFile.isEmpty())
+    if (query.trimmed().isEmpty())
     {
-        statusBar()->showMessage("resource not assigned", 2000);
+        filterUnits([](QTreeWidgetItem*) { return true; });
         return;
     }
 
-    QString script = ui->script_edit->toPlainText();
+    QSet<QString> hits;
 
-    QStringList scriptsWords = script
-            .replace(QRegExp("\\W+"), " ").toLower().split(' ');
+    for (int unit : search.search(query))
+    {
+        hits.insert(search.unitName(unit));
+    }
 
-    QString dir = QCoreApplication::applicationDirPath();
+    filterUnits([this, &hits](QTreeWidgetItem* unit)
+    {
+        return hits.contains(unitPath(unit));
+    });
 
-    QFile path(textFile);
+    // 有结果的 section 展开
+    for (int s = 0; s < ui->resource_list->topLevelItemCount(); ++s)
+    {
+        QTreeWidgetItem* section = ui->resource_list->topLevelItem(s);
 
-    // 有音频， 但是没有原文
-    if (!path.open(QIODevice::ReadOnly | QIODevice::Text))
+        for (int u = 0; u < section->childCount(); ++u)
+        {
+            if (!section->child(u)->isHidden())
+            {
+                section->setExpanded(true);
+                break;
+            }
+        }
+    }
+
+    statusBar()->showMessage(QString("%1 units found").arg(hits.size()),
+                             2000);
+}
+
+void MainWindow::updateDifficulty()
+{
+    if (!corpusReady)
     {
-        qDebug() << textFile;
-        statusBar()->showMessage("source text not found", 2000);
         return;
     }
 
-    QTextStream is(&path);
+    QHash<QString, double> difficulties = corpus.difficulties(knownWords);
 
-    QString answer = is.readAll();
+    for (int s = 0; s < ui->resource_list->topLevelItemCount(); ++s)
+    {
+        QTreeWidgetItem* section = ui->resource_list->topLevelItem(s);
 
-    QStringList asnwerWords = answer
-            .replace(QRegExp("\\W+"), " ").toLower().split(' ');
+        for (int u = 0; u < section->childCount(); ++u)
+        {
+            QTreeWidgetItem* unit = section->child(u);
 
-    // here dynamic programming...
+            // 存成数字， 排序时按大小而不是按字符串比较
+            double difficulty = difficulties.value(unitPath(unit));
 
-    auto list = search(&asnwerWords, &scriptsWords);
+            unit->setData(2, Qt::DisplayRole, qRound(difficulty * 10) / 10.0);
+        }
+    }
+}
 
-    ui->script_edit->clear();
+void MainWindow::loadKnownWords()
+{
+    QFile file(knownWordsPath());
 
-    // 下面是把编辑路线输出到QTextEdit里面
-    // 正确的单词为黑色
-    // 遗漏的单词为红色
-    // 多余的单词为蓝色
-    QTextCharFormat keptFormat;
-    keptFormat.setForeground(QBrush(Qt::GlobalColor::black));
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return;
+    }
 
-    QTextCharFormat insertedFormat;
-    insertedFormat.setForeground(QBrush(Qt::GlobalColor::red));
+    QList<QByteArray> lines = file.readAll().split('\n');
 
-    QTextCharFormat removedFormat;
-    removedFormat.setForeground(QBrush(Qt::GlobalColor::blue));
+    // 最后一段没有换行， 可能是崩溃时只写了一半
+    lines.removeLast();
 
-    for (const WordAction& s : *list)
+    for (const QByteArray& line : lines)
     {
-        switch (s.getState())
+        if (!line.isEmpty())
         {
-            case State::KEPT:
-                ui->script_edit->setCurrentCharFormat(keptFormat);
-                break;
-
-            case State::INSERTED:
-                ui->script_edit->setCurrentCharFormat(insertedFormat);
-                break;
-
-            case State::REMOVED:
-                ui->script_edit->setCurrentCharFormat(removedFormat);
-                break;
-
-            default:
-                break;
+            knownWords.insert(QString::fromUtf8(line));
         }
-
-        ui->script_edit->insertPlainText(s.getWord());
-        ui->script_edit->insertPlainText(" ");
     }
 }
 
-enum TreeItemType
-{
-    UNIT = 1,
-    SECTION
-};
-
-void MainWindow::checkResource()
+void MainWindow::saveKnownWords(const QStringList& words)
 {
-    QString path = QCoreApplication::applicationDirPath();
+    if (!autosave || words.isEmpty())
+    {
+        return;
+    }
 
-    QDir dataDirectory(path + "/english_data");
+    QFile file(knownWordsPath());
 
-    if (!dataDirectory.exists())
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append))
     {
-        qDebug() << "resource not found";
         return;
     }
 
-    QRegExp pattern("(.+)\\.mp3");
+    file.write((words.join('\n') + '\n').toUtf8());
+}
 
-    auto sectionDirectories = dataDirectory
-            .entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot);
+QString MainWindow::unitPath(QTreeWidgetItem* item) const
+{
+    return QString("%1/english_data/%2/%3")
+            .arg(QCoreApplication::applicationDirPath())
+            .arg(item->parent()->text(0))
+            .arg(item->text(0));
+}
 
-    for (auto& sectionDir : sectionDirectories)
+QTreeWidgetItem* MainWindow::findUnit(const QString& name) const
+{
+    for (int s = 0; s < ui->resource_list->topLevelItemCount(); ++s)
     {
-        const auto& sectionPath = QDir(sectionDir.absoluteFilePath());
-
-        auto section = new QTreeWidgetItem(ui->resource_list,
-                                           TreeItemType::SECTION);
-
-        section->setText(0, sectionDir.fileName());
+        QTreeWidgetItem* section = ui->resource_list->topLevelItem(s);
 
-        for (const auto& file: sectionPath.entryInfoList(QDir::Files))
+        if (!name.startsWith(section->text(0) + '/'))
         {
-            if (pattern.indexIn(file.absoluteFilePath()) != -1)
-            {
-                auto unit = new QTreeWidgetItem(section, TreeItemType::UNIT);
+            continue;
+        }
 
-                unit->setText(0, file.fileName());
+        for (int u = 0; u < section->childCount(); ++u)
+        {
+            QTreeWidgetItem* unit = section->child(u);
 
-                // no effect
-                if (!QFile(pattern.capturedTexts().at(1)).exists())
-                {
-                    unit->setText(1, "source text not fount");
-                }
+            if (section->text(0) + '/' + unit->text(0) == name)
+            {
+                return unit;
             }
         }
     }
+
+    return nullptr;
 }
 
 void MainWindow::selectResource(QTreeWidgetItem* item, int)
 {
     if (item->type() == TreeItemType::UNIT)
     {
-        QString workingDirectory = QCoreApplication::applicationDirPath();
-
         QTreeWidgetItem* section = item->parent();
 
-        QString resourcePath = QString("%1/english_data/%2/%3")
-                .arg(workingDirectory)
-                .arg(section->text(0))
-                .arg(item->text(0));
+        recorder.write(SessionEvent::SELECT, 0, 0,
+                       section->text(0) + '/' + item->text(0));
+
+        selectClock.start();
+        seekClock.invalidate();
+
+        QString resourcePath = unitPath(item);
+
+        // 上次没写完的听写接着写
+        restoreDraft(resourcePath);
+
+        QVariant packed = item->data(0, Qt::UserRole);
+
+        if (packed.isValid())
+        {
+            packUnit = packed.toInt();
+            packAnswer.reset();
+
+            player->setMedia(pack.audio(packUnit), item->text(0));
+
+            unitFile = resourcePath;
+            textFile = Prefetcher::answerPath(resourcePath);
 
-        player->setMedia(QUrl::fromLocalFile(resourcePath));
+            normalizeVolume(pack.audioHash(packUnit));
 
-        textFile = resourcePath.remove(".mp3");
+            statusBar()->showMessage("resource selected", 2000);
+            return;
+        }
+
+        packUnit = -1;
+
+        player->setMedia(section->text(0), item->text(0));
+
+        // 预取过的单元可以马上显示时长、 按帧定位， 同时开始预取后面的单元
+        if (auto prefetched = prefetcher.find(resourcePath))
+        {
+            player->setDurationHint(prefetched->info.duration);
+            player->setSeekIndex(prefetched->index);
+        }
+        else if (auto entry = assets.find(resourcePath))
+        {
+            player->setDurationHint(entry->duration);
+            player->setSeekIndex(assets.seekIndex(resourcePath));
+        }
+
+        prefetcher.touch(resourcePath);
+
+        unitFile = resourcePath;
+        textFile = Prefetcher::answerPath(resourcePath);
+
+        normalizeVolume(LoudnessAnalyzer::fileStamp(resourcePath));
 
         statusBar()->showMessage("resource selected", 2000);
 
     }
 }
 
+void MainWindow::normalizeVolume(quint64 stamp)
+{
+    double lufs = 0;
+
+    if (loudness->find(unitFile, stamp, &lufs))
+    {
+        player->setGain(normalizationGain(lufs));
+    }
+    else
+    {
+        // 还没分析到的单元先按原音量播放， 分析完再调整
+        loudness->prioritize(unitFile);
+    }
+}
+
 void MainWindow::translateWord()
 {
     static QString base("http://www.bing.com/dict/search?q=");
@@ -625,6 +941,30 @@ void MainWindow::popResourceMenu(QPoint position)
 
         resourceMenu->addSeparator();
 
+        // 后台的语料索引建好之前还没有难度
+        resourceMenu->addAction("sort by difficulty", [this]
+        {
+            this->ui->resource_list->sortItems(2, Qt::AscendingOrder);
+        })->setEnabled(corpusReady);
+
+        // 只留下不比这个单元难的
+        resourceMenu->addAction("hide harder units", [this, item]
+        {
+            double limit = item->data(2, Qt::DisplayRole).toDouble();
+
+            this->filterUnits([limit](QTreeWidgetItem* unit)
+            {
+                return unit->data(2, Qt::DisplayRole).toDouble() <= limit;
+            });
+        })->setEnabled(corpusReady);
+
+        resourceMenu->addAction("show all units", [this]
+        {
+            this->filterUnits([](QTreeWidgetItem*) { return true; });
+        });
+
+        resourceMenu->addSeparator();
+
         resourceMenu->addMenu("delete")->addAction("yes", [item]
         {
             item->parent()->removeChild(item);
@@ -634,6 +974,109 @@ void MainWindow::popResourceMenu(QPoint position)
     }
 }
 
+void MainWindow::filterUnits(const std::function<bool(QTreeWidgetItem*)>& visible)
+{
+    for (int s = 0; s < ui->resource_list->topLevelItemCount(); ++s)
+    {
+        QTreeWidgetItem* section = ui->resource_list->topLevelItem(s);
+
+        for (int u = 0; u < section->childCount(); ++u)
+        {
+            section->child(u)->setHidden(!visible(section->child(u)));
+        }
+    }
+}
+
+void MainWindow::popEditMenu(QPoint position)
+{
+    QMenu* menu = ui->script_edit->createStandardContextMenu(position);
+
+    QTextCursor cursor = ui->script_edit->cursorForPosition(position);
+    cursor.select(QTextCursor::WordUnderCursor);
+
+    QString word = cursor.selectedText();
+
+    if (!word.isEmpty() && word.at(0).isLetter()
+            && !spellChecker->isValid(word))
+    {
+        QMenu* corrections = new QMenu("suggest corrections", menu);
+
+        for (const QString& suggestion
+             : spellChecker->suggest(word, answerVocabulary()))
+        {
+            corrections->addAction(suggestion, [cursor, suggestion]() mutable
+            {
+                cursor.insertText(suggestion);
+            });
+        }
+
+        if (corrections->isEmpty())
+        {
+            corrections->addAction("no suggestions")->setEnabled(false);
+        }
+
+        menu->insertMenu(menu->actions().value(0), corrections);
+        menu->insertSeparator(menu->actions().value(1));
+    }
+
+    menu->exec(ui->script_edit->viewport()->mapToGlobal(position));
+
+    delete menu;
+}
+
+const QSet<QString>& MainWindow::answerVocabulary()
+{
+    if (vocabularyFile != textFile)
+    {
+        vocabularyFile = textFile;
+        vocabulary.clear();
+
+        QString answer;
+
+        QFile file(textFile);
+
+        if (auto prepared = currentAnswer())
+        {
+            answer = prepared->text.toLower();
+        }
+        else if (file.open(QIODevice::ReadOnly | QIODevice::Text))
+        {
+            answer = QString::fromUtf8(file.readAll()).toLower();
+        }
+
+        QRegExp pattern("\\w+");
+        int index = 0;
+
+        while ((index = pattern.indexIn(answer, index)) != -1)
+        {
+            vocabulary.insert(pattern.cap(0));
+            index += pattern.matchedLength();
+        }
+    }
+
+    return vocabulary;
+}
+
+std::shared_ptr<const Answer> MainWindow::currentAnswer()
+{
+    if (packUnit >= 0)
+    {
+        if (!packAnswer && pack.hasAnswer(packUnit))
+        {
+            packAnswer = prepare(pack.answer(packUnit));
+        }
+
+        return packAnswer;
+    }
+
+    if (auto prefetched = prefetcher.find(unitFile))
+    {
+        return prefetched->answer;
+    }
+
+    return nullptr;
+}
+
 void MainWindow::showInformation(QString name)
 {
 
@@ -651,3 +1094,232 @@ QString MainWindow::timeString() const
             .arg(total % 60, 2, 10, QChar('0'));
 }
 
+bool MainWindow::startRecording(const QString& path)
+{
+    if (!recorder.open(path))
+    {
+        return false;
+    }
+
+    // 编辑区里已有的文字作为第一次改动
+    if (!editorText.isEmpty())
+    {
+        recorder.write(SessionEvent::EDIT, 0, 0, editorText);
+    }
+
+    return true;
+}
+
+void MainWindow::setAutosave(bool enabled)
+{
+    autosave = enabled;
+
+    if (!enabled)
+    {
+        drafts->close();
+    }
+}
+
+void MainWindow::setResultCache(bool enabled)
+{
+    grader->setCacheEnabled(enabled);
+}
+
+void MainWindow::restoreDraft(const QString& unit)
+{
+    if (!autosave || (unit == unitFile && drafts->isOpen()))
+    {
+        return;
+    }
+
+    bool first = !drafts->isOpen();
+
+    QString draft = drafts->open(unit);
+
+    // 第一次选单元之前写的内容归到这个单元
+    if (first && draft.isEmpty())
+    {
+        if (!editorText.isEmpty())
+        {
+            drafts->reset(editorText);
+        }
+
+        return;
+    }
+
+    restoringDraft = true;
+
+    ui->script_edit->setPlainText(draft);
+    ui->script_edit->moveCursor(QTextCursor::End);
+
+    restoringDraft = false;
+}
+
+void MainWindow::recordEdit(int position, int removed, int added)
+{
+    QTextDocument* document = ui->script_edit->document();
+
+    // 整篇重排时通知里会多算结尾的段落分隔符
+    removed = qBound(0, removed, editorText.size() - position);
+    added = qBound(0, added, document->characterCount() - 1 - position);
+
+    QTextCursor cursor(document);
+    cursor.setPosition(position);
+    cursor.setPosition(position + added, QTextCursor::KeepAnchor);
+
+    QString text = cursor.selectedText();
+    text.replace(QChar::ParagraphSeparator, '\n');
+
+    // 高亮和格式变化也会发出通知， 文字没变的不录
+    if (removed == added
+            && editorText.midRef(position, removed) == text)
+    {
+        return;
+    }
+
+    editorText.replace(position, removed, text);
+
+    // 按键改了文档才开始量， 连续按键时从最早一次还没画出来的算起
+    if (keyPressClock.isValid())
+    {
+        if (!keystrokeClock.isValid())
+        {
+            keystrokeClock = keyPressClock;
+        }
+
+        keyPressClock.invalidate();
+    }
+
+    // 恢复草稿是一次整篇替换， 也要录下来: 重放时不开草稿， 只能靠这条还原编辑区
+    recorder.write(SessionEvent::EDIT, position, removed, text);
+
+    // 恢复出来的草稿已经在草稿日志里
+    if (restoringDraft)
+    {
+        return;
+    }
+
+    drafts->append(position, removed, text);
+}
+
+void MainWindow::replay(const SessionEvent& event)
+{
+    switch (event.type)
+    {
+        case SessionEvent::EDIT:
+        {
+            QTextDocument* document = ui->script_edit->document();
+
+            int end = document->characterCount() - 1;
+            int position = qMin<int>(event.position, end);
+
+            QTextCursor cursor(document);
+            cursor.setPosition(position);
+            cursor.setPosition(qMin<int>(position + event.removed, end),
+                               QTextCursor::KeepAnchor);
+            cursor.insertText(event.text);
+            break;
+        }
+
+        case SessionEvent::SUBMIT:
+            evaluate();
+            break;
+
+        case SessionEvent::SELECT:
+            if (QTreeWidgetItem* unit = findUnit(event.text))
+            {
+                selectResource(unit, 0);
+            }
+            break;
+
+        case SessionEvent::SEEK:
+            ui->progress_slider->setValue(event.position);
+            updateProgressBySlider();
+            break;
+    }
+}
+
+bool MainWindow::eventFilter(QObject* watched, QEvent* event)
+{
+    if (event->type() == QEvent::KeyPress && watched == ui->script_edit)
+    {
+        // Shift、 Ctrl、 方向键这些不输入文字的键不算， 要等 recordEdit 确认文档变了
+        if (!static_cast<QKeyEvent*>(event)->text().isEmpty())
+        {
+            keyPressClock.start();
+        }
+        else
+        {
+            keyPressClock.invalidate();
+        }
+    }
+    else if (event->type() == QEvent::Paint)
+    {
+        if (watched == ui->script_edit->viewport())
+        {
+            keyPressClock.invalidate();
+        }
+
+        // 高亮在处理按键时已经同步做完， 重绘开始时就带着新的格式
+        if (watched == ui->script_edit->viewport()
+                && keystrokeClock.isValid())
+        {
+            Metrics::record(Metrics::KEYSTROKE_HIGHLIGHT,
+                            keystrokeClock.nsecsElapsed());
+            keystrokeClock.invalidate();
+        }
+        else if (watched == resultView->viewport() && resultPending)
+        {
+            resultPending = false;
+
+            Metrics::record(Metrics::SUBMIT_RENDER,
+                            submitClock.nsecsElapsed());
+            submitClock.invalidate();
+        }
+    }
+
+    return QMainWindow::eventFilter(watched, event);
+}
+
+void MainWindow::toggleDiagnostics()
+{
+    int index = ui->tabWidget->indexOf(ui->diagnostics_tab);
+
+    if (index < 0)
+    {
+        ui->tabWidget->addTab(ui->diagnostics_tab, "diagnostics");
+        ui->tabWidget->setCurrentWidget(ui->diagnostics_tab);
+    }
+    else
+    {
+        ui->tabWidget->removeTab(index);
+    }
+}
+
+void MainWindow::refreshDiagnostics()
+{
+    ui->diagnostics_edit->setPlainText(Metrics::report());
+}
+
+void MainWindow::exportDiagnostics()
+{
+    QString path = QFileDialog::getSaveFileName(this, "export metrics",
+                                                "metrics.json",
+                                                "JSON (*.json)");
+
+    if (path.isEmpty())
+    {
+        return;
+    }
+
+    QSaveFile file(path);
+
+    if (!file.open(QIODevice::WriteOnly)
+            || file.write(Metrics::toJson()) < 0 || !file.commit())
+    {
+        statusBar()->showMessage("cannot write " + path, 2000);
+        return;
+    }
+
+    statusBar()->showMessage("metrics exported", 2000);
+}
@@ -1,11 +1,28 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
-#include <QMainWindow>
+#include <functional>
 
-class QMediaPlayer;
+#include <QElapsedTimer>
+#include <QMainWindow>
+#include <QSet>
+#include <QThreadPool>
+
+#include "Assessor/Grader.h"
+#include "resource/AssetManifest.h"
+#include "resource/CorpusIndex.h"
+#include "resource/Prefetcher.h"
+#include "resource/ResourcePack.h"
+#include "resource/SearchIndex.h"
+#include "session/SessionLog.h"
+
+class DraftJournal;
+class LoudnessAnalyzer;
+class Player;
+class QTimer;
 class QTreeWidgetItem;
 class QWebEngineView;
+class ResultView;
 class SpellChecker;
 
 namespace Ui {
@@ -20,6 +37,29 @@ public:
     explicit MainWindow(QWidget *parent = 0);
     ~MainWindow();
 
+    // 把之后的操作录到 path， 可以用 --replay 重放
+    bool startRecording(const QString& path);
+
+    // 重做一个录下的操作， 与用户在界面上操作走同样的路径
+    void replay(const SessionEvent& event);
+
+    // 是否把草稿自动存到每个单元的日志里， 并记下听写正确的词， 默认打开
+    void setAutosave(bool enabled);
+
+    // 是否使用评估结果的缓存， 默认打开
+    void setResultCache(bool enabled);
+
+signals:
+    // 一次评估结束， 出结果和失败都算
+    void gradingDone();
+
+    // 由后台线程发出， 语料索引和搜索索引都写好了
+    void corpusIndexed(CorpusPointer corpus, const QString& searchPath);
+
+protected:
+    // 按键、 编辑区和结果的重绘， 用来量延迟
+    bool eventFilter(QObject* watched, QEvent* event) override;
+
 private slots:    
     // 播放音频
     void start(); 
@@ -36,8 +76,14 @@ private slots:
     // 调节音量
     void updateVolume();
 
+    // 调节播放速度
+    void updateSpeed();
+
     // 评估用户提交听的写内容
     void evaluate();
+
+    // 后台评估完成后把结果显示出来
+    void showAlignment(AlignmentPointer alignment);
     
     // 根据用户的的选择更选音频
     void selectResource(QTreeWidgetItem* item, int column);
@@ -46,6 +92,15 @@ private slots:
 
     void popResourceMenu(QPoint position);
 
+    // 只显示原文包含 query 的单元， query 为空时全部显示
+    void searchUnits(const QString& query);
+
+    // 编辑区的右键菜单， 拼错的词下面附带拼写建议
+    void popEditMenu(QPoint position);
+
+    // 换上后台建好的索引， 打开搜索， 刷新难度
+    void applyCorpus(CorpusPointer corpus, const QString& searchPath);
+
 private:
     // 初始化窗口的部分属性
     void initWindow();
@@ -55,16 +110,102 @@ private:
 
     void showInformation(QString name);
 
+    // 在后台更新语料索引和搜索索引， 完成后由 applyCorpus 换上。
+    // 在这之前资源树不排序， 也不能搜索
+    void indexCorpus(const QStringList& units,
+                     const CorpusIndex::Stamp& stamp,
+                     const CorpusIndex::Reader& reader);
+
+    void updateDifficulty();
+
+    // 以前听写正确过的词， 难度要扣掉它们
+    void loadKnownWords();
+
+    // 把新掌握的词追加到文件里
+    void saveKnownWords(const QStringList& words);
+
+    // 只显示 visible 返回 true 的单元
+    void filterUnits(const std::function<bool(QTreeWidgetItem*)>& visible);
+
+    // 按当前单元的响度设置播放增益， 还没分析的先插队
+    void normalizeVolume(quint64 stamp);
+
+    // 单元对应的音频路径
+    QString unitPath(QTreeWidgetItem* item) const;
+
+    // 资源树中名为 "section/unit" 的单元
+    QTreeWidgetItem* findUnit(const QString& name) const;
+
+    // 编辑区的改动， 排除只改了格式的， 录进会话和草稿日志
+    void recordEdit(int position, int removed, int added);
+
+    // 换到 unit 的草稿
+    void restoreDraft(const QString& unit);
+
+    // 当前单元分好词的原文， 资源包里的直接从映射区域读， 否则用预取的结果
+    std::shared_ptr<const Answer> currentAnswer();
+
+    // 当前单元原文中的词 (小写)， 用来给拼写建议加权
+    const QSet<QString>& answerVocabulary();
+
     // 把音频进度转换为时间字符串
     QString timeString() const;
 
+    // 诊断页平时不显示， Ctrl+Shift+D 打开或关上
+    void toggleDiagnostics();
+
+    void refreshDiagnostics();
+
+    void exportDiagnostics();
+
 private:
     Ui::MainWindow *ui;
-    QMediaPlayer* player;
+    Player* player;
+    Grader* grader;
+    LoudnessAnalyzer* loudness;
+    DraftJournal* drafts;
+    SpellChecker* spellChecker;
     QWebEngineView* webView;
+    ResultView* resultView;
     QMenu* resourceMenu;
-    // 正在播放的音频对应的原文
+    Prefetcher prefetcher;
+    ResourcePack pack;
+    // tools/assets 预先算好的帧索引、 时长和语料索引
+    AssetManifest assets;
+    // 从资源包中选的单元， 不是时为 -1
+    int packUnit;
+    std::shared_ptr<const Answer> packAnswer;
+    // 正在播放的音频， 以及它对应的原文
+    QString unitFile;
     QString textFile;
+    // answerVocabulary 的缓存， 以及它对应的原文
+    QString vocabularyFile;
+    QSet<QString> vocabulary;
+    CorpusIndex corpus;
+    SearchIndex search;
+    // 建索引的后台线程， 任务会用到 pack 和 assets
+    QThreadPool indexPool;
+    // 索引已经从后台交回来
+    bool corpusReady;
+    // 听写正确过的词 (小写)， 启动时从文件读回
+    QSet<QString> knownWords;
+    SessionWriter recorder;
+    bool autosave;
+    // 正在把草稿放进编辑区， 这些改动不再记录
+    bool restoringDraft;
+    // 编辑区文字的副本， 用来分辨真正的改动和高亮引起的通知
+    QString editorText;
+    // 各条路径从开始到现在的时间， 不在等待时无效
+    QElapsedTimer keystrokeClock;
+    // 按下了会输入文字的键， 文档真的变了才交给 keystrokeClock
+    QElapsedTimer keyPressClock;
+    QElapsedTimer submitClock;
+    QElapsedTimer selectClock;
+    QElapsedTimer seekClock;
+    // 结果已经交给 ResultView， 还没画出来
+    bool resultPending;
+    // 诊断页显示时定时刷新
+    QTimer* diagnosticsTimer;
 };
 
 #endif // MAINWINDOW_H
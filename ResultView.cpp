@@ -0,0 +1,628 @@
+#include <algorithm>
+#include <deque>
+
+#include <QKeyEvent>
+#include <QPainter>
+#include <QScrollBar>
+
+#include "ResultView.h"
+
+namespace
+{
+
+// 文字与边框的距离
+const int MARGIN = 6;
+
+// 从某个词硬开始折行时往前多排的词数。 贪心折行几行之内就会和从头排的结果重合
+const int LOOKBACK = 256;
+
+// 硬开始的头几行可能和从头排的不同， 不用
+const int RESYNC = 2;
+
+enum PieceFlag : quint8
+{
+    WORD = 1,
+    SPACE = 2,
+    NEWLINE = 4,
+    // 两个单词之间补的空格， 不对应任何文字
+    SYNTHETIC = 8
+};
+
+// 与原来在 QTextEdit 里的颜色相同：
+// 正确的单词为黑色， 遗漏的单词为红色， 多余的单词为蓝色， 挪了位置的为橙色
+QColor actionColor(WordAction action)
+{
+    switch (action)
+    {
+        case WordAction::INSERTED:
+            return Qt::red;
+
+        case WordAction::REMOVED:
+            return Qt::blue;
+
+        case WordAction::MOVED:
+            return QColor(220, 120, 0);
+
+        default:
+            return Qt::black;
+    }
+}
+
+// Qt 5.11 起用 horizontalAdvance， width 被标为过时
+int advance(const QFontMetrics& metrics, const QString& text)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 11, 0)
+    return metrics.horizontalAdvance(text);
+#else
+    return metrics.width(text);
+#endif
+}
+
+} //! end anonymous namespace
+
+ResultView::ResultView(QWidget* parent)
+    : QAbstractScrollArea(parent)
+    , total(0)
+    , currentError(-1)
+    , layoutWidth(1)
+{
+    setFocusPolicy(Qt::StrongFocus);
+    setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+
+    viewport()->setBackgroundRole(QPalette::Base);
+
+    connect(verticalScrollBar(), &QAbstractSlider::actionTriggered,
+            this, &ResultView::snapScroll);
+
+    updateScrollBar();
+}
+
+void ResultView::setAlignment(AlignmentPointer alignment)
+{
+    this->alignment = alignment;
+
+    spans.clear();
+    errors.clear();
+    total = 0;
+    currentError = -1;
+
+    const std::vector<Run>& runs = alignment->getRuns();
+
+    bool afterWord = false;
+    // 最后一个含有单词的段
+    int lastWord = -1;
+
+    for (int i = 0, size = static_cast<int>(runs.size()); i < size; ++i)
+    {
+        const Run& run = runs[i];
+
+        if (run.action == WordAction::SKIP_INPUT || run.length == 0)
+        {
+            continue;
+        }
+
+        int span = static_cast<int>(spans.size());
+
+        spans.push_back(Span { i, total, false });
+
+        // 与 Alignment::visit 一样， 两个单词之间缺了分隔符时补一个空格
+        spans.back().spaced = afterWord && !tokenAt(span, 0).skippable;
+        afterWord = !tokenAt(span, run.length - 1).skippable;
+
+        total += run.length;
+
+        if (run.action == WordAction::INSERTED
+                || run.action == WordAction::REMOVED
+                || run.action == WordAction::MOVED)
+        {
+            // 只隔着分隔符的同类错误算一处
+            if (!errors.empty()
+                    && runs[spans[errors.back().first].run].action == run.action
+                    && lastWord <= errors.back().second)
+            {
+                errors.back().second = span;
+            }
+            else
+            {
+                errors.emplace_back(span, span);
+            }
+        }
+
+        for (int k = 0; k < run.length; ++k)
+        {
+            if (!tokenAt(span, k).skippable)
+            {
+                lastWord = span;
+                break;
+            }
+        }
+    }
+
+    spans.shrink_to_fit();
+
+    verticalScrollBar()->setValue(0);
+
+    updateScrollBar();
+
+    viewport()->update();
+
+    emit currentErrorChanged(-1, errorCount());
+}
+
+void ResultView::clear()
+{
+    alignment.reset();
+
+    spans.clear();
+    errors.clear();
+    total = 0;
+    currentError = -1;
+
+    updateScrollBar();
+
+    viewport()->update();
+}
+
+const Token& ResultView::tokenAt(int span, int token) const
+{
+    const Run& run = alignment->getRuns()[spans[span].run];
+
+    // 只有多余的词来自输入， 输入里的分隔符不显示
+    if (run.action == WordAction::REMOVED)
+    {
+        return alignment->getInputTokens()[run.inputOffset + token];
+    }
+
+    return alignment->getSourceTokens()[run.sourceOffset + token];
+}
+
+int ResultView::ordinalOf(const Place& place) const
+{
+    return place.span < static_cast<int>(spans.size())
+            ? spans[place.span].ordinal + place.token : total;
+}
+
+ResultView::Place ResultView::placeOf(int ordinal) const
+{
+    if (ordinal >= total)
+    {
+        return Place { static_cast<int>(spans.size()), 0, 0, false };
+    }
+
+    ordinal = std::max(0, ordinal);
+
+    auto it = std::upper_bound(spans.begin(), spans.end(), ordinal,
+                               [](int ordinal, const Span& span)
+    {
+        return ordinal < span.ordinal;
+    });
+
+    int span = static_cast<int>(it - spans.begin()) - 1;
+    int token = ordinal - spans[span].ordinal;
+
+    return Place { span, token, tokenAt(span, token).offset,
+                   token == 0 && spans[span].spaced };
+}
+
+bool ResultView::next(Place* place, Piece* piece) const
+{
+    static const QString space(" ");
+
+    if (place->span >= static_cast<int>(spans.size()))
+    {
+        return false;
+    }
+
+    const Run& run = alignment->getRuns()[spans[place->span].run];
+
+    if (place->space)
+    {
+        place->space = false;
+
+        *piece = Piece { space, WordAction::SKIP_SOURCE,
+                         quint8(SPACE | SYNTHETIC) };
+        return true;
+    }
+
+    const QString& text = run.action == WordAction::REMOVED
+            ? alignment->getInput() : alignment->getSource();
+    const Token& token = tokenAt(place->span, place->token);
+
+    int position = place->position;
+    int end = token.offset + token.length;
+    int after = position + 1;
+
+    quint8 flags = token.skippable ? 0 : WORD;
+
+    // 分隔符按换行、 空白和其它字符再切开， 折行只发生在空白处
+    if (text.at(position) == QLatin1Char('\n'))
+    {
+        flags |= NEWLINE;
+    }
+    else
+    {
+        bool blank = text.at(position).isSpace();
+
+        while (after < end && text.at(after) != QLatin1Char('\n')
+               && text.at(after).isSpace() == blank)
+        {
+            ++after;
+        }
+
+        flags |= blank ? SPACE : 0;
+    }
+
+    *piece = Piece { QString::fromRawData(text.constData() + position,
+                                          after - position),
+                     run.action, flags };
+
+    if (after < end)
+    {
+        place->position = after;
+    }
+    else if (place->token + 1 < run.length)
+    {
+        ++place->token;
+        place->position = tokenAt(place->span, place->token).offset;
+    }
+    else
+    {
+        *place = placeOf(spans[place->span].ordinal + run.length);
+    }
+
+    return true;
+}
+
+void ResultView::wrap(Place place,
+                      const std::function<bool(const Place&)>& visit) const
+{
+    if (!visit(place))
+    {
+        return;
+    }
+
+    QFontMetrics metrics(font());
+
+    int x = 0;
+    quint8 previous = 0;
+    Piece piece;
+
+    for (Place start = place; next(&place, &piece); start = place)
+    {
+        quint8 flags = piece.flags;
+
+        if (flags & NEWLINE)
+        {
+            previous = flags;
+            x = 0;
+
+            if (!visit(place))
+            {
+                return;
+            }
+
+            continue;
+        }
+
+        // 标点跟着前面的单词走， 除非前面是空白
+        bool breakable = (flags & (SPACE | WORD)) || (previous & SPACE);
+        int width = advance(metrics, piece.text);
+
+        previous = flags;
+
+        if (x > 0 && x + width > layoutWidth && breakable)
+        {
+            x = 0;
+
+            if (!visit(start))
+            {
+                return;
+            }
+        }
+
+        // 行首的空白不占位置， paintEvent 里也一样跳过
+        if (x == 0 && (flags & SPACE))
+        {
+            continue;
+        }
+
+        x += width;
+    }
+}
+
+std::vector<ResultView::Place> ResultView::linesBefore(int ordinal,
+                                                        int count) const
+{
+    std::deque<Place> starts;
+
+    for (int lookback = LOOKBACK; ; lookback *= 2)
+    {
+        int first = std::max(0, ordinal - lookback);
+        int seen = 0;
+
+        starts.clear();
+
+        wrap(placeOf(first), [&](const Place& start)
+        {
+            if (ordinalOf(start) > ordinal)
+            {
+                return false;
+            }
+
+            starts.push_back(start);
+            ++seen;
+
+            if (static_cast<int>(starts.size()) > count)
+            {
+                starts.pop_front();
+            }
+
+            return true;
+        });
+
+        if (first == 0 || seen > count + RESYNC)
+        {
+            return std::vector<Place>(starts.begin(), starts.end());
+        }
+    }
+}
+
+int ResultView::pageLines() const
+{
+    return std::max(1, viewport()->height() / fontMetrics().lineSpacing());
+}
+
+void ResultView::updateScrollBar()
+{
+    layoutWidth = std::max(1, viewport()->width() - 2 * MARGIN);
+
+    // 最后一页排满时第一行的位置
+    int last = 0;
+
+    if (total > 0)
+    {
+        last = ordinalOf(linesBefore(total - 1, pageLines()).front());
+    }
+
+    // 滚动条的值不变时 scrollContentsBy 不会被调用， 这里排一次
+    verticalScrollBar()->setRange(0, last);
+
+    layoutWindow();
+}
+
+void ResultView::layoutWindow()
+{
+    lines.clear();
+
+    if (total == 0)
+    {
+        return;
+    }
+
+    // 最下面一行可能只露出一部分
+    int rows = pageLines() + 1;
+
+    wrap(linesBefore(verticalScrollBar()->value(), 1).back(),
+         [&](const Place& start)
+    {
+        lines.push_back(start);
+
+        return static_cast<int>(lines.size()) <= rows;
+    });
+
+    if (static_cast<int>(lines.size()) <= rows)
+    {
+        lines.push_back(placeOf(total));
+    }
+
+    // 滚轮按词数滚动， 一步大约一行
+    int words = ordinalOf(lines.back()) - ordinalOf(lines.front());
+
+    verticalScrollBar()->setPageStep(std::max(1, words));
+    verticalScrollBar()->setSingleStep(std::max(1, words / rows));
+}
+
+void ResultView::scrollContentsBy(int, int)
+{
+    layoutWindow();
+
+    viewport()->update();
+}
+
+void ResultView::snapScroll(int action)
+{
+    if (lines.size() < 2)
+    {
+        return;
+    }
+
+    QScrollBar* bar = verticalScrollBar();
+
+    int value = bar->value();
+    int top = ordinalOf(lines.front());
+
+    // 可见的第 count 行或之后第一个真正往前走的行首
+    auto below = [&](int count)
+    {
+        for (int i = std::min<int>(count, static_cast<int>(lines.size()) - 1);
+             i < static_cast<int>(lines.size()); ++i)
+        {
+            if (ordinalOf(lines[i]) > value)
+            {
+                return ordinalOf(lines[i]);
+            }
+        }
+
+        return value + 1;
+    };
+
+    // 顶行之前的第 count 行
+    auto above = [&](int count)
+    {
+        return top == 0 ? 0 : ordinalOf(linesBefore(top - 1, count).front());
+    };
+
+    switch (action)
+    {
+        case QAbstractSlider::SliderSingleStepAdd:
+            bar->setSliderPosition(below(1));
+            break;
+
+        case QAbstractSlider::SliderSingleStepSub:
+            bar->setSliderPosition(above(1));
+            break;
+
+        case QAbstractSlider::SliderPageStepAdd:
+            bar->setSliderPosition(below(pageLines()));
+            break;
+
+        case QAbstractSlider::SliderPageStepSub:
+            bar->setSliderPosition(above(pageLines()));
+            break;
+
+        default:
+            break;
+    }
+}
+
+void ResultView::nextError()
+{
+    if (errors.empty())
+    {
+        emit currentErrorChanged(-1, 0);
+        return;
+    }
+
+    showError((currentError + 1) % errorCount());
+}
+
+void ResultView::previousError()
+{
+    if (errors.empty())
+    {
+        emit currentErrorChanged(-1, 0);
+        return;
+    }
+
+    showError(currentError <= 0 ? errorCount() - 1 : currentError - 1);
+}
+
+void ResultView::showError(int index)
+{
+    currentError = index;
+
+    int target = spans[errors[index].first].ordinal;
+    int rows = pageLines();
+
+    // 不在视野内时滚到中间
+    if (lines.empty() || target < ordinalOf(lines.front())
+            || target >= ordinalOf(lines[std::min<int>(
+                                       rows, static_cast<int>(lines.size()) - 1)]))
+    {
+        verticalScrollBar()->setValue(
+                    ordinalOf(linesBefore(target, rows / 2 + 1).front()));
+    }
+
+    viewport()->update();
+
+    emit currentErrorChanged(index, errorCount());
+}
+
+void ResultView::paintEvent(QPaintEvent*)
+{
+    if (!alignment)
+    {
+        return;
+    }
+
+    QPainter painter(viewport());
+    painter.setFont(font());
+
+    QFontMetrics metrics(font());
+
+    int lineHeight = metrics.lineSpacing();
+
+    std::pair<int, int> highlighted(-1, -2);
+
+    if (currentError >= 0)
+    {
+        highlighted = errors[currentError];
+    }
+
+    QColor highlight(255, 230, 150);
+    Piece piece;
+
+    for (int line = 0; line + 1 < static_cast<int>(lines.size()); ++line)
+    {
+        int top = line * lineHeight;
+        int baseline = top + metrics.ascent();
+        int x = MARGIN;
+
+        for (Place place = lines[line]; place != lines[line + 1]; )
+        {
+            int span = place.span;
+
+            if (!next(&place, &piece) || (piece.flags & NEWLINE))
+            {
+                break;
+            }
+
+            if ((piece.flags & SPACE) && x == MARGIN)
+            {
+                continue;
+            }
+
+            int width = advance(metrics, piece.text);
+
+            // 错误第一段前面补的空格不算在错误里
+            if (span >= highlighted.first && span <= highlighted.second
+                    && !(span == highlighted.first
+                         && (piece.flags & SYNTHETIC)))
+            {
+                painter.fillRect(x, top, width, lineHeight, highlight);
+            }
+
+            if (!(piece.flags & SPACE))
+            {
+                painter.setPen(actionColor(piece.action));
+                painter.drawText(x, baseline, piece.text);
+            }
+
+            x += width;
+        }
+    }
+}
+
+void ResultView::resizeEvent(QResizeEvent* event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+
+    // 滚动条的值是词的序号， 宽度变了顶部的内容也不会动
+    updateScrollBar();
+}
+
+void ResultView::keyPressEvent(QKeyEvent* event)
+{
+    if (event->matches(QKeySequence::FindNext))
+    {
+        nextError();
+    }
+    else if (event->matches(QKeySequence::FindPrevious))
+    {
+        previousError();
+    }
+    else
+    {
+        QAbstractScrollArea::keyPressEvent(event);
+    }
+}
+
+void ResultView::changeEvent(QEvent* event)
+{
+    if (event->type() == QEvent::FontChange)
+    {
+        updateScrollBar();
+    }
+
+    QAbstractScrollArea::changeEvent(event);
+}
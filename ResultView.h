@@ -0,0 +1,134 @@
+#ifndef RESULTVIEW_H
+#define RESULTVIEW_H
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include <QAbstractScrollArea>
+
+#include "Assessor/Grader.h"
+
+// 显示评估结果。 只保存对齐结果和每段的起点， 滚动条的单位是词。
+// 折行直接从分段和词算， 只缓存可见的几行， 长文章滚动和缩放都不会变慢
+class ResultView : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    explicit ResultView(QWidget* parent = nullptr);
+
+    void setAlignment(AlignmentPointer alignment);
+
+    void clear();
+
+    // 遗漏和多余的段数
+    int errorCount() const
+    {
+        return static_cast<int>(errors.size());
+    }
+
+public slots:
+    // 滚动到下一处 (上一处) 错误并高亮， 到头后回绕
+    void nextError();
+
+    void previousError();
+
+signals:
+    // index 从 0 开始， 没有错误时为 -1
+    void currentErrorChanged(int index, int count);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+
+    void resizeEvent(QResizeEvent* event) override;
+
+    void keyPressEvent(QKeyEvent* event) override;
+
+    void changeEvent(QEvent* event) override;
+
+    void scrollContentsBy(int dx, int dy) override;
+
+private slots:
+    // 按行和按页滚动时对齐到行首
+    void snapScroll(int action);
+
+private:
+    // 要显示的一段， 对应 Alignment 中的一个 Run
+    struct Span
+    {
+        int run;
+        // 第一个词在显示顺序中的序号
+        int ordinal;
+        // 与前一段之间缺了分隔符， 补一个空格
+        bool spaced;
+    };
+
+    // 显示顺序中的一个位置
+    struct Place
+    {
+        int span;
+        // 在这一段中的第几个词
+        int token;
+        // 在原文或输入中的位置
+        int position;
+        // 补的空格还没排
+        bool space;
+
+        bool operator!=(const Place& other) const
+        {
+            return span != other.span || token != other.token
+                    || position != other.position || space != other.space;
+        }
+    };
+
+    // 折行的最小单位： 一个单词、 一串空白、 一串标点或一个换行
+    struct Piece
+    {
+        QString text;
+        WordAction action;
+        quint8 flags;
+    };
+
+    const Token& tokenAt(int span, int token) const;
+
+    int ordinalOf(const Place& place) const;
+
+    // 第 ordinal 个词的开头
+    Place placeOf(int ordinal) const;
+
+    // 取出 place 处的片段并前进， 到结尾时返回 false
+    bool next(Place* place, Piece* piece) const;
+
+    // 把 place 当作行首往后折行， 依次交出每行的行首， visit 返回 false 时停下
+    void wrap(Place place,
+              const std::function<bool(const Place&)>& visit) const;
+
+    // 第 ordinal 个词所在的行和它前面的行， 最多 count 行
+    std::vector<Place> linesBefore(int ordinal, int count) const;
+
+    // 宽度、 高度或字体变化后重新算滚动范围和可见的行
+    void updateScrollBar();
+
+    // 从滚动条的位置开始排可见的几行
+    void layoutWindow();
+
+    // 可以完整显示的行数
+    int pageLines() const;
+
+    void showError(int index);
+
+private:
+    AlignmentPointer alignment;
+    std::vector<Span> spans;
+    // 显示的词数
+    int total;
+    // 可见的每行行首， 最后多一个作为结尾
+    std::vector<Place> lines;
+    // 每处错误的第一段和最后一段
+    std::vector<std::pair<int, int>> errors;
+    int currentError;
+    int layoutWidth;
+};
+
+#endif // RESULTVIEW_H
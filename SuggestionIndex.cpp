@@ -0,0 +1,418 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <tuple>
+#include <vector>
+
+#include <QHash>
+#include <QSaveFile>
+
+#include "SuggestionIndex.h"
+
+struct SuggestionIndex::Header
+{
+    char magic[4];
+    quint32 version;
+    quint32 wordCount;
+    quint32 entryCount;
+    quint32 poolSize;
+    quint32 maxDistance;
+    quint32 prefixLength;
+    quint32 reserved;
+};
+
+struct SuggestionIndex::Entry
+{
+    quint32 hash;
+    quint32 word;
+};
+
+namespace
+{
+
+const char MAGIC[4] = { 'L', 'S', 'I', '1' };
+const quint32 VERSION = 1;
+
+// SymSpell 的默认取值: 两次编辑以内， 只索引前 7 个字符
+const int MAX_DISTANCE = 2;
+const int PREFIX_LENGTH = 7;
+
+// FNV-1a， 直接对 UTF-16 编码单元计算
+quint32 hash(const QString& text)
+{
+    quint32 h = 2166136261u;
+
+    for (QChar c : text)
+    {
+        h = (h ^ c.unicode()) * 16777619u;
+    }
+
+    return h;
+}
+
+// 删掉至多 distance 个字符得到的全部变体
+void deletes(const QString& word, int distance, QSet<QString>* variants)
+{
+    for (int i = 0; i < word.size(); ++i)
+    {
+        QString variant = word;
+        variant.remove(i, 1);
+
+        if (!variants->contains(variant))
+        {
+            variants->insert(variant);
+
+            if (distance > 1)
+            {
+                deletes(variant, distance - 1, variants);
+            }
+        }
+    }
+}
+
+QSet<QString> variantsOf(const QString& word, int distance, int prefixLength)
+{
+    QString prefix = word.left(prefixLength);
+
+    QSet<QString> variants;
+    variants.insert(prefix);
+
+    deletes(prefix, distance, &variants);
+
+    return variants;
+}
+
+} //! end anonymous namespace
+
+SuggestionIndex::SuggestionIndex()
+    : header(nullptr)
+    , offsets(nullptr)
+    , entries(nullptr)
+    , pool(nullptr)
+{
+}
+
+SuggestionIndex::~SuggestionIndex()
+{
+    close();
+}
+
+bool SuggestionIndex::open(const QString& path)
+{
+    close();
+
+    file.setFileName(path);
+
+    if (!file.open(QIODevice::ReadOnly)
+            || file.size() < qint64(sizeof(Header)))
+    {
+        file.close();
+        return false;
+    }
+
+    const uchar* data = file.map(0, file.size());
+
+    if (!data)
+    {
+        file.close();
+        return false;
+    }
+
+    auto candidate = reinterpret_cast<const Header*>(data);
+
+    qint64 expected = sizeof(Header)
+            + qint64(candidate->wordCount) * sizeof(quint32)
+            + qint64(candidate->entryCount) * sizeof(Entry)
+            + candidate->poolSize;
+
+    // 删除的变体随距离指数增长， 不接受比建索引时更大的距离
+    if (std::memcmp(candidate->magic, MAGIC, sizeof(MAGIC)) != 0
+            || candidate->version != VERSION
+            || candidate->maxDistance > quint32(MAX_DISTANCE)
+            || expected != file.size())
+    {
+        file.close();
+        return false;
+    }
+
+    const uchar* cursor = data + sizeof(Header);
+
+    auto offsetTable = reinterpret_cast<const quint32*>(cursor);
+    cursor += candidate->wordCount * sizeof(quint32);
+
+    auto entryTable = reinterpret_cast<const Entry*>(cursor);
+    cursor += candidate->entryCount * sizeof(Entry);
+
+    auto words = reinterpret_cast<const char*>(cursor);
+
+    // 词池以 '\0' 结尾， 偏移和词序号都在范围内， 查询时读不出界
+    bool valid = candidate->wordCount == 0
+            || (candidate->poolSize > 0
+                && words[candidate->poolSize - 1] == '\0');
+
+    for (quint32 i = 0; valid && i < candidate->wordCount; ++i)
+    {
+        valid = offsetTable[i] < candidate->poolSize;
+    }
+
+    for (quint32 i = 0; valid && i < candidate->entryCount; ++i)
+    {
+        valid = entryTable[i].word < candidate->wordCount;
+    }
+
+    if (!valid)
+    {
+        file.close();
+        return false;
+    }
+
+    header = candidate;
+    offsets = offsetTable;
+    entries = entryTable;
+    pool = words;
+
+    return true;
+}
+
+void SuggestionIndex::close()
+{
+    file.close();
+
+    header = nullptr;
+    offsets = nullptr;
+    entries = nullptr;
+    pool = nullptr;
+}
+
+QString SuggestionIndex::word(quint32 index) const
+{
+    return QString::fromUtf8(pool + offsets[index]);
+}
+
+int SuggestionIndex::distance(const QString& lhs, const QString& rhs,
+                              int bound)
+{
+    int n = lhs.size();
+    int m = rhs.size();
+
+    if (std::abs(n - m) > bound)
+    {
+        return bound + 1;
+    }
+
+    // 只保留三行: 上上行用于相邻交换
+    std::vector<int> before(m + 1);
+    std::vector<int> previous(m + 1);
+    std::vector<int> current(m + 1);
+
+    for (int j = 0; j <= m; ++j)
+    {
+        previous[j] = j;
+    }
+
+    for (int i = 1; i <= n; ++i)
+    {
+        current[0] = i;
+
+        int best = current[0];
+
+        for (int j = 1; j <= m; ++j)
+        {
+            int cost = lhs[i - 1] == rhs[j - 1] ? 0 : 1;
+
+            current[j] = std::min({ previous[j] + 1,
+                                    current[j - 1] + 1,
+                                    previous[j - 1] + cost });
+
+            if (i > 1 && j > 1
+                    && lhs[i - 1] == rhs[j - 2] && lhs[i - 2] == rhs[j - 1])
+            {
+                current[j] = std::min(current[j], before[j - 2] + 1);
+            }
+
+            best = std::min(best, current[j]);
+        }
+
+        if (best > bound)
+        {
+            return bound + 1;
+        }
+
+        std::swap(before, previous);
+        std::swap(previous, current);
+    }
+
+    return std::min(previous[m], bound + 1);
+}
+
+QStringList SuggestionIndex::suggest(const QString& word,
+                                     const QSet<QString>& boosted,
+                                     int limit) const
+{
+    struct Candidate
+    {
+        QString word;
+        int distance;
+        bool boosted;
+    };
+
+    QString query = word.toLower();
+
+    int bound = header ? header->maxDistance : MAX_DISTANCE;
+
+    QHash<QString, Candidate> found;
+
+    if (header)
+    {
+        QSet<quint32> seen;
+
+        auto less = [](const Entry& entry, quint32 h) { return entry.hash < h; };
+
+        for (const QString& variant
+             : variantsOf(query, bound, header->prefixLength))
+        {
+            quint32 h = hash(variant);
+
+            for (const Entry* entry = std::lower_bound(
+                     entries, entries + header->entryCount, h, less);
+                 entry != entries + header->entryCount && entry->hash == h;
+                 ++entry)
+            {
+                if (seen.contains(entry->word))
+                {
+                    continue;
+                }
+
+                seen.insert(entry->word);
+
+                // 哈希碰撞和前缀截断带来的假候选在这里过滤掉
+                QString candidate = this->word(entry->word);
+                int d = distance(query, candidate, bound);
+
+                if (d > 0 && d <= bound)
+                {
+                    found.insert(candidate, Candidate {
+                                     candidate, d,
+                                     boosted.contains(candidate) });
+                }
+            }
+        }
+    }
+
+    // 本单元原文里的词不一定在词典中 (人名等)， 直接比较
+    for (const QString& vocabulary : boosted)
+    {
+        int d = distance(query, vocabulary, bound);
+
+        if (d > 0 && d <= bound)
+        {
+            found.insert(vocabulary, Candidate { vocabulary, d, true });
+        }
+    }
+
+    std::vector<Candidate> ranked(found.cbegin(), found.cend());
+
+    auto key = [&](const Candidate& c)
+    {
+        return std::make_tuple(2 * c.distance - (c.boosted ? 1 : 0),
+                               std::abs(c.word.size() - query.size()),
+                               c.word);
+    };
+
+    std::sort(ranked.begin(), ranked.end(),
+              [&](const Candidate& lhs, const Candidate& rhs)
+    {
+        return key(lhs) < key(rhs);
+    });
+
+    bool capitalized = !word.isEmpty() && word.at(0).isUpper();
+
+    QStringList result;
+
+    for (const Candidate& c : ranked)
+    {
+        if (result.size() >= limit)
+        {
+            break;
+        }
+
+        QString suggestion = c.word;
+
+        if (capitalized && !suggestion.isEmpty())
+        {
+            suggestion[0] = suggestion.at(0).toUpper();
+        }
+
+        result.push_back(suggestion);
+    }
+
+    return result;
+}
+
+bool SuggestionIndex::build(const QStringList& words, const QString& path)
+{
+    QStringList lower;
+
+    for (const QString& word : words)
+    {
+        lower.push_back(word.toLower());
+    }
+
+    lower.sort();
+    lower.removeDuplicates();
+    lower.removeAll(QString());
+
+    QByteArray words8;
+    std::vector<quint32> offsets;
+    std::vector<Entry> entries;
+
+    for (int i = 0; i < lower.size(); ++i)
+    {
+        offsets.push_back(words8.size());
+
+        words8.append(lower[i].toUtf8());
+        words8.append('\0');
+
+        for (const QString& variant
+             : variantsOf(lower[i], MAX_DISTANCE, PREFIX_LENGTH))
+        {
+            entries.push_back(Entry { hash(variant), quint32(i) });
+        }
+    }
+
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry& lhs, const Entry& rhs)
+    {
+        return std::tie(lhs.hash, lhs.word) < std::tie(rhs.hash, rhs.word);
+    });
+
+    Header header;
+
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.wordCount = offsets.size();
+    header.entryCount = entries.size();
+    header.poolSize = words8.size();
+    header.maxDistance = MAX_DISTANCE;
+    header.prefixLength = PREFIX_LENGTH;
+    header.reserved = 0;
+
+    // 运行中的程序映射着旧文件， 不能原地截断， 写好后再换上
+    QSaveFile out(path);
+
+    if (!out.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    auto write = [&](const void* data, qint64 size)
+    {
+        return out.write(static_cast<const char*>(data), size) == size;
+    };
+
+    return write(&header, sizeof(header))
+            && write(offsets.data(), offsets.size() * sizeof(quint32))
+            && write(entries.data(), entries.size() * sizeof(Entry))
+            && write(words8.constData(), words8.size())
+            && out.commit();
+}
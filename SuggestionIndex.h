@@ -0,0 +1,59 @@
+#ifndef SUGGESTIONINDEX_H
+#define SUGGESTIONINDEX_H
+
+#include <QFile>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+// SymSpell 风格的删除索引: 预先把每个词 (前 prefixLength 个字符)
+// 删掉至多 maxDistance 个字符后的所有变体记下来， 查询时只需对输入做同样的删除，
+// 命中的候选再用真实的编辑距离过滤。 文件通过 mmap 直接使用。
+//
+// 文件布局 (本机字节序):
+//   Header
+//   quint32 offsets[wordCount]       每个词在 pool 中的偏移
+//   Entry   entries[entryCount]      (变体哈希, 词序号)， 按哈希排序
+//   char    pool[poolSize]           小写的 UTF-8 词， 以 '\0' 结尾
+class SuggestionIndex
+{
+public:
+    SuggestionIndex();
+
+    ~SuggestionIndex();
+
+    bool open(const QString& path);
+
+    void close();
+
+    bool isOpen() const
+    {
+        return header != nullptr;
+    }
+
+    // 按 (编辑距离, 是否在 boosted 中, 长度差, 字母序) 排好的候选,
+    // boosted 里的词相当于少半次编辑。 输入首字母大写时候选也首字母大写
+    QStringList suggest(const QString& word, const QSet<QString>& boosted,
+                        int limit) const;
+
+    static bool build(const QStringList& words, const QString& path);
+
+    // 限制了上界的 Damerau-Levenshtein 距离 (只算相邻交换),
+    // 超过 bound 时返回 bound + 1
+    static int distance(const QString& lhs, const QString& rhs, int bound);
+
+private:
+    struct Header;
+    struct Entry;
+
+    QString word(quint32 index) const;
+
+private:
+    QFile file;
+    const Header* header;
+    const quint32* offsets;
+    const Entry* entries;
+    const char* pool;
+};
+
+#endif // SUGGESTIONINDEX_H
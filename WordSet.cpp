@@ -0,0 +1,397 @@
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <QSaveFile>
+
+#include "WordSet.h"
+
+struct WordSet::Header
+{
+    char magic[4];
+    quint32 version;
+    quint32 count;
+    quint32 buckets;
+    quint32 bloomWords;
+    quint32 bloomHashes;
+    quint32 poolSize;
+    quint32 reserved;
+};
+
+namespace
+{
+
+const char MAGIC[4] = { 'L', 'W', 'S', '1' };
+const quint32 VERSION = 1;
+
+// Bloom 过滤器每个词占的位数和哈希次数， 误判率约 1%
+const int BLOOM_BITS_PER_WORD = 10;
+const int BLOOM_HASHES = 7;
+
+// 完美哈希每个桶平均的词数
+const int WORDS_PER_BUCKET = 4;
+
+// FNV-1a 加一轮混合， seed 不同得到互相独立的哈希
+quint64 hash(const char* data, int length, quint64 seed)
+{
+    quint64 h = 14695981039346656037ULL ^ (seed * 0x9E3779B97F4A7C15ULL);
+
+    for (int i = 0; i < length; ++i)
+    {
+        h ^= static_cast<uchar>(data[i]);
+        h *= 1099511628211ULL;
+    }
+
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+
+    return h;
+}
+
+quint64 rotate(quint64 value)
+{
+    return (value << 32) | (value >> 32);
+}
+
+// 纯 ASCII 的短词直接编码到栈上， 避免一次分配
+const int STACK_WORD = 64;
+
+} //! end anonymous namespace
+
+WordSet::WordSet()
+    : header(nullptr)
+    , bloom(nullptr)
+    , displacements(nullptr)
+    , slots(nullptr)
+    , pool(nullptr)
+{
+}
+
+WordSet::~WordSet()
+{
+    close();
+}
+
+bool WordSet::open(const QString& path)
+{
+    close();
+
+    file.setFileName(path);
+
+    if (!file.open(QIODevice::ReadOnly)
+            || file.size() < qint64(sizeof(Header)))
+    {
+        file.close();
+        return false;
+    }
+
+    const uchar* data = file.map(0, file.size());
+
+    if (!data)
+    {
+        file.close();
+        return false;
+    }
+
+    auto candidate = reinterpret_cast<const Header*>(data);
+
+    qint64 expected = sizeof(Header)
+            + qint64(candidate->bloomWords) * sizeof(quint64)
+            + qint64(candidate->buckets) * sizeof(quint32)
+            + qint64(candidate->count) * sizeof(quint32)
+            + candidate->poolSize;
+
+    if (std::memcmp(candidate->magic, MAGIC, sizeof(MAGIC)) != 0
+            || candidate->version != VERSION
+            || candidate->bloomWords == 0
+            || (candidate->bloomWords & (candidate->bloomWords - 1)) != 0
+            || candidate->buckets == 0
+            || expected != file.size())
+    {
+        file.close();
+        return false;
+    }
+
+    const uchar* cursor = data + sizeof(Header);
+
+    auto bloomTable = reinterpret_cast<const quint64*>(cursor);
+    cursor += candidate->bloomWords * sizeof(quint64);
+
+    auto displacementTable = reinterpret_cast<const quint32*>(cursor);
+    cursor += candidate->buckets * sizeof(quint32);
+
+    auto slotTable = reinterpret_cast<const quint32*>(cursor);
+    cursor += candidate->count * sizeof(quint32);
+
+    auto words = reinterpret_cast<const char*>(cursor);
+
+    // 词池以 '\0' 结尾， 每个位置都指向词池里面， 查找时读不出界
+    bool valid = candidate->count == 0
+            || (candidate->poolSize > 0
+                && words[candidate->poolSize - 1] == '\0');
+
+    for (quint32 i = 0; valid && i < candidate->count; ++i)
+    {
+        valid = slotTable[i] < candidate->poolSize;
+    }
+
+    if (!valid)
+    {
+        file.close();
+        return false;
+    }
+
+    header = candidate;
+    bloom = bloomTable;
+    displacements = displacementTable;
+    slots = slotTable;
+    pool = words;
+
+    return true;
+}
+
+void WordSet::close()
+{
+    // QFile::close 会解除映射
+    file.close();
+
+    header = nullptr;
+    bloom = nullptr;
+    displacements = nullptr;
+    slots = nullptr;
+    pool = nullptr;
+}
+
+int WordSet::size() const
+{
+    return header ? static_cast<int>(header->count) : 0;
+}
+
+bool WordSet::mayContain(quint64 first, quint64 second) const
+{
+    quint64 bits = quint64(header->bloomWords) * 64;
+
+    for (quint32 i = 0; i < header->bloomHashes; ++i)
+    {
+        quint64 bit = (first + i * second) & (bits - 1);
+
+        if (!(bloom[bit / 64] & (quint64(1) << (bit % 64))))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool WordSet::contains(const char* utf8, int length) const
+{
+    if (!header || header->count == 0)
+    {
+        return false;
+    }
+
+    quint64 base = hash(utf8, length, 0);
+
+    if (!mayContain(base, rotate(base) | 1))
+    {
+        return false;
+    }
+
+    quint32 displacement = displacements[base % header->buckets];
+    quint32 slot = hash(utf8, length, displacement) % header->count;
+
+    // 查询的词里可能有 '\0'， 先保证比较不会越过词池的结尾
+    if (quint64(slots[slot]) + length >= header->poolSize)
+    {
+        return false;
+    }
+
+    const char* word = pool + slots[slot];
+
+    return std::memcmp(word, utf8, length) == 0 && word[length] == '\0';
+}
+
+bool WordSet::contains(const QString& word) const
+{
+    if (word.size() <= STACK_WORD)
+    {
+        char buffer[STACK_WORD];
+        int length = 0;
+
+        for (QChar c : word)
+        {
+            if (c.unicode() >= 0x80)
+            {
+                break;
+            }
+
+            buffer[length++] = static_cast<char>(c.unicode());
+        }
+
+        if (length == word.size())
+        {
+            return contains(buffer, length);
+        }
+    }
+
+    QByteArray utf8 = word.toUtf8();
+
+    return contains(utf8.constData(), utf8.size());
+}
+
+bool WordSet::build(QStringList words, const QString& path)
+{
+    words.sort();
+    words.removeDuplicates();
+    words.removeAll(QString());
+
+    quint32 count = words.size();
+
+    // 词池， 按排序后的顺序
+    QByteArray words8;
+    std::vector<quint32> offsets;
+    std::vector<quint64> bases;
+
+    offsets.reserve(count);
+    bases.reserve(count);
+
+    for (const QString& word : words)
+    {
+        QByteArray utf8 = word.toUtf8();
+
+        offsets.push_back(words8.size());
+        bases.push_back(hash(utf8.constData(), utf8.size(), 0));
+
+        words8.append(utf8);
+        words8.append('\0');
+    }
+
+    quint32 bloomWords = 1;
+
+    while (bloomWords * 64 < count * BLOOM_BITS_PER_WORD)
+    {
+        bloomWords *= 2;
+    }
+
+    quint32 buckets = std::max<quint32>(1, count / WORDS_PER_BUCKET);
+
+    std::vector<quint64> bloom(bloomWords);
+    std::vector<quint32> displacements(buckets);
+    std::vector<quint32> slots(count);
+
+    quint64 bits = quint64(bloomWords) * 64;
+
+    for (quint64 base : bases)
+    {
+        quint64 second = rotate(base) | 1;
+
+        for (int i = 0; i < BLOOM_HASHES; ++i)
+        {
+            quint64 bit = (base + i * second) & (bits - 1);
+
+            bloom[bit / 64] |= quint64(1) << (bit % 64);
+        }
+    }
+
+    // hash-and-displace: 大桶先放， 为每个桶找一个让所有词都落在空位上的位移
+    std::vector<std::vector<quint32>> members(buckets);
+
+    for (quint32 i = 0; i < count; ++i)
+    {
+        members[bases[i] % buckets].push_back(i);
+    }
+
+    std::vector<quint32> order(buckets);
+
+    for (quint32 b = 0; b < buckets; ++b)
+    {
+        order[b] = b;
+    }
+
+    std::stable_sort(order.begin(), order.end(), [&](quint32 lhs, quint32 rhs)
+    {
+        return members[lhs].size() > members[rhs].size();
+    });
+
+    std::vector<bool> taken(count);
+    std::vector<quint32> candidate;
+
+    for (quint32 b : order)
+    {
+        if (members[b].empty())
+        {
+            break;
+        }
+
+        for (quint32 displacement = 1; ; ++displacement)
+        {
+            candidate.clear();
+
+            bool fits = true;
+
+            for (quint32 i : members[b])
+            {
+                const char* word = words8.constData() + offsets[i];
+
+                quint32 slot = hash(word, std::strlen(word), displacement)
+                        % count;
+
+                if (taken[slot] || std::find(candidate.begin(),
+                                             candidate.end(), slot)
+                        != candidate.end())
+                {
+                    fits = false;
+                    break;
+                }
+
+                candidate.push_back(slot);
+            }
+
+            if (fits)
+            {
+                for (size_t k = 0; k < candidate.size(); ++k)
+                {
+                    taken[candidate[k]] = true;
+                    slots[candidate[k]] = offsets[members[b][k]];
+                }
+
+                displacements[b] = displacement;
+                break;
+            }
+        }
+    }
+
+    Header header;
+
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.count = count;
+    header.buckets = buckets;
+    header.bloomWords = bloomWords;
+    header.bloomHashes = BLOOM_HASHES;
+    header.poolSize = words8.size();
+    header.reserved = 0;
+
+    // 运行中的程序映射着旧文件， 不能原地截断， 写好后再换上
+    QSaveFile out(path);
+
+    if (!out.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    auto write = [&](const void* data, qint64 size)
+    {
+        return out.write(static_cast<const char*>(data), size) == size;
+    };
+
+    return write(&header, sizeof(header))
+            && write(bloom.data(), bloom.size() * sizeof(quint64))
+            && write(displacements.data(),
+                     displacements.size() * sizeof(quint32))
+            && write(slots.data(), slots.size() * sizeof(quint32))
+            && write(words8.constData(), words8.size())
+            && out.commit();
+}
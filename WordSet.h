@@ -0,0 +1,56 @@
+#ifndef WORDSET_H
+#define WORDSET_H
+
+#include <QFile>
+#include <QString>
+#include <QStringList>
+
+// 预先展开的合法词形集合， 文件通过 mmap 直接使用， 不需要解析。
+//
+// 文件布局 (本机字节序):
+//   Header
+//   quint64 bloom[bloomWords]        Bloom 过滤器， 先挡掉大部分不存在的词
+//   quint32 displacements[buckets]   完美哈希每个桶的位移
+//   quint32 slots[count]             每个位置上的词在 pool 中的偏移
+//   char    pool[poolSize]           排好序的 UTF-8 词， 以 '\0' 结尾
+class WordSet
+{
+public:
+    WordSet();
+
+    ~WordSet();
+
+    bool open(const QString& path);
+
+    void close();
+
+    bool isOpen() const
+    {
+        return header != nullptr;
+    }
+
+    int size() const;
+
+    // 区分大小写的精确查找
+    bool contains(const QString& word) const;
+
+    bool contains(const char* utf8, int length) const;
+
+    // 把 words 去重排序后写成 path
+    static bool build(QStringList words, const QString& path);
+
+private:
+    struct Header;
+
+    bool mayContain(quint64 first, quint64 second) const;
+
+private:
+    QFile file;
+    const Header* header;
+    const quint64* bloom;
+    const quint32* displacements;
+    const quint32* slots;
+    const char* pool;
+};
+
+#endif // WORDSET_H
@@ -0,0 +1,27 @@
+#ifndef POOLJOB_H
+#define POOLJOB_H
+
+#include <functional>
+#include <utility>
+
+#include <QRunnable>
+
+// 交给 QThreadPool 运行的一个函数， 运行完由线程池删除
+class PoolJob : public QRunnable
+{
+public:
+    explicit PoolJob(std::function<void()> work)
+        : work(std::move(work))
+    {
+    }
+
+    void run() override
+    {
+        work();
+    }
+
+private:
+    std::function<void()> work;
+};
+
+#endif // POOLJOB_H
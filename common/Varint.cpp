@@ -0,0 +1,60 @@
+#include "Varint.h"
+
+void writeNumber(QByteArray* out, quint32 value)
+{
+    while (value >= 0x80)
+    {
+        out->append(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+
+    out->append(static_cast<char>(value));
+}
+
+bool readNumber(const uchar** cursor, const uchar* end, quint32* value)
+{
+    *value = 0;
+
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        if (*cursor == end)
+        {
+            return false;
+        }
+
+        uchar byte = *(*cursor)++;
+
+        *value |= quint32(byte & 0x7F) << shift;
+
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void writeText(QByteArray* out, const QString& text)
+{
+    QByteArray utf8 = text.toUtf8();
+
+    writeNumber(out, static_cast<quint32>(utf8.size()));
+    out->append(utf8);
+}
+
+bool readText(const uchar** cursor, const uchar* end, QString* text)
+{
+    quint32 size = 0;
+
+    if (!readNumber(cursor, end, &size) || size > quint32(end - *cursor))
+    {
+        return false;
+    }
+
+    *text = QString::fromUtf8(reinterpret_cast<const char*>(*cursor),
+                              static_cast<int>(size));
+    *cursor += size;
+
+    return true;
+}
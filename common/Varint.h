@@ -0,0 +1,19 @@
+#ifndef VARINT_H
+#define VARINT_H
+
+#include <QByteArray>
+#include <QString>
+
+// 各种缓存和日志共用的变长编码。
+// 数字每字节 7 位， 最高位表示后面还有； 文字是 UTF-8， 前面带字节数
+
+void writeNumber(QByteArray* out, quint32 value);
+
+// 数据不完整或超过 32 位时返回 false， cursor 不会越过 end
+bool readNumber(const uchar** cursor, const uchar* end, quint32* value);
+
+void writeText(QByteArray* out, const QString& text);
+
+bool readText(const uchar** cursor, const uchar* end, QString* text);
+
+#endif // VARINT_H
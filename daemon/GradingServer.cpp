@@ -0,0 +1,412 @@
+#include <QCryptographicHash>
+#include <QFile>
+#include <QFileInfo>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QRunnable>
+#include <QTextStream>
+
+#include "Assessor/Assessor.h"
+#include "GradingServer.h"
+
+namespace
+{
+
+// 收到第一个请求后再等这么久， 让同时到达的请求凑成一批
+const int BATCH_WINDOW = 2;
+
+// 常驻的原文个数
+const size_t ANSWER_CACHE_SIZE = 256;
+
+// tokens 中 [first, first + count) 的字符范围， count 为 0 时是 first 处的插入点
+void characters(const std::vector<Token>& tokens, int first, int count,
+                int textSize, quint32* start, quint32* length)
+{
+    if (count == 0 || first >= static_cast<int>(tokens.size()))
+    {
+        *start = first < static_cast<int>(tokens.size())
+                ? tokens[first].offset : textSize;
+        *length = 0;
+        return;
+    }
+
+    const Token& last = tokens[first + count - 1];
+
+    *start = tokens[first].offset;
+    *length = last.offset + last.length - tokens[first].offset;
+}
+
+Protocol::Range rangeOf(const Alignment& alignment, const Run& run)
+{
+    bool source = run.action == WordAction::KEPT
+            || run.action == WordAction::INSERTED
+            || run.action == WordAction::SKIP_SOURCE
+            || run.action == WordAction::MOVED;
+    bool input = run.action == WordAction::KEPT
+            || run.action == WordAction::REMOVED
+            || run.action == WordAction::SKIP_INPUT;
+
+    Protocol::Range range {};
+
+    characters(alignment.getSourceTokens(), run.sourceOffset,
+               source ? run.length : 0, alignment.getSource().size(),
+               &range.sourceStart, &range.sourceLength);
+    characters(alignment.getInputTokens(), run.inputOffset,
+               input ? run.length : 0, alignment.getInput().size(),
+               &range.inputStart, &range.inputLength);
+
+    return range;
+}
+
+class BatchJob : public QRunnable
+{
+public:
+    struct Item
+    {
+        quint64 client;
+        Protocol::Request request;
+    };
+
+    BatchJob(GradingServer* server, QList<Item> items)
+        : server(server)
+        , items(items)
+    {
+    }
+
+    void run() override
+    {
+        // 同一批里的请求原文相同， 只准备一次
+        auto answer = server->answerFor(items.front().request);
+
+        for (const Item& item : items)
+        {
+            Protocol::Result result {};
+
+            result.id = item.request.id;
+
+            if (!answer)
+            {
+                result.status = Protocol::ANSWER_NOT_FOUND;
+            }
+            else
+            {
+                Alignment alignment = assess(*answer, &item.request.input);
+
+                result.status = Protocol::OK;
+                result.kept = alignment.countWords(WordAction::KEPT);
+                result.inserted = alignment.countWords(WordAction::INSERTED);
+                result.removed = alignment.countWords(WordAction::REMOVED);
+                result.moved = alignment.countWords(WordAction::MOVED);
+                result.misspelled = server->countMisspelled(alignment);
+                result.runs = alignment.getRuns();
+
+                for (const Run& run : result.runs)
+                {
+                    result.ranges.push_back(rangeOf(alignment, run));
+                }
+            }
+
+            emit server->replied(item.client, Protocol::encode(result));
+        }
+    }
+
+private:
+    GradingServer* server;
+    QList<Item> items;
+};
+
+} //! end anonymous namespace
+
+GradingServer::GradingServer(QObject* parent)
+    : QObject(parent)
+    , server(new QLocalServer(this))
+    , nextClient(0)
+{
+    batchTimer.setSingleShot(true);
+    batchTimer.setInterval(BATCH_WINDOW);
+
+    connect(&batchTimer, &QTimer::timeout, this, &GradingServer::flush);
+
+    connect(server, &QLocalServer::newConnection,
+            this, &GradingServer::onConnection);
+
+    connect(this, &GradingServer::replied,
+            this, &GradingServer::onReplied, Qt::QueuedConnection);
+}
+
+GradingServer::~GradingServer()
+{
+    pool.waitForDone();
+}
+
+bool GradingServer::listen(const QString& name)
+{
+    // 上次异常退出时留下的 socket 文件
+    QLocalServer::removeServer(name);
+
+    // 只有同一个用户能连上来
+    server->setSocketOptions(QLocalServer::UserAccessOption);
+
+    return server->listen(name);
+}
+
+void GradingServer::setDataRoot(const QString& directory)
+{
+    dataRoot = QFileInfo(directory).canonicalFilePath();
+}
+
+bool GradingServer::resolve(QString* path) const
+{
+    // 解析掉 .. 和符号链接之后再比较
+    QString canonical = QFileInfo(*path).canonicalFilePath();
+    QString prefix = dataRoot.endsWith('/') ? dataRoot : dataRoot + '/';
+
+    if (dataRoot.isEmpty() || canonical.isEmpty()
+            || !canonical.startsWith(prefix))
+    {
+        return false;
+    }
+
+    *path = canonical;
+
+    return true;
+}
+
+QString GradingServer::errorString() const
+{
+    return server->errorString();
+}
+
+QString GradingServer::answerKey(const Protocol::Request& request)
+{
+    if (request.type == Protocol::GRADE_FILE)
+    {
+        return "file:" + QFileInfo(request.answer).absoluteFilePath();
+    }
+
+    return "text:" + QString::fromLatin1(QCryptographicHash::hash(
+                request.answer.toUtf8(), QCryptographicHash::Sha1).toHex());
+}
+
+std::shared_ptr<const Answer> GradingServer::answerFor(
+        const Protocol::Request& request)
+{
+    QString key = answerKey(request);
+    QDateTime modified;
+
+    if (request.type == Protocol::GRADE_FILE)
+    {
+        QFileInfo info(request.answer);
+
+        if (!info.isFile())
+        {
+            return nullptr;
+        }
+
+        modified = info.lastModified();
+    }
+
+    {
+        QMutexLocker locker(&answerMutex);
+
+        for (auto it = answers.begin(); it != answers.end(); ++it)
+        {
+            if (it->key == key && it->modified == modified)
+            {
+                answers.splice(answers.begin(), answers, it);
+                return it->answer;
+            }
+        }
+    }
+
+    // 分词不持锁， 两个线程同时准备同一个原文也只是多做一次
+    std::shared_ptr<const Answer> answer;
+
+    if (request.type == Protocol::GRADE_FILE)
+    {
+        QFile file(request.answer);
+
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        {
+            return nullptr;
+        }
+
+        QTextStream is(&file);
+
+        answer = prepare(is.readAll());
+    }
+    else
+    {
+        answer = prepare(request.answer);
+    }
+
+    QMutexLocker locker(&answerMutex);
+
+    answers.remove_if([&](const CachedAnswer& cached)
+    {
+        return cached.key == key;
+    });
+
+    answers.push_front(CachedAnswer { key, modified, answer });
+
+    if (answers.size() > ANSWER_CACHE_SIZE)
+    {
+        answers.pop_back();
+    }
+
+    return answer;
+}
+
+quint32 GradingServer::countMisspelled(const Alignment& alignment)
+{
+    const QString& input = alignment.getInput();
+    quint32 count = 0;
+
+    for (const Token& token : alignment.getInputTokens())
+    {
+        if (token.skippable || !input.at(token.offset).isLetter())
+        {
+            continue;
+        }
+
+        QString word = input.mid(token.offset, token.length);
+
+        // 词形集合是只读的映射， 大部分词在这里就查到了， 不用排队
+        if (spellChecker.isCommon(word))
+        {
+            continue;
+        }
+
+        QMutexLocker locker(&spellMutex);
+
+        if (!spellChecker.isValid(word))
+        {
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+void GradingServer::onConnection()
+{
+    while (QLocalSocket* socket = server->nextPendingConnection())
+    {
+        quint64 id = nextClient++;
+
+        clients.insert(id, Client { socket, QByteArray() });
+
+        socket->setProperty("client", id);
+
+        connect(socket, &QLocalSocket::readyRead,
+                this, &GradingServer::onReadyRead);
+
+        connect(socket, &QLocalSocket::disconnected,
+                this, &GradingServer::onDisconnected);
+    }
+}
+
+void GradingServer::onReadyRead()
+{
+    auto socket = qobject_cast<QLocalSocket*>(sender());
+    quint64 id = socket->property("client").toULongLong();
+
+    auto it = clients.find(id);
+
+    if (it == clients.end())
+    {
+        return;
+    }
+
+    it->buffer.append(socket->readAll());
+
+    QByteArray frame;
+    bool broken = false;
+
+    while (Protocol::takeFrame(&it->buffer, &frame, &broken))
+    {
+        Protocol::Request request;
+
+        if (!Protocol::decode(frame, &request))
+        {
+            Protocol::Result result {};
+
+            result.status = Protocol::BAD_REQUEST;
+
+            socket->write(Protocol::encode(result));
+            continue;
+        }
+
+        // 客户端不能让服务读数据目录以外的文件
+        if (request.type == Protocol::GRADE_FILE && !resolve(&request.answer))
+        {
+            Protocol::Result result {};
+
+            result.id = request.id;
+            result.status = Protocol::FORBIDDEN;
+
+            socket->write(Protocol::encode(result));
+            continue;
+        }
+
+        pending.append(Pending { id, request });
+    }
+
+    // 长度都不对， 后面的数据已经无法分帧
+    if (broken)
+    {
+        socket->disconnectFromServer();
+        return;
+    }
+
+    if (!pending.isEmpty() && !batchTimer.isActive())
+    {
+        batchTimer.start();
+    }
+}
+
+void GradingServer::onDisconnected()
+{
+    auto socket = qobject_cast<QLocalSocket*>(sender());
+
+    clients.remove(socket->property("client").toULongLong());
+
+    socket->deleteLater();
+}
+
+void GradingServer::onReplied(quint64 client, const QByteArray& frame)
+{
+    auto it = clients.find(client);
+
+    // 客户端在评分期间断开了
+    if (it != clients.end())
+    {
+        it->socket->write(frame);
+    }
+}
+
+void GradingServer::flush()
+{
+    // 保持每组内的到达顺序
+    QHash<QString, QList<BatchJob::Item>> groups;
+    QStringList order;
+
+    for (const Pending& item : pending)
+    {
+        QString key = answerKey(item.request);
+
+        if (!groups.contains(key))
+        {
+            order.append(key);
+        }
+
+        groups[key].append(BatchJob::Item { item.client, item.request });
+    }
+
+    pending.clear();
+
+    for (const QString& key : order)
+    {
+        pool.start(new BatchJob(this, groups.value(key)));
+    }
+}
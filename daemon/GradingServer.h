@@ -0,0 +1,105 @@
+#ifndef GRADINGSERVER_H
+#define GRADINGSERVER_H
+
+#include <list>
+#include <memory>
+
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QThreadPool>
+#include <QTimer>
+
+#include "Dictionary.h"
+#include "Protocol.h"
+
+class QLocalServer;
+class QLocalSocket;
+struct Answer;
+
+// 常驻的评分服务。 原文分词结果和词典一直留在内存里，
+// 一个批次窗口内收到的请求按原文分组， 每组在线程池里只准备一次原文
+class GradingServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit GradingServer(QObject* parent = nullptr);
+
+    ~GradingServer();
+
+    bool listen(const QString& name);
+
+    QString errorString() const;
+
+    // GRADE_FILE 只能读这个目录下的原文， 没有设置时一律拒绝
+    void setDataRoot(const QString& directory);
+
+    // 在工作线程中调用， 找不到原文时返回空
+    std::shared_ptr<const Answer> answerFor(const Protocol::Request& request);
+
+    // 输入中拼错的单词数， 在工作线程中调用
+    quint32 countMisspelled(const Alignment& alignment);
+
+signals:
+    // 由工作线程发出， 排队到服务线程里写回
+    void replied(quint64 client, const QByteArray& frame);
+
+private slots:
+    void onConnection();
+
+    void onReadyRead();
+
+    void onDisconnected();
+
+    void onReplied(quint64 client, const QByteArray& frame);
+
+    // 把积攒的请求按原文分组交给线程池
+    void flush();
+
+private:
+    struct Client
+    {
+        QLocalSocket* socket;
+        QByteArray buffer;
+    };
+
+    struct Pending
+    {
+        quint64 client;
+        Protocol::Request request;
+    };
+
+    struct CachedAnswer
+    {
+        QString key;
+        QDateTime modified;
+        std::shared_ptr<const Answer> answer;
+    };
+
+    static QString answerKey(const Protocol::Request& request);
+
+    // path 在数据目录下时换成规范路径并返回 true
+    bool resolve(QString* path) const;
+
+private:
+    QLocalServer* server;
+    // 规范化的数据目录
+    QString dataRoot;
+    QThreadPool pool;
+    QTimer batchTimer;
+    quint64 nextClient;
+    QHash<quint64, Client> clients;
+    QList<Pending> pending;
+
+    // 最近用过的原文在前
+    QMutex answerMutex;
+    std::list<CachedAnswer> answers;
+
+    // hunspell 不是线程安全的
+    QMutex spellMutex;
+    SpellChecker spellChecker;
+};
+
+#endif // GRADINGSERVER_H
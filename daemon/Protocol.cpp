@@ -0,0 +1,160 @@
+#include <QDataStream>
+#include <QtEndian>
+
+#include "Protocol.h"
+
+namespace Protocol
+{
+
+namespace
+{
+
+const QDataStream::Version STREAM_VERSION = QDataStream::Qt_5_0;
+
+QByteArray frame(Type type, const QByteArray& payload)
+{
+    QByteArray result(4, '\0');
+
+    qToBigEndian<quint32>(payload.size() + 1,
+                          reinterpret_cast<uchar*>(result.data()));
+
+    result.append(static_cast<char>(type));
+    result.append(payload);
+
+    return result;
+}
+
+} //! end anonymous namespace
+
+QByteArray encode(const Request& request)
+{
+    QByteArray payload;
+    QDataStream os(&payload, QIODevice::WriteOnly);
+    os.setVersion(STREAM_VERSION);
+
+    os << request.id << request.answer << request.input;
+
+    return frame(request.type, payload);
+}
+
+QByteArray encode(const Result& result)
+{
+    QByteArray payload;
+    QDataStream os(&payload, QIODevice::WriteOnly);
+    os.setVersion(STREAM_VERSION);
+
+    os << result.id << static_cast<quint8>(result.status)
+       << result.kept << result.inserted << result.removed
+       << result.moved << result.misspelled << static_cast<quint32>(result.runs.size());
+
+    for (size_t i = 0; i < result.runs.size(); ++i)
+    {
+        const Run& run = result.runs[i];
+        Range range = i < result.ranges.size() ? result.ranges[i] : Range {};
+
+        os << static_cast<quint8>(run.action)
+           << static_cast<quint32>(run.sourceOffset)
+           << static_cast<quint32>(run.inputOffset)
+           << static_cast<quint32>(run.length)
+           << range.sourceStart << range.sourceLength
+           << range.inputStart << range.inputLength;
+    }
+
+    return frame(RESULT, payload);
+}
+
+bool takeFrame(QByteArray* buffer, QByteArray* frame, bool* broken)
+{
+    *broken = false;
+
+    if (buffer->size() < 4)
+    {
+        return false;
+    }
+
+    quint32 length = qFromBigEndian<quint32>(
+                reinterpret_cast<const uchar*>(buffer->constData()));
+
+    if (length == 0 || length > MAX_FRAME)
+    {
+        *broken = true;
+        return false;
+    }
+
+    if (quint32(buffer->size()) - 4 < length)
+    {
+        return false;
+    }
+
+    *frame = buffer->mid(4, length);
+    buffer->remove(0, 4 + length);
+
+    return true;
+}
+
+bool decode(const QByteArray& frame, Request* request)
+{
+    if (frame.isEmpty())
+    {
+        return false;
+    }
+
+    quint8 type = static_cast<quint8>(frame.at(0));
+
+    if (type != GRADE_FILE && type != GRADE_TEXT)
+    {
+        return false;
+    }
+
+    QDataStream is(frame.mid(1));
+    is.setVersion(STREAM_VERSION);
+
+    request->type = static_cast<Type>(type);
+
+    is >> request->id >> request->answer >> request->input;
+
+    return is.status() == QDataStream::Ok;
+}
+
+bool decode(const QByteArray& frame, Result* result)
+{
+    if (frame.isEmpty() || static_cast<quint8>(frame.at(0)) != RESULT)
+    {
+        return false;
+    }
+
+    QDataStream is(frame.mid(1));
+    is.setVersion(STREAM_VERSION);
+
+    quint8 status = 0;
+    quint32 count = 0;
+
+    is >> result->id >> status >> result->kept >> result->inserted
+       >> result->removed >> result->moved >> result->misspelled >> count;
+
+    result->status = static_cast<Status>(status);
+    result->runs.clear();
+    result->ranges.clear();
+
+    for (quint32 i = 0; i < count && is.status() == QDataStream::Ok; ++i)
+    {
+        quint8 action = 0;
+        quint32 sourceOffset = 0;
+        quint32 inputOffset = 0;
+        quint32 length = 0;
+        Range range {};
+
+        is >> action >> sourceOffset >> inputOffset >> length
+           >> range.sourceStart >> range.sourceLength
+           >> range.inputStart >> range.inputLength;
+
+        result->runs.push_back(Run { static_cast<WordAction>(action),
+                                     int(sourceOffset), int(inputOffset),
+                                     int(length) });
+        result->ranges.push_back(range);
+    }
+
+    return is.status() == QDataStream::Ok;
+}
+
+} //! end namespace Protocol
@@ -0,0 +1,91 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <vector>
+
+#include <QByteArray>
+#include <QString>
+
+#include "Assessor/Alignment.h"
+
+// 评分服务的二进制协议。 每个帧是
+//   quint32 length   (不含自身， 大端)
+//   quint8  type
+//   payload          QDataStream 编码
+// 同一个连接上可以连续发多个请求， 响应带着请求号， 不保证按顺序返回
+namespace Protocol
+{
+
+const char DEFAULT_SERVER[] = "learner-grader";
+
+// 单帧上限， 防止坏数据让服务端无限缓存
+const quint32 MAX_FRAME = 64 * 1024 * 1024;
+
+enum Type : quint8
+{
+    // 原文给文件路径， 服务端缓存分好词的结果
+    GRADE_FILE = 1,
+    // 原文直接放在请求里
+    GRADE_TEXT = 2,
+    RESULT = 0x81
+};
+
+enum Status : quint8
+{
+    OK = 0,
+    ANSWER_NOT_FOUND = 1,
+    BAD_REQUEST = 2,
+    // GRADE_FILE 的路径不在服务的数据目录下
+    FORBIDDEN = 3
+};
+
+struct Request
+{
+    Type type;
+    quint32 id;
+    // GRADE_FILE 时是路径， GRADE_TEXT 时是原文
+    QString answer;
+    QString input;
+};
+
+// 一段在原文和输入中的字符范围 (UTF-16 下标)， 其它语言的客户端不用分词就能标出差异。
+// 只涉及一侧的段， 另一侧长度为 0， 位置是那一侧的插入点
+struct Range
+{
+    quint32 sourceStart;
+    quint32 sourceLength;
+    quint32 inputStart;
+    quint32 inputLength;
+};
+
+struct Result
+{
+    quint32 id;
+    Status status;
+    quint32 kept;
+    quint32 inserted;
+    quint32 removed;
+    // 挪了位置的词， 不再计入 inserted 和 removed
+    quint32 moved;
+    // 输入中拼错的词
+    quint32 misspelled;
+    // 词号表示的分段， 与 ranges 一一对应
+    std::vector<Run> runs;
+    std::vector<Range> ranges;
+};
+
+QByteArray encode(const Request& request);
+
+QByteArray encode(const Result& result);
+
+// 从 buffer 开头取出一个完整的帧 (去掉长度)， 数据不够时返回 false。
+// 长度非法时把 *broken 置为 true
+bool takeFrame(QByteArray* buffer, QByteArray* frame, bool* broken);
+
+bool decode(const QByteArray& frame, Request* request);
+
+bool decode(const QByteArray& frame, Result* result);
+
+} //! end namespace Protocol
+
+#endif // PROTOCOL_H
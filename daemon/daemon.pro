@@ -0,0 +1,45 @@
+#-------------------------------------------------
+#
+# 常驻的评分服务， 其它前端通过 QLocalSocket 提交听写
+#
+#-------------------------------------------------
+
+QT       += core network
+QT       -= gui
+
+CONFIG += c++14 console
+CONFIG -= app_bundle
+
+TARGET = grader
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+INCLUDEPATH += ..
+
+SOURCES += main.cpp \
+    GradingServer.cpp \
+    Protocol.cpp \
+    ../Assessor/Alignment.cpp \
+    ../Assessor/Assessor.cpp \
+    ../Assessor/ResultCache.cpp \
+    ../Assessor/Tokenizer.cpp \
+    ../common/Varint.cpp \
+    ../Dictionary.cpp \
+    ../SuggestionIndex.cpp \
+    ../WordSet.cpp
+
+HEADERS  += \
+    GradingServer.h \
+    Protocol.h \
+    ../Assessor/Alignment.h \
+    ../Assessor/Assessor.h \
+    ../Assessor/ResultCache.h \
+    ../Assessor/Tokenizer.h \
+    ../Assessor/WordAction.h \
+    ../common/Varint.h \
+    ../Dictionary.h \
+    ../SuggestionIndex.h \
+    ../WordSet.h
+
+LIBS += -lhunspell
@@ -0,0 +1,31 @@
+#include <QCoreApplication>
+#include <QDebug>
+
+#include "GradingServer.h"
+
+// 用法: grader [服务名] [数据目录]
+// 客户端用 QLocalSocket 连接同名的服务， 协议见 Protocol.h。
+// 按路径评分时原文必须在数据目录下， 默认是程序所在的目录
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QStringList arguments = a.arguments();
+    QString name = arguments.size() > 1 ? arguments[1]
+                                         : Protocol::DEFAULT_SERVER;
+
+    GradingServer server;
+
+    server.setDataRoot(arguments.size() > 2 ? arguments[2]
+                                            : a.applicationDirPath());
+
+    if (!server.listen(name))
+    {
+        qWarning() << "cannot listen on" << name << ":" << server.errorString();
+        return 1;
+    }
+
+    qDebug() << "grading on" << name;
+
+    return a.exec();
+}
@@ -0,0 +1,664 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <deque>
+#include <new>
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSysInfo>
+#include <QThread>
+#include <QtAlgorithms>
+
+#if defined(Q_OS_WIN)
+#include <malloc.h>
+#elif defined(Q_OS_MAC)
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+
+#include "Metrics.h"
+
+namespace
+{
+
+// 2^SUB_BITS == SUB_BUCKETS
+const int SUB_BITS = 4;
+
+// 超过 2^MAX_MAGNITUDE 微秒 (约 36 分钟) 的都算进最后一个桶
+const int MAX_MAGNITUDE = 31;
+
+const int BUCKET_COUNT = (MAX_MAGNITUDE - SUB_BITS + 2) * Metrics::SUB_BUCKETS;
+
+// 保留最近这么多次评估
+const size_t MAX_GRADINGS = 64;
+
+int bucketOf(quint64 microseconds)
+{
+    quint64 value = qMin(microseconds, (quint64(1) << (MAX_MAGNITUDE + 1)) - 1);
+
+    if (value < quint64(Metrics::SUB_BUCKETS))
+    {
+        return static_cast<int>(value);
+    }
+
+    int top = 63 - qCountLeadingZeroBits(value);
+    int shift = top - SUB_BITS;
+
+    return (shift + 1) * Metrics::SUB_BUCKETS
+            + static_cast<int>(value >> shift) - Metrics::SUB_BUCKETS;
+}
+
+size_t usableSize(void* pointer)
+{
+#if defined(Q_OS_WIN)
+    return _msize(pointer);
+#elif defined(Q_OS_MAC)
+    return malloc_size(pointer);
+#else
+    return malloc_usable_size(pointer);
+#endif
+}
+
+struct AllocationSlot
+{
+    std::atomic<bool> busy;
+    AllocationSlot* next;
+    std::atomic<quint64> allocations;
+    std::atomic<quint64> bytes;
+    std::atomic<quint64> freed;
+    // 评估开始时的占用和之后的峰值， epoch 不是当前评估的就作废
+    std::atomic<quint32> epoch;
+    std::atomic<qint64> base;
+    std::atomic<qint64> peak;
+};
+
+struct LatencySlot
+{
+    std::atomic<bool> busy;
+    LatencySlot* next;
+    std::atomic<quint64> counts[Metrics::LATENCY_COUNT][BUCKET_COUNT];
+    std::atomic<quint64> sums[Metrics::LATENCY_COUNT];
+    std::atomic<quint64> maxima[Metrics::LATENCY_COUNT];
+};
+
+// 每个线程一个槽， 只有这个线程写。 槽只挂上链表不摘下来，
+// 线程退出时标成空闲， 留给以后的线程接着累加， 读的时候顺着链表加起来。
+// 槽用 calloc 分配， operator new 里用到它也不会递归
+template<typename T>
+class SlotList
+{
+public:
+    // 线程退出时还回去以后 (其他线程局部对象析构时) 返回 nullptr
+    T* local()
+    {
+        struct Holder
+        {
+            T* slot;
+            int state;
+        };
+
+        struct Release
+        {
+            Holder* holder;
+
+            ~Release()
+            {
+                holder->slot->busy.store(false, std::memory_order_release);
+                holder->slot = nullptr;
+                holder->state = RELEASED;
+            }
+        };
+
+        thread_local Holder holder { nullptr, FRESH };
+
+        if (holder.state == FRESH)
+        {
+            holder.slot = acquire();
+            holder.state = holder.slot ? ACTIVE : RELEASED;
+
+            if (holder.slot)
+            {
+                thread_local Release release { &holder };
+                Q_UNUSED(release);
+            }
+        }
+
+        return holder.slot;
+    }
+
+    template<typename Visitor>
+    void visit(Visitor visitor) const
+    {
+        for (T* slot = head.load(std::memory_order_acquire); slot;
+             slot = slot->next)
+        {
+            visitor(*slot);
+        }
+    }
+
+private:
+    enum State
+    {
+        FRESH,
+        ACTIVE,
+        RELEASED
+    };
+
+    T* acquire()
+    {
+        for (T* slot = head.load(std::memory_order_acquire); slot;
+             slot = slot->next)
+        {
+            bool expected = false;
+
+            if (!slot->busy.load(std::memory_order_relaxed)
+                    && slot->busy.compare_exchange_strong(expected, true))
+            {
+                return slot;
+            }
+        }
+
+        void* memory = std::calloc(1, sizeof(T));
+
+        if (!memory)
+        {
+            return nullptr;
+        }
+
+        T* slot = new (memory) T();
+
+        slot->busy.store(true, std::memory_order_relaxed);
+        slot->next = head.load(std::memory_order_relaxed);
+
+        while (!head.compare_exchange_weak(slot->next, slot,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed))
+        {
+        }
+
+        return slot;
+    }
+
+private:
+    std::atomic<T*> head { nullptr };
+};
+
+SlotList<AllocationSlot> allocationSlots;
+SlotList<LatencySlot> latencySlots;
+
+// 已经还了槽的线程 (退出途中) 共用这一个
+AllocationSlot orphanAllocations;
+
+// 每次评估加一
+std::atomic<quint32> gradingEpoch { 0 };
+
+QMutex gradingMutex;
+bool grading = false;
+quint64 gradingAllocations = 0;
+quint64 gradingBytes = 0;
+std::deque<Metrics::Grading> history;
+
+void countAllocation(void* pointer)
+{
+    AllocationSlot* slot = allocationSlots.local();
+    bool shared = slot == nullptr;
+
+    if (shared)
+    {
+        slot = &orphanAllocations;
+    }
+
+    qint64 size = static_cast<qint64>(usableSize(pointer));
+
+    slot->allocations.fetch_add(1, std::memory_order_relaxed);
+
+    quint64 bytes = slot->bytes.fetch_add(size, std::memory_order_relaxed)
+            + size;
+
+    if (shared)
+    {
+        return;
+    }
+
+    // 别的线程释放这个线程分配的内存时， 这里的占用会偏大， 峰值因此是上界
+    qint64 live = static_cast<qint64>(
+                bytes - slot->freed.load(std::memory_order_relaxed));
+
+    quint32 epoch = gradingEpoch.load(std::memory_order_relaxed);
+
+    if (slot->epoch.load(std::memory_order_relaxed) != epoch)
+    {
+        slot->base.store(live - size, std::memory_order_relaxed);
+        slot->peak.store(live, std::memory_order_relaxed);
+        slot->epoch.store(epoch, std::memory_order_relaxed);
+    }
+    else if (live > slot->peak.load(std::memory_order_relaxed))
+    {
+        slot->peak.store(live, std::memory_order_relaxed);
+    }
+}
+
+void countFree(void* pointer)
+{
+    AllocationSlot* slot = allocationSlots.local();
+
+    if (slot == nullptr)
+    {
+        slot = &orphanAllocations;
+    }
+
+    slot->freed.fetch_add(usableSize(pointer), std::memory_order_relaxed);
+}
+
+void* allocate(std::size_t size)
+{
+    void* pointer = nullptr;
+
+    while ((pointer = std::malloc(size ? size : 1)) == nullptr)
+    {
+        std::new_handler handler = std::get_new_handler();
+
+        if (!handler)
+        {
+            throw std::bad_alloc();
+        }
+
+        handler();
+    }
+
+    countAllocation(pointer);
+
+    return pointer;
+}
+
+void release(void* pointer)
+{
+    if (pointer)
+    {
+        countFree(pointer);
+        std::free(pointer);
+    }
+}
+
+void sumAllocations(quint64* count, quint64* bytes)
+{
+    *count = orphanAllocations.allocations.load(std::memory_order_relaxed);
+    *bytes = orphanAllocations.bytes.load(std::memory_order_relaxed);
+
+    allocationSlots.visit([&](const AllocationSlot& slot)
+    {
+        *count += slot.allocations.load(std::memory_order_relaxed);
+        *bytes += slot.bytes.load(std::memory_order_relaxed);
+    });
+}
+
+} //! end anonymous namespace
+
+double Metrics::Histogram::mean() const
+{
+    return total > 0 ? double(sum) / total : 0.0;
+}
+
+quint64 Metrics::Histogram::percentile(double p) const
+{
+    if (total == 0)
+    {
+        return 0;
+    }
+
+    quint64 rank = qMax<quint64>(1, static_cast<quint64>(p * total + 0.5));
+    quint64 seen = 0;
+
+    for (int bucket = 0; bucket < static_cast<int>(counts.size()); ++bucket)
+    {
+        seen += counts[bucket];
+
+        if (seen >= rank)
+        {
+            return qMin(bucketFloor(bucket + 1) - 1, max);
+        }
+    }
+
+    return max;
+}
+
+quint64 Metrics::bucketFloor(int bucket)
+{
+    if (bucket < SUB_BUCKETS)
+    {
+        return static_cast<quint64>(bucket);
+    }
+
+    int shift = bucket / SUB_BUCKETS - 1;
+
+    return quint64(bucket % SUB_BUCKETS + SUB_BUCKETS) << shift;
+}
+
+void Metrics::record(Latency latency, qint64 nanoseconds)
+{
+    LatencySlot* slot = latencySlots.local();
+
+    if (slot == nullptr)
+    {
+        return;
+    }
+
+    quint64 microseconds = static_cast<quint64>(qMax<qint64>(0, nanoseconds))
+            / 1000;
+
+    slot->counts[latency][bucketOf(microseconds)]
+            .fetch_add(1, std::memory_order_relaxed);
+    slot->sums[latency].fetch_add(microseconds, std::memory_order_relaxed);
+
+    if (microseconds > slot->maxima[latency].load(std::memory_order_relaxed))
+    {
+        slot->maxima[latency].store(microseconds, std::memory_order_relaxed);
+    }
+}
+
+Metrics::Histogram Metrics::histogram(Latency latency)
+{
+    Histogram merged { std::vector<quint64>(BUCKET_COUNT), 0, 0, 0 };
+
+    latencySlots.visit([&](const LatencySlot& slot)
+    {
+        for (int bucket = 0; bucket < BUCKET_COUNT; ++bucket)
+        {
+            quint64 count = slot.counts[latency][bucket]
+                    .load(std::memory_order_relaxed);
+
+            merged.counts[bucket] += count;
+            merged.total += count;
+        }
+
+        merged.sum += slot.sums[latency].load(std::memory_order_relaxed);
+        merged.max = qMax(merged.max, slot.maxima[latency]
+                          .load(std::memory_order_relaxed));
+    });
+
+    return merged;
+}
+
+const char* Metrics::name(Latency latency)
+{
+    switch (latency)
+    {
+        case KEYSTROKE_HIGHLIGHT:
+            return "keystroke_highlight";
+
+        case SUBMIT_RENDER:
+            return "submit_render";
+
+        case SELECT_READY:
+            return "select_ready";
+
+        case SEEK_AUDIO:
+            return "seek_audio";
+
+        case LATENCY_COUNT:
+            break;
+    }
+
+    return "unknown";
+}
+
+quint64 Metrics::allocationCount()
+{
+    quint64 count = 0;
+    quint64 bytes = 0;
+
+    sumAllocations(&count, &bytes);
+
+    return count;
+}
+
+quint64 Metrics::allocatedBytes()
+{
+    quint64 count = 0;
+    quint64 bytes = 0;
+
+    sumAllocations(&count, &bytes);
+
+    return bytes;
+}
+
+void Metrics::beginGrading()
+{
+    QMutexLocker locker(&gradingMutex);
+
+    // 之前的评估被新的提交取消了， 直接重新开始
+    grading = true;
+
+    sumAllocations(&gradingAllocations, &gradingBytes);
+
+    // 各线程下一次分配时以当时的占用为起点
+    gradingEpoch.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Metrics::endGrading()
+{
+    QMutexLocker locker(&gradingMutex);
+
+    if (!grading)
+    {
+        return;
+    }
+
+    grading = false;
+
+    quint64 count = 0;
+    quint64 bytes = 0;
+
+    sumAllocations(&count, &bytes);
+
+    quint32 epoch = gradingEpoch.load(std::memory_order_relaxed);
+    quint64 peak = 0;
+
+    allocationSlots.visit([&](const AllocationSlot& slot)
+    {
+        if (slot.epoch.load(std::memory_order_relaxed) == epoch)
+        {
+            peak += static_cast<quint64>(qMax<qint64>(
+                        0, slot.peak.load(std::memory_order_relaxed)
+                        - slot.base.load(std::memory_order_relaxed)));
+        }
+    });
+
+    history.push_back(Grading { count - gradingAllocations,
+                                bytes - gradingBytes, peak });
+
+    if (history.size() > MAX_GRADINGS)
+    {
+        history.pop_front();
+    }
+}
+
+std::vector<Metrics::Grading> Metrics::gradings()
+{
+    QMutexLocker locker(&gradingMutex);
+
+    return std::vector<Grading>(history.begin(), history.end());
+}
+
+QString Metrics::report()
+{
+    QString text = QString("%1 %2 %3 %4 %5 %6 %7\n")
+            .arg("latency (ms)", -20).arg("count", 7).arg("mean", 9)
+            .arg("p50", 9).arg("p90", 9).arg("p99", 9).arg("max", 9);
+
+    for (int i = 0; i < LATENCY_COUNT; ++i)
+    {
+        Histogram h = histogram(static_cast<Latency>(i));
+
+        text += QString("%1 %2 %3 %4 %5 %6 %7\n")
+                .arg(name(static_cast<Latency>(i)), -20)
+                .arg(h.total, 7)
+                .arg(h.mean() / 1000, 9, 'f', 2)
+                .arg(h.percentile(0.5) / 1000.0, 9, 'f', 2)
+                .arg(h.percentile(0.9) / 1000.0, 9, 'f', 2)
+                .arg(h.percentile(0.99) / 1000.0, 9, 'f', 2)
+                .arg(h.max / 1000.0, 9, 'f', 2);
+    }
+
+    text += QString("\nallocations: %1, %2 MB since start\n")
+            .arg(allocationCount())
+            .arg(allocatedBytes() / (1024.0 * 1024.0), 0, 'f', 1);
+
+    std::vector<Grading> list = gradings();
+
+    if (!list.empty())
+    {
+        text += QString("\n%1 %2 %3\n").arg("grading", -8)
+                .arg("allocations", 12).arg("peak KB", 10);
+
+        for (size_t i = 0; i < list.size(); ++i)
+        {
+            text += QString("%1 %2 %3\n").arg(i + 1, -8)
+                    .arg(list[i].allocations, 12)
+                    .arg(list[i].peakBytes / 1024, 10);
+        }
+    }
+
+    return text;
+}
+
+QByteArray Metrics::toJson()
+{
+    QJsonObject machine;
+
+    machine["cpu"] = QSysInfo::currentCpuArchitecture();
+    machine["os"] = QSysInfo::prettyProductName();
+    machine["host"] = QSysInfo::machineHostName();
+    machine["threads"] = QThread::idealThreadCount();
+
+    // 只写有数的桶， 下界为微秒
+    QJsonObject latencies;
+
+    for (int i = 0; i < LATENCY_COUNT; ++i)
+    {
+        Histogram h = histogram(static_cast<Latency>(i));
+
+        QJsonArray buckets;
+
+        for (int bucket = 0; bucket < BUCKET_COUNT; ++bucket)
+        {
+            if (h.counts[bucket] > 0)
+            {
+                buckets.append(QJsonArray {
+                                   double(bucketFloor(bucket)),
+                                   double(h.counts[bucket]) });
+            }
+        }
+
+        QJsonObject latency;
+
+        latency["count"] = double(h.total);
+        latency["mean_us"] = h.mean();
+        latency["p50_us"] = double(h.percentile(0.5));
+        latency["p90_us"] = double(h.percentile(0.9));
+        latency["p99_us"] = double(h.percentile(0.99));
+        latency["max_us"] = double(h.max);
+        latency["buckets"] = buckets;
+
+        latencies[name(static_cast<Latency>(i))] = latency;
+    }
+
+    QJsonObject allocations;
+
+    allocations["count"] = double(allocationCount());
+    allocations["bytes"] = double(allocatedBytes());
+
+    QJsonArray gradingList;
+
+    for (const Grading& grading : gradings())
+    {
+        QJsonObject object;
+
+        object["allocations"] = double(grading.allocations);
+        object["bytes"] = double(grading.bytes);
+        object["peak_bytes"] = double(grading.peakBytes);
+
+        gradingList.append(object);
+    }
+
+    QJsonObject root;
+
+    root["machine"] = machine;
+    root["latency"] = latencies;
+    root["allocations"] = allocations;
+    root["gradings"] = gradingList;
+    root["sub_buckets"] = SUB_BUCKETS;
+
+    return QJsonDocument(root).toJson();
+}
+
+// 替换全局的 operator new/delete， 仍然用 malloc/free，
+// 只是顺便按 malloc 实际给出的大小计数
+void* operator new(std::size_t size)
+{
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+    return allocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return allocate(size);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return allocate(size);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void operator delete(void* pointer) noexcept
+{
+    release(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    release(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+    release(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+    release(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+    release(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+    release(pointer);
+}
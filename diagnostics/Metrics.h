@@ -0,0 +1,85 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <vector>
+
+#include <QByteArray>
+#include <QString>
+
+// 一直开着的轻量指标: 几条关键路径的延迟直方图， 以及内存分配的次数和字节数。
+//
+// 每个线程只写自己的计数器， 不加锁也不和别的线程抢同一个缓存行，
+// 读的时候把所有线程的加起来。 直方图按 HDR 的方式分桶:
+// 每个 2 的幂区间再等分成 SUB_BUCKETS 份， 相对误差不超过 1 / SUB_BUCKETS
+class Metrics
+{
+public:
+    enum Latency
+    {
+        // 按键到编辑区带着高亮重绘
+        KEYSTROKE_HIGHLIGHT,
+        // 提交到结果开始绘制
+        SUBMIT_RENDER,
+        // 选中单元到可以播放
+        SELECT_READY,
+        // 拖动进度条到重新出声
+        SEEK_AUDIO,
+        LATENCY_COUNT
+    };
+
+    static const int SUB_BUCKETS = 16;
+
+    // 所有线程合起来的一条延迟分布， 单位微秒
+    struct Histogram
+    {
+        // 每个桶的次数
+        std::vector<quint64> counts;
+        quint64 total;
+        quint64 sum;
+        quint64 max;
+
+        double mean() const;
+
+        // p 为 0 ~ 1， 返回所在桶的上界
+        quint64 percentile(double p) const;
+    };
+
+    // 一次评估期间全进程的分配
+    struct Grading
+    {
+        quint64 allocations;
+        quint64 bytes;
+        // 各线程新增占用的峰值之和， 是真实峰值的上界
+        quint64 peakBytes;
+    };
+
+    static void record(Latency latency, qint64 nanoseconds);
+
+    static Histogram histogram(Latency latency);
+
+    static const char* name(Latency latency);
+
+    // 第 bucket 个桶的下界 (微秒)
+    static quint64 bucketFloor(int bucket);
+
+    // 程序启动以来的分配次数和字节数
+    static quint64 allocationCount();
+
+    static quint64 allocatedBytes();
+
+    // 评估开始和结束时在 GUI 线程调用， 统计这段时间里的分配
+    static void beginGrading();
+
+    static void endGrading();
+
+    // 最近的若干次评估， 旧的在前
+    static std::vector<Grading> gradings();
+
+    // 给人看的表格
+    static QString report();
+
+    // 带机器信息， 用来比较不同的机器
+    static QByteArray toJson();
+};
+
+#endif // METRICS_H
@@ -1,12 +1,115 @@
 #include "MainWindow.h"
+#include "diagnostics/Metrics.h"
+#include "session/SessionReplayer.h"
 #include <QApplication>
+#include <QDebug>
+#include <QSaveFile>
 
+namespace
+{
+
+// argv 中 name 后面的参数， 没有时为空
+QString option(int argc, char *argv[], const char* name)
+{
+    for (int i = 1; i + 1 < argc; ++i)
+    {
+        if (qstrcmp(argv[i], name) == 0)
+        {
+            return QString::fromLocal8Bit(argv[i + 1]);
+        }
+    }
+
+    return QString();
+}
+
+bool flag(int argc, char *argv[], const char* name)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (qstrcmp(argv[i], name) == 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+} //! end anonymous namespace
+
+// 用法: Learner [--record 文件] [--metrics 文件]
+//       Learner --replay 文件 [--fast] [--metrics 文件]
+// --replay 不显示窗口， 按录制时的节奏 (--fast 时尽快) 重做全部操作，
+// 最后在标准输出打印每种操作的延迟分布。
+// --metrics 在退出时把诊断页的指标写成 JSON， 用来比较不同的机器
 int main(int argc, char *argv[])
 {
+    QString replayPath = option(argc, argv, "--replay");
+
+    // 重放不需要屏幕， 可以在没有图形界面的机器上跑
+    if (!replayPath.isEmpty() && qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+    {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
     QApplication a(argc, argv);
 
     MainWindow w;
 
+    QString metricsPath = option(argc, argv, "--metrics");
+
+    if (!metricsPath.isEmpty())
+    {
+        QObject::connect(&a, &QCoreApplication::aboutToQuit, [&]()
+        {
+            QSaveFile file(metricsPath);
+
+            if (!file.open(QIODevice::WriteOnly)
+                    || file.write(Metrics::toJson()) < 0 || !file.commit())
+            {
+                qWarning() << "cannot write metrics to" << metricsPath;
+            }
+        });
+    }
+
+    if (!replayPath.isEmpty())
+    {
+        // 重放不碰用户真正的草稿和结果缓存， 每次提交都真的评估一遍
+        w.setAutosave(false);
+        w.setResultCache(false);
+
+        std::vector<SessionEvent> events;
+
+        if (!readSession(replayPath, &events))
+        {
+            qWarning() << "cannot read session" << replayPath;
+            return 1;
+        }
+
+        SessionReplayer replayer(&w, std::move(events),
+                                 !flag(argc, argv, "--fast"));
+
+        QObject::connect(&replayer, &SessionReplayer::finished, [&]()
+        {
+            QTextStream os(stdout);
+
+            replayer.report(os);
+
+            a.quit();
+        });
+
+        replayer.start();
+
+        return a.exec();
+    }
+
+    QString recordPath = option(argc, argv, "--record");
+
+    if (!recordPath.isEmpty() && !w.startRecording(recordPath))
+    {
+        qWarning() << "cannot record to" << recordPath;
+    }
+
     w.show();
 
     return a.exec();
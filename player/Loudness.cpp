@@ -0,0 +1,275 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define LOUDNESS_SSE
+#endif
+
+#include "Loudness.h"
+
+namespace
+{
+
+const double PI = 3.14159265358979323846;
+
+// 块长 400ms， 每 100ms 一个
+const double STEP_SECONDS = 0.1;
+const int STEPS_PER_BLOCK = 4;
+
+const double RELATIVE_GATE = -10.0;
+
+// 增益上限， 避免把几乎无声的录音放大成噪音
+const double MAX_GAIN = 20.0;
+
+// 分段并行滤波时每段先空跑这么久， 让滤波器状态收敛
+const double WARM_UP_SECONDS = 0.1;
+
+// 两级二阶节: 高频搁架 + 高通， 系数按采样率重新计算
+struct Coefficients
+{
+    float b0, b1, b2, a1, a2;
+};
+
+void kWeighting(int sampleRate, Coefficients* shelf, Coefficients* highPass)
+{
+    double f0 = 1681.974450955533;
+    double gain = 3.999843853973347;
+    double q = 0.7071752369554196;
+
+    double k = std::tan(PI * f0 / sampleRate);
+    double vh = std::pow(10.0, gain / 20.0);
+    double vb = std::pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+
+    *shelf = Coefficients { float((vh + vb * k / q + k * k) / a0),
+                            float(2.0 * (k * k - vh) / a0),
+                            float((vh - vb * k / q + k * k) / a0),
+                            float(2.0 * (k * k - 1.0) / a0),
+                            float((1.0 - k / q + k * k) / a0) };
+
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = std::tan(PI * f0 / sampleRate);
+    a0 = 1.0 + k / q + k * k;
+
+    *highPass = Coefficients { 1.0f, -2.0f, 1.0f,
+                               float(2.0 * (k * k - 1.0) / a0),
+                               float((1.0 - k / q + k * k) / a0) };
+}
+
+// IIR 在时间上无法并行， 于是把音频切成 LANES 段， 每段占向量的一个通道同时滤波。
+// 每段从前面 warmUp 个样本开始， 这部分的输出丢掉
+const int LANES = 4;
+
+void filter(const float* input, float* output, qint64 frames, int sampleRate)
+{
+    Coefficients s;
+    Coefficients h;
+
+    kWeighting(sampleRate, &s, &h);
+
+    qint64 segment = (frames + LANES - 1) / LANES;
+    qint64 warmUp = std::min<qint64>(qint64(WARM_UP_SECONDS * sampleRate),
+                                     segment);
+    qint64 steps = warmUp + segment;
+
+    auto sample = [&](int lane, qint64 step)
+    {
+        qint64 index = lane * segment - warmUp + step;
+
+        return index >= 0 && index < frames ? input[index] : 0.0f;
+    };
+
+    auto store = [&](int lane, qint64 step, float value)
+    {
+        qint64 index = lane * segment - warmUp + step;
+
+        if (step >= warmUp && index < frames)
+        {
+            output[index] = value;
+        }
+    };
+
+#ifdef LOUDNESS_SSE
+    // 转置 II 型， 每级两个状态
+    __m128 s1 = _mm_setzero_ps();
+    __m128 s2 = _mm_setzero_ps();
+    __m128 h1 = _mm_setzero_ps();
+    __m128 h2 = _mm_setzero_ps();
+
+    const __m128 sb0 = _mm_set1_ps(s.b0);
+    const __m128 sb1 = _mm_set1_ps(s.b1);
+    const __m128 sb2 = _mm_set1_ps(s.b2);
+    const __m128 sa1 = _mm_set1_ps(s.a1);
+    const __m128 sa2 = _mm_set1_ps(s.a2);
+    const __m128 hb0 = _mm_set1_ps(h.b0);
+    const __m128 hb1 = _mm_set1_ps(h.b1);
+    const __m128 hb2 = _mm_set1_ps(h.b2);
+    const __m128 ha1 = _mm_set1_ps(h.a1);
+    const __m128 ha2 = _mm_set1_ps(h.a2);
+
+    float lanes[LANES];
+
+    for (qint64 step = 0; step < steps; ++step)
+    {
+        __m128 x = _mm_setr_ps(sample(0, step), sample(1, step),
+                               sample(2, step), sample(3, step));
+
+        __m128 y = _mm_add_ps(_mm_mul_ps(sb0, x), s1);
+        s1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(sb1, x), _mm_mul_ps(sa1, y)), s2);
+        s2 = _mm_sub_ps(_mm_mul_ps(sb2, x), _mm_mul_ps(sa2, y));
+
+        __m128 z = _mm_add_ps(_mm_mul_ps(hb0, y), h1);
+        h1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(hb1, y), _mm_mul_ps(ha1, z)), h2);
+        h2 = _mm_sub_ps(_mm_mul_ps(hb2, y), _mm_mul_ps(ha2, z));
+
+        _mm_storeu_ps(lanes, z);
+
+        for (int lane = 0; lane < LANES; ++lane)
+        {
+            store(lane, step, lanes[lane]);
+        }
+    }
+#else
+    for (int lane = 0; lane < LANES; ++lane)
+    {
+        float s1 = 0, s2 = 0, h1 = 0, h2 = 0;
+
+        for (qint64 step = 0; step < steps; ++step)
+        {
+            float x = sample(lane, step);
+
+            float y = s.b0 * x + s1;
+            s1 = s.b1 * x - s.a1 * y + s2;
+            s2 = s.b2 * x - s.a2 * y;
+
+            float z = h.b0 * y + h1;
+            h1 = h.b1 * y - h.a1 * z + h2;
+            h2 = h.b2 * y - h.a2 * z;
+
+            store(lane, step, z);
+        }
+    }
+#endif
+}
+
+double sumSquares(const float* data, qint64 n)
+{
+    qint64 i = 0;
+    double result = 0;
+
+#ifdef LOUDNESS_SSE
+    __m128 first = _mm_setzero_ps();
+    __m128 second = _mm_setzero_ps();
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128 a = _mm_loadu_ps(data + i);
+        __m128 b = _mm_loadu_ps(data + i + 4);
+
+        first = _mm_add_ps(first, _mm_mul_ps(a, a));
+        second = _mm_add_ps(second, _mm_mul_ps(b, b));
+    }
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, _mm_add_ps(first, second));
+
+    result = double(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+#endif
+
+    for (; i < n; ++i)
+    {
+        result += double(data[i]) * data[i];
+    }
+
+    return result;
+}
+
+double toLoudness(double meanSquare)
+{
+    return meanSquare > 0 ? -0.691 + 10.0 * std::log10(meanSquare)
+                          : LOUDNESS_FLOOR;
+}
+
+} //! end anonymous namespace
+
+double integratedLoudness(const float* samples, qint64 frames, int sampleRate)
+{
+    qint64 step = qint64(STEP_SECONDS * sampleRate);
+
+    if (sampleRate <= 0 || frames < step * STEPS_PER_BLOCK)
+    {
+        return LOUDNESS_FLOOR;
+    }
+
+    std::vector<float> weighted(frames);
+
+    filter(samples, weighted.data(), frames, sampleRate);
+
+    // 每 100ms 的能量， 一个块是相邻的 4 个
+    std::vector<double> steps(frames / step);
+
+    for (size_t i = 0; i < steps.size(); ++i)
+    {
+        steps[i] = sumSquares(weighted.data() + i * step, step);
+    }
+
+    std::vector<double> blocks;
+
+    for (size_t i = 0; i + STEPS_PER_BLOCK <= steps.size(); ++i)
+    {
+        double energy = 0;
+
+        for (int j = 0; j < STEPS_PER_BLOCK; ++j)
+        {
+            energy += steps[i + j];
+        }
+
+        double meanSquare = energy / (step * STEPS_PER_BLOCK);
+
+        if (toLoudness(meanSquare) > LOUDNESS_FLOOR)
+        {
+            blocks.push_back(meanSquare);
+        }
+    }
+
+    if (blocks.empty())
+    {
+        return LOUDNESS_FLOOR;
+    }
+
+    double sum = 0;
+
+    for (double block : blocks)
+    {
+        sum += block;
+    }
+
+    double gate = toLoudness(sum / blocks.size()) + RELATIVE_GATE;
+
+    double gated = 0;
+    int count = 0;
+
+    for (double block : blocks)
+    {
+        if (toLoudness(block) > gate)
+        {
+            gated += block;
+            ++count;
+        }
+    }
+
+    return count > 0 ? toLoudness(gated / count) : LOUDNESS_FLOOR;
+}
+
+double normalizationGain(double loudness)
+{
+    if (loudness <= LOUDNESS_FLOOR)
+    {
+        return 0.0;
+    }
+
+    return qBound(-MAX_GAIN, LOUDNESS_TARGET - loudness, MAX_GAIN);
+}
@@ -0,0 +1,19 @@
+#ifndef LOUDNESS_H
+#define LOUDNESS_H
+
+#include <QtGlobal>
+
+// 归一化的目标响度 (LUFS)， 语音素材比广播的 -23 响一些
+const double LOUDNESS_TARGET = -18.0;
+
+// 低于这个值的块不参与计算， 全是静音时也返回它
+const double LOUDNESS_FLOOR = -70.0;
+
+// 按 ITU-R BS.1770 / EBU R128 计算单声道整段音频的积分响度 (LUFS):
+// K 加权， 400ms 块 75% 重叠， 先绝对门限 -70 LUFS， 再相对门限 -10 LU
+double integratedLoudness(const float* samples, qint64 frames, int sampleRate);
+
+// 把 loudness 拉到 LOUDNESS_TARGET 需要的增益 (dB)
+double normalizationGain(double loudness);
+
+#endif // LOUDNESS_H
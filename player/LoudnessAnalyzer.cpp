@@ -0,0 +1,266 @@
+#include <memory>
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTimer>
+
+#include "Loudness.h"
+#include "LoudnessAnalyzer.h"
+#include "common/PoolJob.h"
+
+namespace
+{
+
+const quint32 MAGIC = 0x4C4C4431; // "LLD1"
+
+// 新结果最多攒这么久再写回缓存文件
+const int SAVE_DELAY = 5000;
+
+} //! end anonymous namespace
+
+LoudnessAnalyzer::LoudnessAnalyzer(const QString& cachePath, QObject* parent)
+    : QObject(parent)
+    , cachePath(cachePath)
+    , dirty(false)
+    , busy(false)
+    , sampleRate(0)
+{
+    QFile file(cachePath);
+
+    if (file.open(QIODevice::ReadOnly))
+    {
+        QDataStream is(&file);
+        is.setVersion(QDataStream::Qt_5_0);
+
+        quint32 magic = 0;
+
+        is >> magic;
+
+        if (magic == MAGIC)
+        {
+            is >> cache;
+        }
+
+        if (is.status() != QDataStream::Ok)
+        {
+            cache.clear();
+        }
+    }
+
+    saveTimer.setSingleShot(true);
+    saveTimer.setInterval(SAVE_DELAY);
+
+    connect(&saveTimer, &QTimer::timeout, this, &LoudnessAnalyzer::save);
+
+    // 响度不需要立体声， 单声道解码数据量减半
+    QAudioFormat format;
+    format.setSampleRate(44100);
+    format.setChannelCount(1);
+    format.setSampleSize(16);
+    format.setSampleType(QAudioFormat::SignedInt);
+    format.setByteOrder(QAudioFormat::LittleEndian);
+    format.setCodec("audio/pcm");
+
+    decoder.setAudioFormat(format);
+
+    // 一次只分析一个单元， 不和评估抢 CPU
+    pool.setMaxThreadCount(1);
+
+    connect(&decoder, &QAudioDecoder::bufferReady, this, [this]()
+    {
+        QAudioBuffer chunk = decoder.read();
+        QAudioFormat format = chunk.format();
+
+        if (format.sampleType() != QAudioFormat::SignedInt
+                || format.sampleSize() != 16 || format.channelCount() != 1)
+        {
+            return;
+        }
+
+        sampleRate = format.sampleRate();
+
+        auto data = chunk.constData<qint16>();
+
+        for (int i = 0; i < chunk.sampleCount(); ++i)
+        {
+            samples.push_back(data[i] / 32768.0f);
+        }
+    });
+
+    connect(&decoder, &QAudioDecoder::finished, this, [this]()
+    {
+        decoder.stop();
+        buffer.close();
+
+        Job job = current;
+        auto pcm = std::make_shared<std::vector<float>>();
+        int rate = sampleRate;
+
+        pcm->swap(samples);
+
+        pool.start(new PoolJob([this, job, pcm, rate]()
+        {
+            double loudness = integratedLoudness(pcm->data(), pcm->size(),
+                                                 rate);
+
+            emit measured(job.unit, job.stamp, loudness);
+        }));
+
+        busy = false;
+
+        // 不在解码器自己的信号里重新启动它
+        QTimer::singleShot(0, this, [this]() { next(); });
+    });
+
+    connect(&decoder,
+            static_cast<void (QAudioDecoder::*)(QAudioDecoder::Error)>(
+                &QAudioDecoder::error),
+            this, [this](QAudioDecoder::Error)
+    {
+        // 解不了的单元跳过， 下次启动再试
+        decoder.stop();
+        buffer.close();
+        samples.clear();
+
+        busy = false;
+
+        // 不在解码器自己的信号里重新启动它
+        QTimer::singleShot(0, this, [this]() { next(); });
+    });
+
+    connect(this, &LoudnessAnalyzer::measured,
+            this, &LoudnessAnalyzer::onMeasured, Qt::QueuedConnection);
+}
+
+LoudnessAnalyzer::~LoudnessAnalyzer()
+{
+    queue.clear();
+    decoder.stop();
+
+    pool.waitForDone();
+
+    save();
+}
+
+quint64 LoudnessAnalyzer::fileStamp(const QString& path)
+{
+    QFileInfo info(path);
+
+    return quint64(info.lastModified().toMSecsSinceEpoch()) * 31
+            + quint64(info.size());
+}
+
+bool LoudnessAnalyzer::find(const QString& unit, quint64 stamp,
+                            double* loudness) const
+{
+    auto it = cache.find(unit);
+
+    if (it == cache.end() || it->first != stamp)
+    {
+        return false;
+    }
+
+    *loudness = it->second;
+    return true;
+}
+
+void LoudnessAnalyzer::enqueue(const QString& unit, quint64 stamp,
+                               const QString& path, const QByteArray& data)
+{
+    double loudness = 0;
+
+    if (find(unit, stamp, &loudness))
+    {
+        return;
+    }
+
+    queue.push_back(Job { unit, stamp, path, data });
+
+    next();
+}
+
+void LoudnessAnalyzer::prioritize(const QString& unit)
+{
+    for (auto it = queue.begin(); it != queue.end(); ++it)
+    {
+        if (it->unit == unit)
+        {
+            queue.splice(queue.begin(), queue, it);
+            break;
+        }
+    }
+}
+
+void LoudnessAnalyzer::next()
+{
+    if (busy || queue.empty())
+    {
+        return;
+    }
+
+    current = queue.front();
+    queue.pop_front();
+
+    busy = true;
+    samples.clear();
+    sampleRate = 0;
+
+    if (!current.data.isEmpty())
+    {
+        buffer.setData(current.data);
+        buffer.open(QIODevice::ReadOnly);
+
+        decoder.setSourceDevice(&buffer);
+    }
+    else
+    {
+        decoder.setSourceFilename(current.path);
+    }
+
+    decoder.start();
+}
+
+void LoudnessAnalyzer::onMeasured(const QString& unit, quint64 stamp,
+                                  double loudness)
+{
+    cache.insert(unit, qMakePair(stamp, loudness));
+
+    // 整个缓存一起重写， 不能每个单元都写一遍
+    dirty = true;
+
+    if (!saveTimer.isActive())
+    {
+        saveTimer.start();
+    }
+
+    emit analyzed(unit, loudness);
+}
+
+void LoudnessAnalyzer::save()
+{
+    saveTimer.stop();
+
+    if (!dirty)
+    {
+        return;
+    }
+
+    dirty = false;
+
+    QSaveFile file(cachePath);
+
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return;
+    }
+
+    QDataStream os(&file);
+    os.setVersion(QDataStream::Qt_5_0);
+
+    os << MAGIC << cache;
+
+    file.commit();
+}
@@ -0,0 +1,84 @@
+#ifndef LOUDNESSANALYZER_H
+#define LOUDNESSANALYZER_H
+
+#include <list>
+#include <vector>
+
+#include <QAudioDecoder>
+#include <QBuffer>
+#include <QHash>
+#include <QObject>
+#include <QPair>
+#include <QThreadPool>
+#include <QTimer>
+
+// 在后台逐个解码单元的音频并测量响度， 结果按版本戳缓存到文件里，
+// 每个单元只需分析一次。 解码是异步的， 滤波在线程池里做， 不会卡住播放
+class LoudnessAnalyzer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LoudnessAnalyzer(const QString& cachePath,
+                              QObject* parent = nullptr);
+
+    ~LoudnessAnalyzer();
+
+    // 已经分析过而且版本没变时返回 true
+    bool find(const QString& unit, quint64 stamp, double* loudness) const;
+
+    // 排到队尾。 data 不为空时直接解码内存中的音频 (要一直有效)， 否则读 path
+    void enqueue(const QString& unit, quint64 stamp, const QString& path,
+                 const QByteArray& data = QByteArray());
+
+    // 用户选中的单元插到队首
+    void prioritize(const QString& unit);
+
+    // 音频文件的版本戳
+    static quint64 fileStamp(const QString& path);
+
+signals:
+    // loudness 为 LUFS
+    void analyzed(const QString& unit, double loudness);
+
+    // 由工作线程发出
+    void measured(const QString& unit, quint64 stamp, double loudness);
+
+private slots:
+    void onMeasured(const QString& unit, quint64 stamp, double loudness);
+
+private:
+    struct Job
+    {
+        QString unit;
+        quint64 stamp;
+        QString path;
+        QByteArray data;
+    };
+
+    // 队首的单元开始解码
+    void next();
+
+    // 有新结果时写回缓存文件
+    void save();
+
+private:
+    QString cachePath;
+    // 单元 -> (版本戳, 响度)
+    QHash<QString, QPair<quint64, double>> cache;
+    // 缓存有还没写回的结果
+    bool dirty;
+    // 第一次扫描时每个单元都会出结果， 攒一阵再一起写
+    QTimer saveTimer;
+    std::list<Job> queue;
+    QAudioDecoder decoder;
+    QBuffer buffer;
+    // 正在解码的单元和已经解出的样本
+    bool busy;
+    Job current;
+    std::vector<float> samples;
+    int sampleRate;
+    QThreadPool pool;
+};
+
+#endif // LOUDNESSANALYZER_H
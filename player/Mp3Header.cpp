@@ -0,0 +1,183 @@
+#include "Mp3Header.h"
+
+namespace
+{
+
+// [版本][层] 的码率表， 版本 0 为 MPEG1， 1 为 MPEG2/2.5
+const int BITRATES[2][3][16] =
+{
+    {
+        { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448, 0 },
+        { 0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 0 },
+        { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0 }
+    },
+    {
+        { 0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256, 0 },
+        { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0 },
+        { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0 }
+    }
+};
+
+const int SAMPLE_RATES[3] = { 44100, 48000, 32000 };
+
+quint32 bigEndian(const uchar* p)
+{
+    return (quint32(p[0]) << 24) | (quint32(p[1]) << 16)
+            | (quint32(p[2]) << 8) | quint32(p[3]);
+}
+
+// Xing/Info 头在帧的边信息之后
+qint64 xingOffset(const uchar* data, qint64 offset, const Mp3Frame& frame)
+{
+    bool mpeg1 = (data[offset + 1] >> 3 & 3) == 3;
+    int side = mpeg1 ? (frame.channels == 1 ? 17 : 32)
+                     : (frame.channels == 1 ? 9 : 17);
+
+    return offset + 4 + side;
+}
+
+} //! end anonymous namespace
+
+bool parseFrameHeader(const uchar* p, Mp3Frame* frame)
+{
+    if (p[0] != 0xFF || (p[1] & 0xE0) != 0xE0)
+    {
+        return false;
+    }
+
+    // 3: MPEG1, 2: MPEG2, 0: MPEG2.5
+    int version = (p[1] >> 3) & 3;
+    // 3: Layer I, 2: Layer II, 1: Layer III
+    int layer = (p[1] >> 1) & 3;
+    int bitrateIndex = p[2] >> 4;
+    int rateIndex = (p[2] >> 2) & 3;
+    int padding = (p[2] >> 1) & 1;
+
+    if (version == 1 || layer == 0 || bitrateIndex == 0
+            || bitrateIndex == 15 || rateIndex == 3)
+    {
+        return false;
+    }
+
+    bool mpeg1 = version == 3;
+
+    frame->bitrate = BITRATES[mpeg1 ? 0 : 1][3 - layer][bitrateIndex];
+    frame->sampleRate = SAMPLE_RATES[rateIndex]
+            >> (mpeg1 ? 0 : (version == 2 ? 1 : 2));
+    frame->channels = (p[3] >> 6) == 3 ? 1 : 2;
+
+    if (layer == 3)
+    {
+        frame->samples = 384;
+        frame->length = (12 * frame->bitrate * 1000 / frame->sampleRate
+                         + padding) * 4;
+    }
+    else
+    {
+        frame->samples = (layer == 1 && !mpeg1) ? 576 : 1152;
+        frame->length = frame->samples / 8 * frame->bitrate * 1000
+                / frame->sampleRate + padding;
+    }
+
+    return frame->length > 4;
+}
+
+qint64 id3Length(const uchar* data, qint64 size)
+{
+    if (size < 10 || data[0] != 'I' || data[1] != 'D' || data[2] != '3')
+    {
+        return 0;
+    }
+
+    // 长度是 4 个 7 位的字节， 不含 10 字节的头， 有 footer 时再加 10
+    qint64 length = (qint64(data[6] & 0x7F) << 21)
+            | (qint64(data[7] & 0x7F) << 14)
+            | (qint64(data[8] & 0x7F) << 7)
+            | qint64(data[9] & 0x7F);
+
+    return 10 + length + ((data[5] & 0x10) ? 10 : 0);
+}
+
+qint64 findFrame(const uchar* data, qint64 size, qint64 offset,
+                 Mp3Frame* frame)
+{
+    // 找到连续两个合法帧头才算数， 避免把数据里的 0xFF 当成同步字
+    for (; offset + 4 <= size; ++offset)
+    {
+        if (parseFrameHeader(data + offset, frame))
+        {
+            Mp3Frame next;
+
+            qint64 following = offset + frame->length;
+
+            if (following + 4 > size
+                    || parseFrameHeader(data + following, &next))
+            {
+                return offset;
+            }
+        }
+    }
+
+    return -1;
+}
+
+bool isInfoFrame(const uchar* data, qint64 size, qint64 offset,
+                 const Mp3Frame& frame)
+{
+    qint64 xing = xingOffset(data, offset, frame);
+
+    if (xing + 4 <= size)
+    {
+        auto tag = reinterpret_cast<const char*>(data + xing);
+
+        if (qstrncmp(tag, "Xing", 4) == 0 || qstrncmp(tag, "Info", 4) == 0)
+        {
+            return true;
+        }
+    }
+
+    // VBRI 头的位置是固定的
+    return offset + 40 <= size
+            && qstrncmp(reinterpret_cast<const char*>(data + offset + 36),
+                        "VBRI", 4) == 0;
+}
+
+Mp3Info probe(const QByteArray& head, qint64 fileSize)
+{
+    Mp3Info info { false, 0, 0, 0, 0, 0 };
+
+    auto data = reinterpret_cast<const uchar*>(head.constData());
+    qint64 size = head.size();
+
+    Mp3Frame frame;
+
+    qint64 offset = findFrame(data, size, id3Length(data, size), &frame);
+
+    if (offset < 0)
+    {
+        return info;
+    }
+
+    info.valid = true;
+    info.sampleRate = frame.sampleRate;
+    info.channels = frame.channels;
+    info.bitrate = frame.bitrate;
+    info.dataOffset = offset;
+
+    qint64 xing = xingOffset(data, offset, frame);
+
+    if (xing + 12 <= size
+            && (head.mid(xing, 4) == "Xing" || head.mid(xing, 4) == "Info")
+            && (bigEndian(data + xing + 4) & 1))
+    {
+        qint64 frames = bigEndian(data + xing + 8);
+
+        info.duration = frames * frame.samples * 1000 / frame.sampleRate;
+    }
+    else if (frame.bitrate > 0)
+    {
+        info.duration = (fileSize - offset) * 8 / frame.bitrate;
+    }
+
+    return info;
+}
@@ -0,0 +1,49 @@
+#ifndef MP3HEADER_H
+#define MP3HEADER_H
+
+#include <QByteArray>
+#include <QtGlobal>
+
+// 一个 MPEG 音频帧头里的信息
+struct Mp3Frame
+{
+    int sampleRate;
+    int channels;
+    // kbps
+    int bitrate;
+    int samples;
+    // 整帧的字节数
+    int length;
+};
+
+// 只看文件开头就能得到的信息， 不需要解码
+struct Mp3Info
+{
+    bool valid;
+    int sampleRate;
+    int channels;
+    int bitrate;
+    // 第一帧的位置 (跳过 ID3v2 之后)
+    qint64 dataOffset;
+    // 有 Xing/Info 头时是准确值， 否则按固定码率估算
+    qint64 duration;
+};
+
+// p 至少要有 4 个字节
+bool parseFrameHeader(const uchar* p, Mp3Frame* frame);
+
+// ID3v2 标签的总长度， 没有标签时为 0
+qint64 id3Length(const uchar* data, qint64 size);
+
+// 从 offset 起第一个后面紧跟着另一个合法帧头的帧， 找不到时返回 -1
+qint64 findFrame(const uchar* data, qint64 size, qint64 offset,
+                 Mp3Frame* frame);
+
+// offset 处的帧只是 Xing/Info/VBRI 头， 不含音频
+bool isInfoFrame(const uchar* data, qint64 size, qint64 offset,
+                 const Mp3Frame& frame);
+
+// head 是文件开头的一段， fileSize 是整个文件的大小
+Mp3Info probe(const QByteArray& head, qint64 fileSize);
+
+#endif // MP3HEADER_H
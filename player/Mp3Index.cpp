@@ -0,0 +1,175 @@
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+
+#include "Mp3Header.h"
+#include "Mp3Index.h"
+
+namespace
+{
+
+const quint32 MAGIC = 0x4C4D4931; // "LMI1"
+
+} //! end anonymous namespace
+
+Mp3Index::Mp3Index()
+    : sampleRate(0)
+    , samplesPerFrame(0)
+{
+}
+
+Mp3Index Mp3Index::build(const uchar* data, qint64 size)
+{
+    Mp3Index index;
+    Mp3Frame frame;
+
+    qint64 offset = findFrame(data, size, id3Length(data, size), &frame);
+
+    if (offset < 0)
+    {
+        return index;
+    }
+
+    index.sampleRate = frame.sampleRate;
+    index.samplesPerFrame = frame.samples;
+
+    // VBR 文件的第一帧只有 Xing 头， 不算时间
+    if (isInfoFrame(data, size, offset, frame))
+    {
+        offset += frame.length;
+    }
+
+    // 按码率估个帧数， 省得反复扩容
+    if (frame.bitrate > 0)
+    {
+        index.offsets.reserve(static_cast<size_t>(
+                (size - offset) * 8 / frame.bitrate * frame.sampleRate
+                / 1000 / frame.samples + 16));
+    }
+
+    while (offset + 4 <= size)
+    {
+        if (!parseFrameHeader(data + offset, &frame)
+                || frame.sampleRate != index.sampleRate
+                || frame.samples != index.samplesPerFrame)
+        {
+            // 中间夹着垃圾数据或者到了结尾的 ID3v1 标签， 重新找同步
+            offset = findFrame(data, size, offset + 1, &frame);
+
+            if (offset < 0 || frame.sampleRate != index.sampleRate
+                    || frame.samples != index.samplesPerFrame)
+            {
+                break;
+            }
+        }
+
+        // 最后一帧不完整就不要了
+        if (offset + frame.length > size)
+        {
+            break;
+        }
+
+        index.offsets.push_back(static_cast<quint32>(offset));
+
+        offset += frame.length;
+    }
+
+    index.offsets.shrink_to_fit();
+
+    return index;
+}
+
+qint64 Mp3Index::duration() const
+{
+    return frameTime(frameCount());
+}
+
+int Mp3Index::frameAt(qint64 milliseconds) const
+{
+    if (!isValid())
+    {
+        return 0;
+    }
+
+    qint64 frame = milliseconds * sampleRate / (1000LL * samplesPerFrame);
+
+    return static_cast<int>(qBound<qint64>(0, frame, frameCount() - 1));
+}
+
+qint64 Mp3Index::frameTime(int frame) const
+{
+    if (sampleRate == 0)
+    {
+        return 0;
+    }
+
+    return qint64(frame) * samplesPerFrame * 1000 / sampleRate;
+}
+
+bool Mp3Index::load(const QString& path)
+{
+    QFile file(path);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    QDataStream is(&file);
+    is.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic = 0;
+    qint32 rate = 0;
+    qint32 samples = 0;
+    quint32 count = 0;
+
+    is >> magic >> rate >> samples >> count;
+
+    // 每帧至少 4 个字节， 帧数不会超过文件大小
+    if (magic != MAGIC || rate <= 0 || samples <= 0
+            || count > quint64(file.size()) / sizeof(quint32))
+    {
+        return false;
+    }
+
+    std::vector<quint32> frames(count);
+
+    for (quint32& offset : frames)
+    {
+        is >> offset;
+    }
+
+    if (is.status() != QDataStream::Ok)
+    {
+        return false;
+    }
+
+    sampleRate = rate;
+    samplesPerFrame = samples;
+    offsets.swap(frames);
+
+    return true;
+}
+
+bool Mp3Index::save(const QString& path) const
+{
+    QSaveFile file(path);
+
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    QDataStream os(&file);
+    os.setVersion(QDataStream::Qt_5_0);
+
+    os << MAGIC << qint32(sampleRate) << qint32(samplesPerFrame)
+       << quint32(offsets.size());
+
+    for (quint32 offset : offsets)
+    {
+        os << offset;
+    }
+
+    return os.status() == QDataStream::Ok && file.commit();
+}
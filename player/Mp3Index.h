@@ -0,0 +1,59 @@
+#ifndef MP3INDEX_H
+#define MP3INDEX_H
+
+#include <vector>
+
+#include <QString>
+
+// 每个音频帧在文件中的位置。 只解析帧头， 不解码，
+// 几分钟的录音几毫秒就能建好， 每帧 4 个字节。
+// 同一个文件里每帧的样本数和采样率不变， 时间到帧号是一次除法
+class Mp3Index
+{
+public:
+    Mp3Index();
+
+    // 数据里找不到帧时返回空的索引
+    static Mp3Index build(const uchar* data, qint64 size);
+
+    // 离线构建的索引文件 (tools/assets)
+    bool load(const QString& path);
+
+    bool save(const QString& path) const;
+
+    bool isValid() const
+    {
+        return !offsets.empty();
+    }
+
+    int frameCount() const
+    {
+        return static_cast<int>(offsets.size());
+    }
+
+    // 按帧数算出的准确时长 (毫秒)
+    qint64 duration() const;
+
+    // 包含 milliseconds 的帧， 超出范围时取最近的一帧
+    int frameAt(qint64 milliseconds) const;
+
+    // 帧开始的时间 (毫秒)
+    qint64 frameTime(int frame) const;
+
+    qint64 frameOffset(int frame) const
+    {
+        return offsets[frame];
+    }
+
+    qint64 memoryCost() const
+    {
+        return sizeof(Mp3Index) + offsets.capacity() * sizeof(quint32);
+    }
+
+private:
+    int sampleRate;
+    int samplesPerFrame;
+    std::vector<quint32> offsets;
+};
+
+#endif // MP3INDEX_H
@@ -1,24 +1,127 @@
+#include <QAudioDecoder>
+#include <QAudioOutput>
 #include <QMediaPlayer>
 #include <QApplication>
+#include <QBuffer>
 #include <QFileInfo>
+#include <cmath>
+#include <memory>
+#include "Mp3Index.h"
 #include "Player.h"
+#include "StretchDevice.h"
+
+namespace
+{
+
+// 第三层的帧会借用前面帧的数据 (bit reservoir)， 定位时多往前退一帧
+const int RESERVOIR_FRAMES = 1;
+
+// 解码领先播放位置这么多 (毫秒) 才切到变速输出。 解码比播放快得多， 之后追不上
+const qint64 DECODE_LEAD = 2000;
+
+} //! end anonymous namespace
 
 struct Player::Impl
 {
     QString workingDirectory;
+    QString path;
+    // 内存中的音频， 播放和解码各用一个 QBuffer， 读位置互不影响
+    QByteArray source;
+    QBuffer playerBuffer;
+    QBuffer decoderBuffer;
+    // 按帧定位: 帧索引、 整个文件的数据 (映射或 source)，
+    // 以及交给 QMediaPlayer 的从某一帧开始的那部分
+    std::shared_ptr<const Mp3Index> index;
+    QFile mappedFile;
+    QByteArray frames;
+    QBuffer seekBuffer;
+    // 格式提示， 与 setMedia 的 name 相同
+    QString name;
+    // QMediaPlayer 里的第 0 毫秒对应的真实位置
+    qint64 streamBase = 0;
     QMediaPlayer player;
+    QAudioDecoder decoder;
+    StretchDevice device;
+    QAudioOutput* output = nullptr;
+    double rate = 1.0;
+    double volume = 0.4;
+    // 响度归一化的线性增益
+    double gain = 1.0;
+    qint64 durationHint = 0;
+    // 当前是否走变速输出
+    bool stretching = false;
+    bool playing = false;
+    // 还没有发出 ready 和 audioResumed
+    bool awaitingReady = false;
+    bool awaitingAudio = false;
 };
 
-Player::Player()
-    : impl(new Impl)
+Player::Player(QObject* parent)
+    : QObject(parent)
+    , impl(new Impl)
 {
     impl->workingDirectory = QApplication::applicationDirPath();
+
+    // 单声道就够听写用， 变速的计算量和内存都减半
+    QAudioFormat format;
+    format.setSampleRate(44100);
+    format.setChannelCount(1);
+    format.setSampleSize(16);
+    format.setSampleType(QAudioFormat::SignedInt);
+    format.setByteOrder(QAudioFormat::LittleEndian);
+    format.setCodec("audio/pcm");
+
+    impl->decoder.setAudioFormat(format);
+
+    connect(&impl->decoder, &QAudioDecoder::bufferReady, this, [this]()
+    {
+        QAudioBuffer buffer = impl->decoder.read();
+
+        impl->device.append(buffer.constData(), buffer.frameCount(),
+                            buffer.format());
+
+        switchOutput();
+    });
+
+    connect(&impl->decoder, &QAudioDecoder::finished, this, [this]()
+    {
+        impl->device.finish();
+
+        switchOutput();
+    });
+
+    connect(&impl->player, &QMediaPlayer::positionChanged,
+            this, [this](qint64 position)
+    {
+        if (!impl->stretching)
+        {
+            emit positionChanged(impl->streamBase + position);
+        }
+    });
+
+    connect(&impl->player, &QMediaPlayer::mediaStatusChanged,
+            this, [this](QMediaPlayer::MediaStatus status)
+    {
+        // 定位时换的流也会走一遍， 只报 setMedia 之后的第一次
+        if (impl->awaitingReady && (status == QMediaPlayer::LoadedMedia
+                                    || status == QMediaPlayer::BufferedMedia))
+        {
+            impl->awaitingReady = false;
+            emit ready();
+        }
+
+        checkResumed();
+    });
+
+    connect(&impl->player, &QMediaPlayer::stateChanged,
+            this, &Player::checkResumed);
 }
 
 Player::~Player()
 {
     if (impl)
     {
+        delete impl->output;
         delete impl;
     }
 }
@@ -27,7 +130,7 @@ bool Player::setMedia(const QString& section, const QString& fileName)
 {
     auto path = QString("%1/%2/%3/%4")
             .arg(impl->workingDirectory)
-            .arg("resource")
+            .arg("english_data")
             .arg(section)
             .arg(fileName);
 
@@ -37,40 +140,388 @@ bool Player::setMedia(const QString& section, const QString& fileName)
     }
     else
     {
+        reset();
+
+        impl->path = path;
+        impl->name = fileName;
+        impl->awaitingReady = true;
         impl->player.setMedia(QUrl::fromLocalFile(path));
+
+        if (impl->rate != 1.0)
+        {
+            startDecoding();
+        }
+
         return true;
     }
 }
 
+void Player::setMedia(const QByteArray& data, const QString& name)
+{
+    reset();
+
+    impl->source = data;
+    impl->name = name;
+
+    impl->playerBuffer.setData(impl->source);
+    impl->playerBuffer.open(QIODevice::ReadOnly);
+
+    impl->awaitingReady = true;
+    impl->player.setMedia(QMediaContent(QUrl(name)), &impl->playerBuffer);
+
+    if (impl->rate != 1.0)
+    {
+        startDecoding();
+    }
+}
+
+void Player::reset()
+{
+    if (impl->output)
+    {
+        impl->output->stop();
+    }
+
+    impl->player.setMedia(QMediaContent());
+    impl->playerBuffer.close();
+    impl->seekBuffer.close();
+
+    // 关闭时解除映射
+    impl->frames.clear();
+    impl->mappedFile.close();
+    impl->index.reset();
+    impl->streamBase = 0;
+
+    impl->decoder.stop();
+    impl->decoderBuffer.close();
+    impl->device.clear();
+
+    impl->stretching = false;
+    impl->playing = false;
+    impl->awaitingReady = false;
+    impl->awaitingAudio = false;
+    impl->durationHint = 0;
+
+    impl->gain = 1.0;
+    applyVolume();
+
+    impl->path.clear();
+    impl->source.clear();
+}
+
+bool Player::isReady() const
+{
+    return impl->player.isMetaDataAvailable() || impl->device.isComplete();
+}
+
+bool Player::isPlaying() const
+{
+    return impl->playing;
+}
+
 void Player::play()
 {
-    impl->player.play();
+    impl->playing = true;
+
+    if (impl->stretching)
+    {
+        if (impl->output->state() == QAudio::SuspendedState)
+        {
+            impl->output->resume();
+        }
+        else
+        {
+            impl->output->start(&impl->device);
+        }
+    }
+    else
+    {
+        impl->player.play();
+    }
 }
 
 void Player::pause()
 {
-    impl->player.pause();
+    impl->playing = false;
+
+    if (impl->stretching)
+    {
+        impl->output->suspend();
+    }
+    else
+    {
+        impl->player.pause();
+    }
 }
 
 void Player::advance(int milliseconds)
 {
-    auto position = impl->player.position() + milliseconds;
-    impl->player.setPosition(position);
+    setPosition(position() + milliseconds);
 }
 
 void Player::reverse(int milliseconds)
 {
-    auto position = impl->player.position() - milliseconds;
-    impl->player.setPosition(position);
+    setPosition(position() - milliseconds);
 }
 
 void Player::adjustProgress(double ratio)
 {
-    qint64 position = impl->player.duration() * ratio;
-    impl->player.setPosition(position);
+    qint64 position = duration() * ratio;
+    setPosition(position);
 }
 
 void Player::adjustVolume(double ratio)
 {
-    impl->player.setVolume(100 * ratio);
+    impl->volume = ratio;
+
+    applyVolume();
+}
+
+void Player::setGain(double decibels)
+{
+    impl->gain = std::pow(10.0, decibels / 20.0);
+
+    applyVolume();
+}
+
+void Player::applyVolume()
+{
+    // 输出的音量不能超过 1， 安静的录音最多放大到音量滑块的顶端
+    double volume = qMin(1.0, impl->volume * impl->gain);
+
+    impl->player.setVolume(qRound(100 * volume));
+
+    if (impl->output)
+    {
+        impl->output->setVolume(volume);
+    }
+}
+
+void Player::setRate(double rate)
+{
+    impl->rate = qBound(0.5, rate, 1.5);
+
+    // 已经在变速输出上时只改步长， 播放不中断
+    impl->device.setRate(impl->rate);
+
+    if (impl->rate != 1.0)
+    {
+        startDecoding();
+    }
+
+    switchOutput();
+}
+
+double Player::getRate() const
+{
+    return impl->rate;
+}
+
+qint64 Player::position() const
+{
+    return impl->stretching ? impl->device.position()
+                            : impl->streamBase + impl->player.position();
+}
+
+qint64 Player::duration() const
+{
+    // 从中间某帧开始播放时 QMediaPlayer 只知道剩下的长度
+    if (impl->index && impl->index->isValid())
+    {
+        return impl->index->duration();
+    }
+
+    qint64 duration = impl->player.duration();
+
+    if (duration <= 0 && impl->device.isComplete())
+    {
+        duration = impl->device.duration();
+    }
+
+    return duration > 0 ? duration : impl->durationHint;
+}
+
+void Player::setDurationHint(qint64 duration)
+{
+    impl->durationHint = duration;
+}
+
+void Player::setSeekIndex(std::shared_ptr<const Mp3Index> index)
+{
+    impl->index = index;
+}
+
+void Player::setPosition(qint64 position)
+{
+    position = qBound(0LL, position, duration());
+
+    impl->awaitingAudio = true;
+
+    if (impl->stretching)
+    {
+        impl->device.setPosition(position);
+        emit positionChanged(position);
+    }
+    else
+    {
+        seekStream(position);
+    }
+}
+
+bool Player::prepareSeeking()
+{
+    if (impl->frames.isEmpty())
+    {
+        if (!impl->source.isEmpty())
+        {
+            impl->frames = impl->source;
+        }
+        else if (!impl->path.isEmpty())
+        {
+            // 只映射不读， 定位后 QMediaPlayer 读到哪页才载入哪页
+            impl->mappedFile.setFileName(impl->path);
+
+            if (impl->mappedFile.open(QIODevice::ReadOnly))
+            {
+                qint64 size = impl->mappedFile.size();
+
+                if (uchar* data = impl->mappedFile.map(0, size))
+                {
+                    impl->frames = QByteArray::fromRawData(
+                                reinterpret_cast<const char*>(data), size);
+                }
+            }
+        }
+    }
+
+    if (!impl->index && !impl->frames.isEmpty())
+    {
+        impl->index = std::make_shared<const Mp3Index>(Mp3Index::build(
+                reinterpret_cast<const uchar*>(impl->frames.constData()),
+                impl->frames.size()));
+    }
+
+    return impl->index && impl->index->isValid() && !impl->frames.isEmpty();
+}
+
+void Player::seekStream(qint64 position)
+{
+    // 不是 MP3 时只能交给 QMediaPlayer 自己定位
+    if (!prepareSeeking())
+    {
+        impl->player.setPosition(position);
+        return;
+    }
+
+    const Mp3Index& index = *impl->index;
+
+    int frame = qMax(0, index.frameAt(position) - RESERVOIR_FRAMES);
+    qint64 offset = index.frameOffset(frame);
+
+    // 从这一帧开始的数据当作一个新的流， 不依赖后端按码率估算位置
+    impl->player.setMedia(QMediaContent());
+    impl->seekBuffer.close();
+
+    impl->seekBuffer.setData(QByteArray::fromRawData(
+                impl->frames.constData() + offset,
+                impl->frames.size() - offset));
+    impl->seekBuffer.open(QIODevice::ReadOnly);
+
+    impl->streamBase = index.frameTime(frame);
+
+    impl->player.setMedia(QMediaContent(QUrl(impl->name)), &impl->seekBuffer);
+
+    if (impl->playing)
+    {
+        impl->player.play();
+    }
+
+    emit positionChanged(impl->streamBase);
+}
+
+void Player::startDecoding()
+{
+    if (impl->decoder.state() != QAudioDecoder::StoppedState
+            || impl->device.isComplete())
+    {
+        return;
+    }
+
+    if (!impl->path.isEmpty())
+    {
+        impl->decoder.setSourceFilename(impl->path);
+        impl->decoder.start();
+    }
+    else if (!impl->source.isEmpty())
+    {
+        impl->decoderBuffer.setData(impl->source);
+        impl->decoderBuffer.open(QIODevice::ReadOnly);
+
+        impl->decoder.setSourceDevice(&impl->decoderBuffer);
+        impl->decoder.start();
+    }
+}
+
+void Player::switchOutput()
+{
+    // 切过去以后就一直走变速输出， 避免每次跨过 1 都换输出造成断音和跳动
+    if (impl->stretching || impl->rate == 1.0)
+    {
+        return;
+    }
+
+    qint64 current = position();
+
+    // 解码还没领先当前位置时先照常播放， 数据够了再切
+    if (!impl->device.isComplete()
+            && impl->device.duration() < current + DECODE_LEAD)
+    {
+        return;
+    }
+
+    impl->player.pause();
+
+    if (!impl->output)
+    {
+        impl->output = new QAudioOutput(impl->device.outputFormat());
+        impl->output->setNotifyInterval(100);
+
+        connect(impl->output, &QAudioOutput::notify, this, [this]()
+        {
+            // 变速输出一直在拉数据， 定位后的第一次通知就已经出声了
+            if (impl->awaitingAudio)
+            {
+                impl->awaitingAudio = false;
+                emit audioResumed();
+            }
+
+            emit positionChanged(impl->device.position());
+        });
+    }
+
+    applyVolume();
+
+    if (!impl->device.isOpen())
+    {
+        impl->device.open(QIODevice::ReadOnly);
+    }
+
+    impl->device.setPosition(current);
+    impl->stretching = true;
+
+    if (impl->playing)
+    {
+        impl->output->start(&impl->device);
+    }
+}
+
+void Player::checkResumed()
+{
+    if (impl->awaitingAudio && !impl->stretching
+            && impl->player.mediaStatus() == QMediaPlayer::BufferedMedia
+            && impl->player.state() == QMediaPlayer::PlayingState)
+    {
+        impl->awaitingAudio = false;
+        emit audioResumed();
+    }
 }
@@ -1,17 +1,36 @@
 #ifndef PLAYER_H
 #define PLAYER_H
 
+#include <memory>
+
+#include <QObject>
+
+class Mp3Index;
 class QString;
 
-class Player
+// 默认直接用 QMediaPlayer 流式播放， 定位时按帧索引从准确的帧重新开始流。
+// 第一次改速度时开始解码， 解码领先播放位置以后切换到 PCM， 经过 WSOLA
+// 变速不变调再输出。 之后一直走这条路， 速度回到 1 只是变速比为 1， 不再切回来
+class Player : public QObject
 {
+    Q_OBJECT
+
 public:
-    Player();
+    explicit Player(QObject* parent = nullptr);
 
     ~Player();
 
     bool setMedia(const QString& section, const QString& fileName);
 
+    // 直接播放内存中的音频 (比如资源包的映射区域)， data 要在播放期间保持有效,
+    // name 只用来提示格式
+    void setMedia(const QByteArray& data, const QString& name);
+
+    // 媒体已经可以播放
+    bool isReady() const;
+
+    bool isPlaying() const;
+
     void play();
 
     void pause();
@@ -24,6 +43,56 @@ public:
 
     void adjustVolume(double ratio);
 
+    // 响度归一化的增益 (dB)， 与音量相乘。 换媒体时恢复为 0
+    void setGain(double decibels);
+
+    // 播放速度 0.5 ~ 1.5， 不改变音高
+    void setRate(double rate);
+
+    double getRate() const;
+
+    qint64 position() const;
+
+    qint64 duration() const;
+
+    // 媒体还没探测完时先用这个时长 (毫秒)， 比如预取时从帧头估出的
+    void setDurationHint(qint64 duration);
+
+    // 预先建好的帧索引， 没有时第一次定位再建。 换媒体时清空
+    void setSeekIndex(std::shared_ptr<const Mp3Index> index);
+
+signals:
+    void positionChanged(qint64 position);
+
+    // setMedia 之后媒体第一次可以播放
+    void ready();
+
+    // 定位之后输出重新出声
+    void audioResumed();
+
+private:
+    // 换媒体之前停掉变速输出和解码
+    void reset();
+
+    void setPosition(qint64 position);
+
+    // 把音量和增益一起交给当前的输出
+    void applyVolume();
+
+    void startDecoding();
+
+    // 准备好帧索引和整个文件的数据， 不是 MP3 时返回 false
+    bool prepareSeeking();
+
+    // 不变速时的定位: 按帧索引从准确的帧重新开始流
+    void seekStream(qint64 position);
+
+    // 从 QMediaPlayer 切换到变速输出， 保持位置和播放状态
+    void switchOutput();
+
+    // 定位以后 QMediaPlayer 缓冲好了而且在播放时发出 audioResumed
+    void checkResumed();
+
 private:
     struct Impl;
     Impl* impl;
@@ -0,0 +1,199 @@
+#include <algorithm>
+
+#include "StretchDevice.h"
+
+StretchDevice::StretchDevice(QObject* parent)
+    : QIODevice(parent)
+    , sampleRate(0)
+    , channels(0)
+    , complete(false)
+{
+}
+
+void StretchDevice::append(const void* data, int frames,
+                           const QAudioFormat& format)
+{
+    if (complete || frames <= 0)
+    {
+        return;
+    }
+
+    if (channels == 0)
+    {
+        sampleRate = format.sampleRate();
+        channels = format.channelCount();
+    }
+
+    if (format.channelCount() != channels || format.sampleRate() != sampleRate)
+    {
+        return;
+    }
+
+    size_t begin = interleaved.size();
+
+    interleaved.resize(begin + size_t(frames) * channels);
+
+    if (format.sampleType() == QAudioFormat::Float)
+    {
+        auto samples = static_cast<const float*>(data);
+
+        std::copy(samples, samples + frames * channels,
+                  interleaved.begin() + begin);
+    }
+    else if (format.sampleType() == QAudioFormat::SignedInt
+             && format.sampleSize() == 16)
+    {
+        auto samples = static_cast<const qint16*>(data);
+
+        for (int i = 0; i < frames * channels; ++i)
+        {
+            interleaved[begin + i] = samples[i] / 32768.0f;
+        }
+    }
+    else
+    {
+        interleaved.resize(begin);
+        return;
+    }
+
+    // 单声道时直接用 interleaved 找相似片段
+    if (channels > 1)
+    {
+        for (size_t f = begin / channels; f < interleaved.size() / channels;
+             ++f)
+        {
+            float sum = 0;
+
+            for (int c = 0; c < channels; ++c)
+            {
+                sum += interleaved[f * channels + c];
+            }
+
+            mono.push_back(sum / channels);
+        }
+    }
+
+    // 缓冲区变长时可能换了地方， 每次都把新的地址交给 stretcher
+    const float* similarity = channels == 1 ? interleaved.data() : mono.data();
+
+    if (begin == 0)
+    {
+        stretcher.setSource(interleaved.data(), similarity,
+                            interleaved.size() / channels, sampleRate,
+                            channels, false);
+    }
+    else
+    {
+        stretcher.extend(interleaved.data(), similarity,
+                         interleaved.size() / channels, false);
+    }
+
+    // 播到解码前沿停下的 QAudioOutput 可以接着读
+    emit readyRead();
+}
+
+void StretchDevice::finish()
+{
+    if (channels == 0)
+    {
+        return;
+    }
+
+    const float* similarity = channels == 1 ? interleaved.data() : mono.data();
+
+    stretcher.extend(interleaved.data(), similarity,
+                     interleaved.size() / channels, true);
+
+    complete = true;
+}
+
+void StretchDevice::clear()
+{
+    std::vector<float>().swap(interleaved);
+    std::vector<float>().swap(mono);
+
+    stretcher.setSource(nullptr, nullptr, 0, 1, 1);
+
+    sampleRate = 0;
+    channels = 0;
+    complete = false;
+}
+
+QAudioFormat StretchDevice::outputFormat() const
+{
+    QAudioFormat format;
+
+    format.setSampleRate(sampleRate);
+    format.setChannelCount(channels);
+    format.setSampleSize(16);
+    format.setSampleType(QAudioFormat::SignedInt);
+    format.setByteOrder(QAudioFormat::LittleEndian);
+    format.setCodec("audio/pcm");
+
+    return format;
+}
+
+void StretchDevice::setRate(double rate)
+{
+    stretcher.setRate(rate);
+}
+
+void StretchDevice::setPosition(qint64 milliseconds)
+{
+    if (sampleRate > 0)
+    {
+        stretcher.seek(milliseconds * sampleRate / 1000);
+    }
+}
+
+qint64 StretchDevice::position() const
+{
+    return sampleRate > 0 ? stretcher.position() * 1000 / sampleRate : 0;
+}
+
+qint64 StretchDevice::duration() const
+{
+    return sampleRate > 0
+            ? qint64(interleaved.size() / channels) * 1000 / sampleRate : 0;
+}
+
+qint64 StretchDevice::bytesAvailable() const
+{
+    if (channels == 0 || stretcher.atEnd() || stretcher.isStarved())
+    {
+        return QIODevice::bytesAvailable();
+    }
+
+    // 慢放时输出比输入多， 这里只要告诉 QAudioOutput 还有数据
+    return QIODevice::bytesAvailable() + 4096 * channels * sizeof(qint16);
+}
+
+qint64 StretchDevice::readData(char* data, qint64 maxSize)
+{
+    if (channels == 0)
+    {
+        return 0;
+    }
+
+    int frames = static_cast<int>(maxSize / (channels * sizeof(qint16)));
+
+    scratch.resize(size_t(frames) * channels);
+
+    int written = stretcher.process(scratch.data(), frames);
+
+    auto output = reinterpret_cast<qint16*>(data);
+
+    for (int i = 0; i < written * channels; ++i)
+    {
+        float sample = std::min(1.0f, std::max(-1.0f, scratch[i]));
+
+        output[i] = static_cast<qint16>(sample * 32767.0f);
+    }
+
+    return qint64(written) * channels * sizeof(qint16);
+}
+
+qint64 StretchDevice::writeData(const char*, qint64)
+{
+    return -1;
+}
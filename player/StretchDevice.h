@@ -0,0 +1,66 @@
+#ifndef STRETCHDEVICE_H
+#define STRETCHDEVICE_H
+
+#include <vector>
+
+#include <QAudioFormat>
+#include <QIODevice>
+
+#include "TimeStretcher.h"
+
+// 持有解码后的 PCM， 以 16 位整数的形式把变速后的音频交给 QAudioOutput。
+// 边解码边播放， 播到还没解码的地方就先停下等数据
+class StretchDevice : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    explicit StretchDevice(QObject* parent = nullptr);
+
+    // 解码器交来的一块数据， 支持 16 位整数和 32 位浮点
+    void append(const void* data, int frames, const QAudioFormat& format);
+
+    // 全部数据都到了
+    void finish();
+
+    void clear();
+
+    bool isComplete() const
+    {
+        return complete;
+    }
+
+    QAudioFormat outputFormat() const;
+
+    void setRate(double rate);
+
+    void setPosition(qint64 milliseconds);
+
+    qint64 position() const;
+
+    // 已经解码的长度， 解码完以后就是整段的时长
+    qint64 duration() const;
+
+    bool isSequential() const override
+    {
+        return true;
+    }
+
+    qint64 bytesAvailable() const override;
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override;
+
+    qint64 writeData(const char* data, qint64 maxSize) override;
+
+private:
+    std::vector<float> interleaved;
+    std::vector<float> mono;
+    std::vector<float> scratch;
+    TimeStretcher stretcher;
+    int sampleRate;
+    int channels;
+    bool complete;
+};
+
+#endif // STRETCHDEVICE_H
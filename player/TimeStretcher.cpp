@@ -0,0 +1,262 @@
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define STRETCHER_SSE
+#endif
+
+#include "TimeStretcher.h"
+
+namespace
+{
+
+// 窗口 40ms， 搜索范围前后各 10ms
+const double WINDOW_SECONDS = 0.04;
+const double TOLERANCE_SECONDS = 0.01;
+
+const double MIN_RATE = 0.5;
+const double MAX_RATE = 1.5;
+
+const double PI = 3.14159265358979323846;
+
+// 找相似片段时的内积， 整个算法的热点
+float dot(const float* a, const float* b, int n)
+{
+    int i = 0;
+    float result = 0;
+
+#ifdef STRETCHER_SSE
+    // 两个累加器交替使用， 让乘加可以流水
+    __m128 first = _mm_setzero_ps();
+    __m128 second = _mm_setzero_ps();
+
+    for (; i + 8 <= n; i += 8)
+    {
+        first = _mm_add_ps(first, _mm_mul_ps(_mm_loadu_ps(a + i),
+                                             _mm_loadu_ps(b + i)));
+        second = _mm_add_ps(second, _mm_mul_ps(_mm_loadu_ps(a + i + 4),
+                                               _mm_loadu_ps(b + i + 4)));
+    }
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, _mm_add_ps(first, second));
+
+    result = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+
+    for (; i < n; ++i)
+    {
+        result += a[i] * b[i];
+    }
+
+    return result;
+}
+
+} //! end anonymous namespace
+
+TimeStretcher::TimeStretcher()
+    : interleaved(nullptr)
+    , mono(nullptr)
+    , frames(0)
+    , channels(1)
+    , complete(true)
+    , rate(1.0)
+    , window(2)
+    , hop(1)
+    , tolerance(0)
+    , nominal(0)
+    , previous(-1)
+    , pendingOffset(0)
+{
+}
+
+void TimeStretcher::setSource(const float* interleaved, const float* mono,
+                              long long frames, int sampleRate, int channels,
+                              bool complete)
+{
+    this->interleaved = interleaved;
+    this->mono = mono;
+    this->frames = frames;
+    this->channels = std::max(1, channels);
+    this->complete = complete;
+
+    hop = std::max(1, static_cast<int>(sampleRate * WINDOW_SECONDS / 2));
+    window = 2 * hop;
+    tolerance = static_cast<int>(sampleRate * TOLERANCE_SECONDS);
+
+    // 周期 Hann 窗， 半窗重叠时相加恰好为 1
+    hann.resize(window);
+
+    for (int i = 0; i < window; ++i)
+    {
+        hann[i] = static_cast<float>(0.5 - 0.5 * std::cos(2 * PI * i / window));
+    }
+
+    seek(0);
+}
+
+void TimeStretcher::extend(const float* interleaved, const float* mono,
+                           long long frames, bool complete)
+{
+    this->interleaved = interleaved;
+    this->mono = mono;
+    this->frames = frames;
+    this->complete = complete;
+}
+
+void TimeStretcher::setRate(double rate)
+{
+    this->rate = std::min(MAX_RATE, std::max(MIN_RATE, rate));
+}
+
+void TimeStretcher::seek(long long frame)
+{
+    // 还在解码时可以定位到没到的地方， 数据到了再出声
+    frame = std::max(0LL, frame);
+    nominal = static_cast<double>(complete ? std::min(frame, frames) : frame);
+    previous = -1;
+
+    overlap.assign(size_t(hop) * channels, 0.0f);
+    pending.clear();
+    pendingOffset = 0;
+}
+
+long long TimeStretcher::position() const
+{
+    // pending 里还没播放的部分折算回输入位置
+    int buffered = (static_cast<int>(pending.size()) - pendingOffset)
+            / channels;
+
+    return std::max(0LL, static_cast<long long>(nominal - buffered * rate));
+}
+
+bool TimeStretcher::atEnd() const
+{
+    return complete && nominal >= frames
+            && pendingOffset >= static_cast<int>(pending.size());
+}
+
+bool TimeStretcher::isStarved() const
+{
+    // 下一段的窗口和搜索范围都要落在已有的数据里， 不拿没到的数据当静音
+    return !complete && std::llround(nominal) + window + tolerance > frames;
+}
+
+long long TimeStretcher::search(long long target, long long natural) const
+{
+    if (natural < 0 || natural + hop > frames)
+    {
+        return target;
+    }
+
+    long long first = std::max(0LL, target - tolerance);
+    long long last = std::min(frames - hop, target + tolerance);
+
+    if (first > last)
+    {
+        return std::min(std::max(0LL, target), std::max(0LL, frames - hop));
+    }
+
+    const float* reference = mono + natural;
+
+    long long best = first;
+    float bestScore = -1e30f;
+
+    // 先隔一个位置粗搜， 再在最好的位置两侧细搜
+    for (long long k = first; k <= last; k += 2)
+    {
+        float score = dot(mono + k, reference, hop);
+
+        if (score > bestScore)
+        {
+            bestScore = score;
+            best = k;
+        }
+    }
+
+    for (long long k = std::max(first, best - 1);
+         k <= std::min(last, best + 1); k += 2)
+    {
+        float score = dot(mono + k, reference, hop);
+
+        if (score > bestScore)
+        {
+            bestScore = score;
+            best = k;
+        }
+    }
+
+    return best;
+}
+
+void TimeStretcher::step()
+{
+    long long target = std::llround(nominal);
+
+    long long start = previous < 0 ? target : search(target, previous + hop);
+
+    pending.assign(size_t(hop) * channels, 0.0f);
+    pendingOffset = 0;
+
+    for (int f = 0; f < window; ++f)
+    {
+        long long frame = start + f;
+
+        bool inside = frame >= 0 && frame < frames;
+
+        for (int c = 0; c < channels; ++c)
+        {
+            float sample = inside ? interleaved[frame * channels + c] : 0.0f;
+
+            if (f < hop)
+            {
+                pending[f * channels + c] = overlap[f * channels + c]
+                        + hann[f] * sample;
+            }
+            else
+            {
+                overlap[(f - hop) * channels + c] = hann[f] * sample;
+            }
+        }
+    }
+
+    previous = start;
+    nominal += hop * rate;
+}
+
+int TimeStretcher::process(float* output, int count)
+{
+    if (!interleaved)
+    {
+        return 0;
+    }
+
+    int written = 0;
+
+    while (written < count)
+    {
+        if (pendingOffset >= static_cast<int>(pending.size()))
+        {
+            if (nominal >= frames || isStarved())
+            {
+                break;
+            }
+
+            step();
+        }
+
+        int available = (static_cast<int>(pending.size()) - pendingOffset)
+                / channels;
+        int n = std::min(available, count - written);
+
+        std::copy(pending.begin() + pendingOffset,
+                  pending.begin() + pendingOffset + n * channels,
+                  output + written * channels);
+
+        pendingOffset += n * channels;
+        written += n;
+    }
+
+    return written;
+}
@@ -0,0 +1,81 @@
+#ifndef TIMESTRETCHER_H
+#define TIMESTRETCHER_H
+
+#include <vector>
+
+// WSOLA (波形相似叠加) 变速不变调。
+// 每次输出半个窗口: 在名义位置附近找与上一段的自然延续最相似的输入片段,
+// 用 Hann 窗叠加。 速度只影响名义位置前进的步长， 所以播放中改变速度不会有断裂
+class TimeStretcher
+{
+public:
+    TimeStretcher();
+
+    // interleaved 是交错存放的多声道样本， mono 是混合成单声道的同一段音频，
+    // 只用来找相似片段。 两者都由调用者持有。
+    // complete 为 false 时后面还会 extend， 合成到已有数据的末尾就先停下等
+    void setSource(const float* interleaved, const float* mono,
+                   long long frames, int sampleRate, int channels,
+                   bool complete = true);
+
+    // 边解码边播放时数据变长了 (缓冲区也可能换了地方)， 播放位置不变
+    void extend(const float* interleaved, const float* mono,
+                long long frames, bool complete);
+
+    // 播放速度， 限制在 0.5 ~ 1.5 之间
+    void setRate(double rate);
+
+    double getRate() const
+    {
+        return rate;
+    }
+
+    // 从输入的第 frame 帧重新开始
+    void seek(long long frame);
+
+    // 当前播放到的输入位置 (帧)
+    long long position() const;
+
+    bool atEnd() const;
+
+    // 数据还没到， 暂时合成不出来
+    bool isStarved() const;
+
+    // 写出至多 frames 帧交错样本， 返回实际写出的帧数
+    int process(float* output, int frames);
+
+private:
+    // 生成下一段 hop 帧， 放进 pending
+    void step();
+
+    long long search(long long nominal, long long natural) const;
+
+private:
+    const float* interleaved;
+    const float* mono;
+    long long frames;
+    int channels;
+    bool complete;
+
+    double rate;
+
+    // 窗口长度、 合成步长 (半个窗口) 和搜索范围， 单位都是帧
+    int window;
+    int hop;
+    int tolerance;
+
+    std::vector<float> hann;
+
+    // 下一段的名义起点， 以及上一段实际选中的起点
+    double nominal;
+    long long previous;
+
+    // 上一段窗口后半部分， 等着和下一段叠加
+    std::vector<float> overlap;
+
+    // 已合成还没交出去的输出
+    std::vector<float> pending;
+    int pendingOffset;
+};
+
+#endif // TIMESTRETCHER_H
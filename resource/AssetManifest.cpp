@@ -0,0 +1,201 @@
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include "AssetManifest.h"
+#include "CorpusIndex.h"
+
+namespace
+{
+
+const quint32 MAGIC = 0x4C414D31; // "LAM1"
+const quint32 VERSION = 1;
+
+} //! end anonymous namespace
+
+AssetManifest::AssetManifest()
+    : valid(false)
+{
+}
+
+quint64 AssetManifest::fileStamp(const QString& path)
+{
+    QFileInfo info(path);
+
+    if (!info.exists())
+    {
+        return 0;
+    }
+
+    return quint64(info.lastModified().toMSecsSinceEpoch()) * 31
+            + quint64(info.size());
+}
+
+bool AssetManifest::load(const QString& directory,
+                         const QString& dataDirectory)
+{
+    this->directory = directory;
+    this->dataDirectory = dataDirectory;
+
+    builtFrom.clear();
+    units.clear();
+    valid = false;
+
+    QFile file(directory + "/manifest");
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    QDataStream is(&file);
+    is.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    QString root;
+    quint32 unitCount = 0;
+
+    is >> magic >> version;
+
+    if (magic != MAGIC || version != VERSION)
+    {
+        return false;
+    }
+
+    is >> root >> unitCount;
+
+    QHash<QString, Entry> loaded;
+
+    for (quint32 i = 0; i < unitCount && is.status() == QDataStream::Ok; ++i)
+    {
+        QString name;
+        Entry entry {};
+
+        is >> name >> entry.audioStamp >> entry.audioHash
+           >> entry.answerStamp >> entry.answerHash >> entry.duration;
+
+        loaded.insert(name, entry);
+    }
+
+    if (is.status() != QDataStream::Ok)
+    {
+        return false;
+    }
+
+    builtFrom = root;
+    units = loaded;
+    valid = true;
+
+    return true;
+}
+
+bool AssetManifest::save() const
+{
+    QSaveFile file(directory + "/manifest");
+
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    QDataStream os(&file);
+    os.setVersion(QDataStream::Qt_5_0);
+
+    os << MAGIC << VERSION << dataDirectory << quint32(units.size());
+
+    for (auto it = units.cbegin(); it != units.cend(); ++it)
+    {
+        const Entry& entry = it.value();
+
+        os << it.key() << entry.audioStamp << entry.audioHash
+           << entry.answerStamp << entry.answerHash << entry.duration;
+    }
+
+    return os.status() == QDataStream::Ok && file.commit();
+}
+
+bool AssetManifest::hasIndexes() const
+{
+    return valid && builtFrom == dataDirectory;
+}
+
+QString AssetManifest::indexPath() const
+{
+    return directory + "/english_data.index";
+}
+
+QString AssetManifest::searchPath() const
+{
+    return directory + "/english_data.search";
+}
+
+QString AssetManifest::seekPath(quint64 audioHash) const
+{
+    return QString("%1/seek/%2.idx").arg(directory)
+            .arg(audioHash, 16, 16, QChar('0'));
+}
+
+QString AssetManifest::relativeName(const QString& unit) const
+{
+    if (!unit.startsWith(dataDirectory + '/'))
+    {
+        return QString();
+    }
+
+    return unit.mid(dataDirectory.size() + 1);
+}
+
+void AssetManifest::setEntries(const QHash<QString, Entry>& entries)
+{
+    units = entries;
+    valid = true;
+}
+
+const AssetManifest::Entry* AssetManifest::find(const QString& unit) const
+{
+    auto it = units.constFind(relativeName(unit));
+
+    if (it == units.constEnd() || it->audioStamp != fileStamp(unit))
+    {
+        return nullptr;
+    }
+
+    return &it.value();
+}
+
+quint64 AssetManifest::answerStamp(const QString& unit) const
+{
+    quint64 stamp = CorpusIndex::fileStamp(unit);
+
+    auto it = units.constFind(relativeName(unit));
+
+    if (it != units.constEnd() && it->answerStamp == stamp)
+    {
+        return it->answerHash;
+    }
+
+    return stamp;
+}
+
+std::shared_ptr<const Mp3Index> AssetManifest::seekIndex(
+        const QString& unit) const
+{
+    const Entry* entry = find(unit);
+
+    if (entry == nullptr || entry->duration <= 0)
+    {
+        return nullptr;
+    }
+
+    auto index = std::make_shared<Mp3Index>();
+
+    if (!index->load(seekPath(entry->audioHash)))
+    {
+        return nullptr;
+    }
+
+    return index;
+}
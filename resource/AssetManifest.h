@@ -0,0 +1,86 @@
+#ifndef ASSETMANIFEST_H
+#define ASSETMANIFEST_H
+
+#include <memory>
+
+#include <QHash>
+#include <QString>
+
+#include "player/Mp3Index.h"
+
+// tools/assets 离线生成的派生数据， 程序启动时直接使用。 目录布局:
+//   manifest              每个单元输入的版本戳、 内容哈希和时长
+//   english_data.index    CorpusIndex
+//   english_data.search   SearchIndex
+//   seek/<音频哈希>.idx    Mp3Index
+// manifest 里的单元名是相对数据目录的 "section/unit.mp3"。
+// 语料索引里的单元名是完整路径， 只有数据目录与构建时相同才能用
+class AssetManifest
+{
+public:
+    struct Entry
+    {
+        // 文件的修改时间和大小， 没变时不用重新读内容
+        quint64 audioStamp;
+        quint64 audioHash;
+        quint64 answerStamp;
+        // 没有原文时为 0
+        quint64 answerHash;
+        // 毫秒
+        qint64 duration;
+    };
+
+    AssetManifest();
+
+    // dataDirectory 是 english_data 的完整路径
+    bool load(const QString& directory, const QString& dataDirectory);
+
+    // 记下当前的数据目录
+    bool save() const;
+
+    bool isValid() const
+    {
+        return valid;
+    }
+
+    // 构建时的数据目录与现在的相同
+    bool hasIndexes() const;
+
+    QString indexPath() const;
+
+    QString searchPath() const;
+
+    QString seekPath(quint64 audioHash) const;
+
+    // unit 是音频的完整路径。 没有记录或音频改过时返回 nullptr
+    const Entry* find(const QString& unit) const;
+
+    // 原文的版本戳: 文件没改过时用构建时的内容哈希， 与预先建好的语料索引一致
+    quint64 answerStamp(const QString& unit) const;
+
+    // 预先建好的帧索引， 没有时返回空
+    std::shared_ptr<const Mp3Index> seekIndex(const QString& unit) const;
+
+    // 构建工具用， 单元名是相对数据目录的
+    const QHash<QString, Entry>& entries() const
+    {
+        return units;
+    }
+
+    void setEntries(const QHash<QString, Entry>& entries);
+
+    // 单元相对数据目录的名字
+    QString relativeName(const QString& unit) const;
+
+    static quint64 fileStamp(const QString& path);
+
+private:
+    QString directory;
+    QString dataDirectory;
+    // 构建时的数据目录
+    QString builtFrom;
+    QHash<QString, Entry> units;
+    bool valid;
+};
+
+#endif // ASSETMANIFEST_H
@@ -0,0 +1,494 @@
+#include <algorithm>
+#include <numeric>
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QThreadPool>
+
+#include "Assessor/Tokenizer.h"
+#include "CorpusIndex.h"
+#include "Prefetcher.h"
+#include "common/PoolJob.h"
+
+namespace
+{
+
+const quint32 MAGIC = 0x4C434931; // "LCI1"
+const quint32 VERSION = 1;
+
+// 平均句长达到这么多词时算最难
+const double LONG_SENTENCE = 30.0;
+
+} //! end anonymous namespace
+
+CorpusIndex::CorpusIndex()
+{
+}
+
+quint64 CorpusIndex::fileStamp(const QString& unit)
+{
+    QFileInfo info(Prefetcher::answerPath(unit));
+
+    if (!info.exists())
+    {
+        return 0;
+    }
+
+    return quint64(info.lastModified().toMSecsSinceEpoch()) * 31
+            + quint64(info.size());
+}
+
+QString CorpusIndex::readFile(const QString& unit)
+{
+    QFile file(Prefetcher::answerPath(unit));
+
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        return QString();
+    }
+
+    QTextStream is(&file);
+
+    return is.readAll();
+}
+
+CorpusIndex::Parsed CorpusIndex::parse(const QString& text)
+{
+    Parsed parsed { 0, 0, QHash<QString, quint32>() };
+
+    Lexicon lexicon;
+
+    // 当前句子里已经有几个词
+    quint32 pending = 0;
+
+    for (const Token& token : tokenize(text, &lexicon))
+    {
+        const QChar* data = text.constData() + token.offset;
+
+        if (!token.skippable)
+        {
+            // 数字不算生词
+            if (data->isLetter())
+            {
+                ++parsed.counts[QString(data, token.length).toLower()];
+            }
+
+            ++parsed.words;
+            ++pending;
+            continue;
+        }
+
+        for (int i = 0; i < token.length && pending > 0; ++i)
+        {
+            if (data[i] == QLatin1Char('.') || data[i] == QLatin1Char('!')
+                    || data[i] == QLatin1Char('?'))
+            {
+                ++parsed.sentences;
+                pending = 0;
+            }
+        }
+    }
+
+    // 最后一句没有句号
+    if (pending > 0)
+    {
+        ++parsed.sentences;
+    }
+
+    return parsed;
+}
+
+quint32 CorpusIndex::intern(const QString& word)
+{
+    auto it = wordIds.find(word);
+
+    if (it != wordIds.end())
+    {
+        return it.value();
+    }
+
+    quint32 id = vocabulary.size();
+
+    vocabulary.push_back(word);
+    wordIds.insert(word, id);
+    counts.push_back(0);
+
+    return id;
+}
+
+void CorpusIndex::add(const Unit& unit, int sign)
+{
+    for (const auto& term : unit.terms)
+    {
+        counts[term.first] += sign * static_cast<int>(term.second);
+    }
+}
+
+int CorpusIndex::update(const QStringList& list)
+{
+    return update(list, &CorpusIndex::fileStamp, &CorpusIndex::readFile);
+}
+
+int CorpusIndex::update(const QStringList& list, const Stamp& stamp,
+                        const Reader& reader)
+{
+    QSet<QString> current;
+
+    for (const QString& unit : list)
+    {
+        current.insert(unit);
+    }
+    bool changed = false;
+
+    for (auto it = units.begin(); it != units.end(); )
+    {
+        if (!current.contains(it.key()))
+        {
+            add(it.value(), -1);
+            it = units.erase(it);
+            changed = true;
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    QStringList stale;
+    std::vector<quint64> stamps;
+
+    for (const QString& unit : list)
+    {
+        quint64 version = stamp(unit);
+        auto it = units.constFind(unit);
+
+        if (it == units.constEnd() || it->stamp != version)
+        {
+            stale.push_back(unit);
+            stamps.push_back(version);
+        }
+    }
+
+    // 每个单元各自分词， 结果放在自己的位置上， 不需要加锁
+    std::vector<Parsed> parsed(stale.size());
+
+    {
+        QThreadPool pool;
+
+        for (int i = 0; i < stale.size(); ++i)
+        {
+            pool.start(new PoolJob([&, i]()
+            {
+                parsed[i] = parse(reader(stale[i]));
+            }));
+        }
+
+        pool.waitForDone();
+    }
+
+    // 合并在调用线程里做， 词号的分配与线程调度无关
+    for (int i = 0; i < stale.size(); ++i)
+    {
+        auto old = units.find(stale[i]);
+
+        if (old != units.end())
+        {
+            add(old.value(), -1);
+        }
+
+        Unit unit {};
+
+        unit.stamp = stamps[i];
+        unit.words = parsed[i].words;
+        unit.sentences = parsed[i].sentences;
+
+        for (auto it = parsed[i].counts.cbegin();
+             it != parsed[i].counts.cend(); ++it)
+        {
+            unit.terms.emplace_back(intern(it.key()), it.value());
+        }
+
+        std::sort(unit.terms.begin(), unit.terms.end());
+
+        add(unit, 1);
+
+        units.insert(stale[i], unit);
+        changed = true;
+    }
+
+    if (changed)
+    {
+        refresh();
+    }
+
+    return stale.size();
+}
+
+void CorpusIndex::refresh()
+{
+    std::vector<quint32> order(counts.size());
+
+    std::iota(order.begin(), order.end(), 0);
+
+    size_t top = std::min<size_t>(COMMON_WORDS, order.size());
+
+    std::partial_sort(order.begin(), order.begin() + top, order.end(),
+                      [this](quint32 lhs, quint32 rhs)
+    {
+        return counts[lhs] > counts[rhs];
+    });
+
+    common.assign(counts.size(), false);
+
+    for (size_t i = 0; i < top && counts[order[i]] > 0; ++i)
+    {
+        common[order[i]] = true;
+    }
+
+    for (Unit& unit : units)
+    {
+        quint32 rare = 0;
+
+        for (const auto& term : unit.terms)
+        {
+            if (!common[term.first])
+            {
+                rare += term.second;
+            }
+        }
+
+        UnitFeatures& features = unit.features;
+
+        features.words = unit.words;
+        features.distinct = unit.terms.size();
+        features.sentences = unit.sentences;
+        features.sentenceLength = unit.sentences > 0
+                ? float(unit.words) / unit.sentences : 0.0f;
+        features.rareDensity = unit.words > 0
+                ? float(rare) / unit.words : 0.0f;
+    }
+}
+
+UnitFeatures CorpusIndex::features(const QString& unit) const
+{
+    return units.value(unit).features;
+}
+
+quint32 CorpusIndex::frequency(const QString& word) const
+{
+    auto it = wordIds.find(word.toLower());
+
+    return it == wordIds.end() ? 0 : counts[it.value()];
+}
+
+std::vector<bool> CorpusIndex::knownMask(const QSet<QString>& known) const
+{
+    std::vector<bool> mask(vocabulary.size(), false);
+
+    for (const QString& word : known)
+    {
+        auto it = wordIds.find(word.toLower());
+
+        if (it != wordIds.end())
+        {
+            mask[it.value()] = true;
+        }
+    }
+
+    return mask;
+}
+
+double CorpusIndex::overlap(const QString& unit,
+                            const QSet<QString>& known) const
+{
+    auto it = units.find(unit);
+
+    if (it == units.end() || it->terms.empty())
+    {
+        return 0.0;
+    }
+
+    std::vector<bool> mask = knownMask(known);
+
+    auto count = std::count_if(it->terms.begin(), it->terms.end(),
+                               [&](const std::pair<quint32, quint32>& term)
+    {
+        return mask[term.first];
+    });
+
+    return double(count) / it->terms.size();
+}
+
+double CorpusIndex::difficulty(const Unit& unit,
+                               const std::vector<bool>* known) const
+{
+    const UnitFeatures& features = unit.features;
+
+    double length = std::min(1.0, features.sentenceLength / LONG_SENTENCE);
+    double unknown = features.rareDensity;
+
+    if (known && !unit.terms.empty())
+    {
+        auto count = std::count_if(unit.terms.begin(), unit.terms.end(),
+                                   [&](const std::pair<quint32, quint32>& term)
+        {
+            return (*known)[term.first];
+        });
+
+        unknown = 1.0 - double(count) / unit.terms.size();
+    }
+
+    return 100.0 * (0.5 * features.rareDensity + 0.3 * length
+                    + 0.2 * unknown);
+}
+
+double CorpusIndex::difficulty(const QString& unit,
+                               const QSet<QString>& known) const
+{
+    auto it = units.find(unit);
+
+    if (it == units.end())
+    {
+        return 0.0;
+    }
+
+    if (known.isEmpty())
+    {
+        return difficulty(it.value(), nullptr);
+    }
+
+    std::vector<bool> mask = knownMask(known);
+
+    return difficulty(it.value(), &mask);
+}
+
+QHash<QString, double> CorpusIndex::difficulties(
+        const QSet<QString>& known) const
+{
+    std::vector<bool> mask = knownMask(known);
+
+    QHash<QString, double> result;
+
+    for (auto it = units.cbegin(); it != units.cend(); ++it)
+    {
+        result.insert(it.key(), difficulty(it.value(),
+                                           known.isEmpty() ? nullptr : &mask));
+    }
+
+    return result;
+}
+
+bool CorpusIndex::save(const QString& path) const
+{
+    QSaveFile file(path);
+
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    QDataStream os(&file);
+    os.setVersion(QDataStream::Qt_5_0);
+
+    os << MAGIC << VERSION << vocabulary << quint32(units.size());
+
+    for (auto it = units.cbegin(); it != units.cend(); ++it)
+    {
+        const Unit& unit = it.value();
+
+        os << it.key() << unit.stamp << unit.words << unit.sentences
+           << quint32(unit.terms.size());
+
+        for (const auto& term : unit.terms)
+        {
+            os << term.first << term.second;
+        }
+    }
+
+    return os.status() == QDataStream::Ok && file.commit();
+}
+
+bool CorpusIndex::load(const QString& path)
+{
+    QFile file(path);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    QDataStream is(&file);
+    is.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    QStringList words;
+    quint32 unitCount = 0;
+
+    is >> magic >> version;
+
+    if (magic != MAGIC || version != VERSION)
+    {
+        return false;
+    }
+
+    is >> words >> unitCount;
+
+    QHash<QString, Unit> loaded;
+
+    for (quint32 i = 0; i < unitCount && is.status() == QDataStream::Ok; ++i)
+    {
+        QString key;
+        Unit unit {};
+        quint32 termCount = 0;
+
+        is >> key >> unit.stamp >> unit.words >> unit.sentences >> termCount;
+
+        for (quint32 t = 0; t < termCount && is.status() == QDataStream::Ok;
+             ++t)
+        {
+            quint32 id = 0;
+            quint32 count = 0;
+
+            is >> id >> count;
+
+            if (id >= quint32(words.size()))
+            {
+                return false;
+            }
+
+            unit.terms.emplace_back(id, count);
+        }
+
+        loaded.insert(key, unit);
+    }
+
+    if (is.status() != QDataStream::Ok)
+    {
+        return false;
+    }
+
+    vocabulary = words;
+    wordIds.clear();
+
+    for (int i = 0; i < vocabulary.size(); ++i)
+    {
+        wordIds.insert(vocabulary[i], i);
+    }
+
+    counts.assign(vocabulary.size(), 0);
+    units = loaded;
+
+    for (const Unit& unit : units)
+    {
+        add(unit, 1);
+    }
+
+    refresh();
+
+    return true;
+}
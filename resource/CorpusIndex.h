@@ -0,0 +1,132 @@
+#ifndef CORPUSINDEX_H
+#define CORPUSINDEX_H
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include <QHash>
+#include <QMetaType>
+#include <QSet>
+#include <QSharedPointer>
+#include <QStringList>
+
+// 单元原文的特征， 用来估计难度
+struct UnitFeatures
+{
+    // 单词总数和不同单词数
+    quint32 words;
+    quint32 distinct;
+    quint32 sentences;
+    // 平均句长 (词)
+    float sentenceLength;
+    // 不在全库最常用的 COMMON_WORDS 个词里的单词比例
+    float rareDensity;
+};
+
+// 全部原文的词频表和每个单元的特征。
+// 保存时每个单元带着自己的词表和时间戳， 再次 update 时只重新分词改动过的单元，
+// 全库词频由各单元的词表累加得到
+class CorpusIndex
+{
+public:
+    // 单元的版本戳， 变了就要重新分词
+    using Stamp = std::function<quint64(const QString& unit)>;
+
+    // 读单元的原文， 会在多个线程里同时调用
+    using Reader = std::function<QString(const QString& unit)>;
+
+    static const int COMMON_WORDS = 2000;
+
+    CorpusIndex();
+
+    bool load(const QString& path);
+
+    bool save(const QString& path) const;
+
+    // 让索引与 units 一致: 新的和改过的单元并行分词， 不在 units 里的删掉。
+    // 返回重新分词的单元数
+    int update(const QStringList& units, const Stamp& stamp,
+               const Reader& reader);
+
+    // 单元是音频路径， 原文按 Prefetcher::answerPath 找
+    int update(const QStringList& units);
+
+    int unitCount() const
+    {
+        return units.size();
+    }
+
+    bool contains(const QString& unit) const
+    {
+        return units.contains(unit);
+    }
+
+    UnitFeatures features(const QString& unit) const;
+
+    // 单词 (小写) 在全部原文中出现的次数
+    quint32 frequency(const QString& word) const;
+
+    // 单元中已掌握的单词占不同单词的比例
+    double overlap(const QString& unit, const QSet<QString>& known) const;
+
+    // 0 ~ 100， 越大越难。 known 为空时用生词比例代替
+    double difficulty(const QString& unit,
+                      const QSet<QString>& known = QSet<QString>()) const;
+
+    // 所有单元的难度， 已掌握的词只转换一次
+    QHash<QString, double> difficulties(
+            const QSet<QString>& known = QSet<QString>()) const;
+
+    static quint64 fileStamp(const QString& unit);
+
+    static QString readFile(const QString& unit);
+
+private:
+    struct Unit
+    {
+        quint64 stamp;
+        quint32 words;
+        quint32 sentences;
+        // (词号, 次数)， 按词号排序
+        std::vector<std::pair<quint32, quint32>> terms;
+        UnitFeatures features;
+    };
+
+    // 一个单元分词的结果， 在工作线程中生成
+    struct Parsed
+    {
+        quint32 words;
+        quint32 sentences;
+        QHash<QString, quint32> counts;
+    };
+
+    static Parsed parse(const QString& text);
+
+    quint32 intern(const QString& word);
+
+    void add(const Unit& unit, int sign);
+
+    // 词频变了以后重新计算常用词和每个单元的生词比例
+    void refresh();
+
+    std::vector<bool> knownMask(const QSet<QString>& known) const;
+
+    double difficulty(const Unit& unit, const std::vector<bool>* known) const;
+
+private:
+    QStringList vocabulary;
+    QHash<QString, quint32> wordIds;
+    // 每个词在全库的出现次数
+    std::vector<quint32> counts;
+    // 最常用的 COMMON_WORDS 个词
+    std::vector<bool> common;
+    QHash<QString, Unit> units;
+};
+
+// 后台建好的索引整个交回 GUI 线程
+using CorpusPointer = QSharedPointer<const CorpusIndex>;
+
+Q_DECLARE_METATYPE(CorpusPointer)
+
+#endif // CORPUSINDEX_H
@@ -0,0 +1,196 @@
+#include <QFile>
+#include <QMutexLocker>
+#include <QTextStream>
+
+#include "Prefetcher.h"
+#include "common/PoolJob.h"
+
+namespace
+{
+
+// 先读这么多来找帧头， 再按码率补到 HEAD_SECONDS 秒
+const qint64 PROBE_BYTES = 64 * 1024;
+const int HEAD_SECONDS = 5;
+const qint64 MAX_HEAD_BYTES = 512 * 1024;
+
+} //! end anonymous namespace
+
+qint64 Prefetched::cost() const
+{
+    qint64 bytes = sizeof(Prefetched) + head.size();
+
+    if (index)
+    {
+        bytes += index->memoryCost();
+    }
+
+    if (answer)
+    {
+        bytes += answer->text.size() * sizeof(QChar)
+                + answer->tokens.size() * sizeof(Token)
+                + answer->lexicon.size() * 2 * sizeof(void*);
+    }
+
+    return bytes;
+}
+
+Prefetcher::Prefetcher(qint64 budget, int ahead)
+    : budget(budget)
+    , ahead(ahead)
+    , used(0)
+{
+    // 预取主要等磁盘， 两个线程足够， 也不会抢评估的 CPU
+    pool.setMaxThreadCount(2);
+}
+
+Prefetcher::~Prefetcher()
+{
+    pool.clear();
+    pool.waitForDone();
+}
+
+QString Prefetcher::answerPath(const QString& unit)
+{
+    return QString(unit).remove(".mp3");
+}
+
+void Prefetcher::setOrder(const QStringList& units)
+{
+    QMutexLocker locker(&mutex);
+
+    order = units;
+    orderIndex.clear();
+
+    for (int i = 0; i < order.size(); ++i)
+    {
+        orderIndex.insert(order[i], i);
+    }
+}
+
+void Prefetcher::touch(const QString& unit)
+{
+    QStringList wanted { unit };
+
+    {
+        QMutexLocker locker(&mutex);
+
+        int index = orderIndex.value(unit, -1);
+
+        for (int i = 1; index != -1 && i <= ahead
+             && index + i < order.size(); ++i)
+        {
+            wanted.push_back(order[index + i]);
+        }
+    }
+
+    for (const QString& next : wanted)
+    {
+        schedule(next);
+    }
+}
+
+PrefetchedPointer Prefetcher::find(const QString& unit)
+{
+    QMutexLocker locker(&mutex);
+
+    auto iter = cache.find(unit);
+
+    if (iter == cache.end())
+    {
+        return nullptr;
+    }
+
+    recency.splice(recency.begin(), recency, iter->position);
+
+    return iter->entry;
+}
+
+void Prefetcher::schedule(const QString& unit)
+{
+    {
+        QMutexLocker locker(&mutex);
+
+        if (cache.contains(unit) || loading.contains(unit))
+        {
+            return;
+        }
+
+        loading.insert(unit);
+    }
+
+    pool.start(new PoolJob([this, unit]()
+    {
+        store(load(unit));
+    }));
+}
+
+void Prefetcher::store(PrefetchedPointer entry)
+{
+    QMutexLocker locker(&mutex);
+
+    loading.remove(entry->unit);
+
+    recency.push_front(entry->unit);
+    cache.insert(entry->unit, Slot { entry, recency.begin() });
+    used += entry->cost();
+
+    // 超出预算就从最久没用的开始扔， 刚放进来的不扔
+    while (used > budget && recency.size() > 1)
+    {
+        auto victim = cache.find(recency.back());
+
+        used -= victim->entry->cost();
+
+        cache.erase(victim);
+        recency.pop_back();
+    }
+}
+
+PrefetchedPointer Prefetcher::load(const QString& unit)
+{
+    auto entry = std::make_shared<Prefetched>();
+
+    entry->unit = unit;
+    entry->info = Mp3Info { false, 0, 0, 0, 0, 0 };
+
+    QFile audio(unit);
+
+    if (audio.open(QIODevice::ReadOnly))
+    {
+        entry->head = audio.read(PROBE_BYTES);
+        entry->info = probe(entry->head, audio.size());
+
+        if (entry->info.valid)
+        {
+            qint64 wanted = entry->info.dataOffset
+                    + qint64(entry->info.bitrate) * 1000 / 8 * HEAD_SECONDS;
+
+            wanted = qMin(wanted, MAX_HEAD_BYTES);
+
+            if (wanted > entry->head.size())
+            {
+                entry->head.append(audio.read(wanted - entry->head.size()));
+            }
+
+            // 只扫帧头， 定位时不用再建
+            if (uchar* data = audio.map(0, audio.size()))
+            {
+                entry->index = std::make_shared<const Mp3Index>(
+                            Mp3Index::build(data, audio.size()));
+
+                audio.unmap(data);
+            }
+        }
+    }
+
+    QFile text(answerPath(unit));
+
+    if (text.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        QTextStream is(&text);
+
+        entry->answer = prepare(is.readAll());
+    }
+
+    return entry;
+}
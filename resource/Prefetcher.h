@@ -0,0 +1,84 @@
+#ifndef PREFETCHER_H
+#define PREFETCHER_H
+
+#include <list>
+#include <memory>
+
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QStringList>
+#include <QThreadPool>
+
+#include "Assessor/Assessor.h"
+#include "player/Mp3Header.h"
+#include "player/Mp3Index.h"
+
+// 一个单元预先读好的东西
+struct Prefetched
+{
+    // 音频路径
+    QString unit;
+    // 音频开头的几秒， 顺便把文件头读进系统缓存
+    QByteArray head;
+    Mp3Info info;
+    // 帧索引， 顺便把整个文件读进系统缓存
+    std::shared_ptr<const Mp3Index> index;
+    // 分好词的原文， 没有原文时为空
+    std::shared_ptr<const Answer> answer;
+
+    qint64 cost() const;
+};
+
+using PrefetchedPointer = std::shared_ptr<const Prefetched>;
+
+// 按资源树的顺序， 在后台预取用户接下来最可能选的几个单元。
+// 结果放在有内存上限的 LRU 缓存里， 可以在任意线程查询
+class Prefetcher
+{
+public:
+    explicit Prefetcher(qint64 budget = 32 * 1024 * 1024, int ahead = 2);
+
+    ~Prefetcher();
+
+    // 资源树中单元 (音频路径) 的顺序
+    void setOrder(const QStringList& units);
+
+    // 用户选中了 unit: 确保它和后面 ahead 个单元都在缓存中
+    void touch(const QString& unit);
+
+    // 命中时把它移到最近使用
+    PrefetchedPointer find(const QString& unit);
+
+    // 单元的原文路径
+    static QString answerPath(const QString& unit);
+
+private:
+    void schedule(const QString& unit);
+
+    void store(PrefetchedPointer entry);
+
+    static PrefetchedPointer load(const QString& unit);
+
+private:
+    struct Slot
+    {
+        PrefetchedPointer entry;
+        std::list<QString>::iterator position;
+    };
+
+    QThreadPool pool;
+    qint64 budget;
+    int ahead;
+
+    QMutex mutex;
+    QStringList order;
+    QHash<QString, int> orderIndex;
+    QHash<QString, Slot> cache;
+    // 最近使用的在前面
+    std::list<QString> recency;
+    QSet<QString> loading;
+    qint64 used;
+};
+
+#endif // PREFETCHER_H
@@ -0,0 +1,346 @@
+#include <cstring>
+#include <vector>
+
+#include <QDir>
+
+#include "ResourcePack.h"
+
+namespace
+{
+
+const char MAGIC[4] = { 'L', 'R', 'P', '1' };
+const quint32 VERSION = 1;
+
+// 每个音频和原文都从页边界开始， 映射后可以直接交给解码器
+const quint64 BLOB_ALIGNMENT = 4096;
+
+quint64 align(quint64 offset)
+{
+    return (offset + BLOB_ALIGNMENT - 1) / BLOB_ALIGNMENT * BLOB_ALIGNMENT;
+}
+
+// [offset, offset + size) 在 [0, limit) 之内， 损坏的文件里相加可能溢出
+bool within(quint64 offset, quint64 size, quint64 limit)
+{
+    return size <= limit && offset <= limit - size;
+}
+
+} //! end anonymous namespace
+
+ResourcePack::ResourcePack()
+    : base(nullptr)
+    , header(nullptr)
+    , sections(nullptr)
+    , units(nullptr)
+{
+}
+
+ResourcePack::~ResourcePack()
+{
+    close();
+}
+
+quint64 ResourcePack::hash(const char* data, qint64 size)
+{
+    // FNV-1a
+    quint64 h = 14695981039346656037ULL;
+
+    for (qint64 i = 0; i < size; ++i)
+    {
+        h ^= static_cast<uchar>(data[i]);
+        h *= 1099511628211ULL;
+    }
+
+    return h;
+}
+
+bool ResourcePack::open(const QString& path)
+{
+    close();
+
+    file.setFileName(path);
+
+    if (!file.open(QIODevice::ReadOnly)
+            || file.size() < qint64(sizeof(Header)))
+    {
+        file.close();
+        return false;
+    }
+
+    const uchar* data = file.map(0, file.size());
+
+    if (!data)
+    {
+        file.close();
+        return false;
+    }
+
+    auto candidate = reinterpret_cast<const Header*>(data);
+
+    quint64 tables = sizeof(Header)
+            + quint64(candidate->sectionCount) * sizeof(SectionEntry)
+            + quint64(candidate->unitCount) * sizeof(UnitEntry);
+
+    if (std::memcmp(candidate->magic, MAGIC, sizeof(MAGIC)) != 0
+            || candidate->version != VERSION
+            || tables > quint64(file.size())
+            || !within(candidate->stringOffset, candidate->stringSize,
+                       quint64(file.size())))
+    {
+        file.close();
+        return false;
+    }
+
+    auto sectionTable = reinterpret_cast<const SectionEntry*>(
+                data + sizeof(Header));
+    auto unitTable = reinterpret_cast<const UnitEntry*>(
+                data + sizeof(Header)
+                + candidate->sectionCount * sizeof(SectionEntry));
+
+    // 只检查边界， 内容的哈希在 verify 时才算
+    for (quint32 i = 0; i < candidate->sectionCount; ++i)
+    {
+        const SectionEntry& section = sectionTable[i];
+
+        if (!within(section.nameOffset, section.nameLength,
+                    candidate->stringSize)
+                || !within(section.firstUnit, section.unitCount,
+                           candidate->unitCount))
+        {
+            file.close();
+            return false;
+        }
+    }
+
+    for (quint32 i = 0; i < candidate->unitCount; ++i)
+    {
+        const UnitEntry& unit = unitTable[i];
+
+        if (!within(unit.nameOffset, unit.nameLength, candidate->stringSize)
+                || !within(unit.audioOffset, unit.audioSize,
+                           quint64(file.size()))
+                || !within(unit.answerOffset, unit.answerSize,
+                           quint64(file.size())))
+        {
+            file.close();
+            return false;
+        }
+    }
+
+    base = data;
+    header = candidate;
+    sections = sectionTable;
+    units = unitTable;
+
+    return true;
+}
+
+void ResourcePack::close()
+{
+    file.close();
+
+    base = nullptr;
+    header = nullptr;
+    sections = nullptr;
+    units = nullptr;
+}
+
+int ResourcePack::sectionCount() const
+{
+    return header ? static_cast<int>(header->sectionCount) : 0;
+}
+
+int ResourcePack::unitCount() const
+{
+    return header ? static_cast<int>(header->unitCount) : 0;
+}
+
+QString ResourcePack::string(quint32 offset, quint32 length) const
+{
+    return QString::fromUtf8(reinterpret_cast<const char*>(base)
+                             + header->stringOffset + offset, length);
+}
+
+QString ResourcePack::sectionName(int section) const
+{
+    return string(sections[section].nameOffset, sections[section].nameLength);
+}
+
+int ResourcePack::firstUnit(int section) const
+{
+    return sections[section].firstUnit;
+}
+
+int ResourcePack::unitCountOf(int section) const
+{
+    return sections[section].unitCount;
+}
+
+QString ResourcePack::unitName(int unit) const
+{
+    return string(units[unit].nameOffset, units[unit].nameLength);
+}
+
+QByteArray ResourcePack::audio(int unit) const
+{
+    return QByteArray::fromRawData(
+                reinterpret_cast<const char*>(base) + units[unit].audioOffset,
+                units[unit].audioSize);
+}
+
+bool ResourcePack::hasAnswer(int unit) const
+{
+    return units[unit].answerSize > 0;
+}
+
+QString ResourcePack::answer(int unit) const
+{
+    return QString::fromUtf8(
+                reinterpret_cast<const char*>(base) + units[unit].answerOffset,
+                units[unit].answerSize);
+}
+
+quint64 ResourcePack::audioHash(int unit) const
+{
+    return units[unit].audioHash;
+}
+
+quint64 ResourcePack::answerHash(int unit) const
+{
+    return units[unit].answerHash;
+}
+
+bool ResourcePack::verify(int unit) const
+{
+    const UnitEntry& entry = units[unit];
+    auto data = reinterpret_cast<const char*>(base);
+
+    return hash(data + entry.audioOffset, entry.audioSize) == entry.audioHash
+            && hash(data + entry.answerOffset, entry.answerSize)
+                == entry.answerHash;
+}
+
+bool ResourcePack::build(const QString& dataDirectory, const QString& path)
+{
+    QDir root(dataDirectory);
+
+    if (!root.exists())
+    {
+        return false;
+    }
+
+    std::vector<SectionEntry> sectionTable;
+    std::vector<UnitEntry> unitTable;
+    // 每个单元的音频和原文路径
+    std::vector<std::pair<QString, QString>> sources;
+    QByteArray strings;
+
+    auto addString = [&](const QString& text, quint32* offset, quint32* length)
+    {
+        QByteArray utf8 = text.toUtf8();
+
+        *offset = strings.size();
+        *length = utf8.size();
+
+        strings.append(utf8);
+    };
+
+    // 与 MainWindow::checkResource 的遍历顺序相同
+    for (const auto& sectionDir
+         : root.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot))
+    {
+        SectionEntry section {};
+
+        addString(sectionDir.fileName(),
+                  &section.nameOffset, &section.nameLength);
+        section.firstUnit = unitTable.size();
+
+        for (const auto& file : QDir(sectionDir.absoluteFilePath())
+             .entryInfoList(QStringList("*.mp3"), QDir::Files))
+        {
+            UnitEntry unit {};
+
+            addString(file.fileName(), &unit.nameOffset, &unit.nameLength);
+
+            unitTable.push_back(unit);
+            sources.emplace_back(file.absoluteFilePath(),
+                                 file.absoluteFilePath().remove(".mp3"));
+        }
+
+        section.unitCount = unitTable.size() - section.firstUnit;
+        sectionTable.push_back(section);
+    }
+
+    Header header;
+
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.sectionCount = sectionTable.size();
+    header.unitCount = unitTable.size();
+    header.stringOffset = sizeof(Header)
+            + sectionTable.size() * sizeof(SectionEntry)
+            + unitTable.size() * sizeof(UnitEntry);
+    header.stringSize = strings.size();
+
+    QFile out(path);
+
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        return false;
+    }
+
+    // 先写内容， 边写边填单元表， 最后回头写表
+    quint64 offset = header.stringOffset + header.stringSize;
+
+    auto writeBlob = [&](const QString& source, quint64* blobOffset,
+                         quint64* blobSize, quint64* blobHash)
+    {
+        QFile in(source);
+
+        if (!in.open(QIODevice::ReadOnly))
+        {
+            *blobOffset = 0;
+            *blobSize = 0;
+            *blobHash = hash(nullptr, 0);
+            return true;
+        }
+
+        QByteArray content = in.readAll();
+
+        offset = align(offset);
+
+        *blobOffset = offset;
+        *blobSize = content.size();
+        *blobHash = hash(content.constData(), content.size());
+
+        offset += content.size();
+
+        return out.seek(*blobOffset)
+                && out.write(content) == content.size();
+    };
+
+    for (size_t i = 0; i < unitTable.size(); ++i)
+    {
+        UnitEntry& unit = unitTable[i];
+
+        if (!writeBlob(sources[i].first, &unit.audioOffset,
+                       &unit.audioSize, &unit.audioHash)
+                || !writeBlob(sources[i].second, &unit.answerOffset,
+                              &unit.answerSize, &unit.answerHash))
+        {
+            return false;
+        }
+    }
+
+    auto write = [&](const void* data, qint64 size)
+    {
+        return out.write(static_cast<const char*>(data), size) == size;
+    };
+
+    return out.seek(0)
+            && write(&header, sizeof(header))
+            && write(sectionTable.data(),
+                     sectionTable.size() * sizeof(SectionEntry))
+            && write(unitTable.data(), unitTable.size() * sizeof(UnitEntry))
+            && write(strings.constData(), strings.size());
+}
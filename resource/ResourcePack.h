@@ -0,0 +1,107 @@
+#ifndef RESOURCEPACK_H
+#define RESOURCEPACK_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+// 把 english_data 下所有的音频和原文打成一个文件， 启动时只需打开并映射一次。
+//
+// 文件布局 (本机字节序):
+//   Header
+//   SectionEntry sections[sectionCount]
+//   UnitEntry    units[unitCount]        按 section 分组， 与目录遍历的顺序一致
+//   char         strings[stringSize]     UTF-8 名字， 不以 '\0' 结尾
+//   ...          按 BLOB_ALIGNMENT 对齐的音频和原文
+class ResourcePack
+{
+public:
+    struct Header
+    {
+        char magic[4];
+        quint32 version;
+        quint32 sectionCount;
+        quint32 unitCount;
+        quint64 stringOffset;
+        quint64 stringSize;
+    };
+
+    struct SectionEntry
+    {
+        quint32 nameOffset;
+        quint32 nameLength;
+        quint32 firstUnit;
+        quint32 unitCount;
+    };
+
+    struct UnitEntry
+    {
+        quint32 nameOffset;
+        quint32 nameLength;
+        quint64 audioOffset;
+        quint64 audioSize;
+        // 没有原文时 answerSize 为 0
+        quint64 answerOffset;
+        quint64 answerSize;
+        quint64 audioHash;
+        quint64 answerHash;
+    };
+
+    ResourcePack();
+
+    ~ResourcePack();
+
+    bool open(const QString& path);
+
+    void close();
+
+    bool isOpen() const
+    {
+        return header != nullptr;
+    }
+
+    int sectionCount() const;
+
+    int unitCount() const;
+
+    QString sectionName(int section) const;
+
+    // section 中单元的序号范围 [first, first + count)
+    int firstUnit(int section) const;
+
+    int unitCountOf(int section) const;
+
+    QString unitName(int unit) const;
+
+    // 直接指向映射区域， 不复制。 pack 关闭后失效
+    QByteArray audio(int unit) const;
+
+    bool hasAnswer(int unit) const;
+
+    QString answer(int unit) const;
+
+    // 打包时记下的哈希， 内容变了它就会变
+    quint64 audioHash(int unit) const;
+
+    quint64 answerHash(int unit) const;
+
+    // 重新计算哈希， 检查内容是否损坏
+    bool verify(int unit) const;
+
+    // 扫描 dataDirectory/<section>/<unit>.mp3 及同名无后缀的原文， 写成 path
+    static bool build(const QString& dataDirectory, const QString& path);
+
+    static quint64 hash(const char* data, qint64 size);
+
+private:
+    QString string(quint32 offset, quint32 length) const;
+
+private:
+    QFile file;
+    const uchar* base;
+    const Header* header;
+    const SectionEntry* sections;
+    const UnitEntry* units;
+};
+
+#endif // RESOURCEPACK_H
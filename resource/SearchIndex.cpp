@@ -0,0 +1,567 @@
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#include <QHash>
+#include <QSaveFile>
+#include <QThreadPool>
+
+#include "Assessor/Tokenizer.h"
+#include "SearchIndex.h"
+#include "common/PoolJob.h"
+#include "common/Varint.h"
+
+struct SearchIndex::Header
+{
+    char magic[4];
+    quint32 version;
+    quint32 unitCount;
+    quint32 termCount;
+    quint32 stringSize;
+    quint32 reserved;
+    quint64 postingSize;
+};
+
+struct SearchIndex::UnitEntry
+{
+    quint32 nameOffset;
+    quint32 nameLength;
+};
+
+struct SearchIndex::TermEntry
+{
+    quint32 nameOffset;
+    quint32 nameLength;
+    // 包含这个词的单元数
+    quint32 unitCount;
+    quint32 reserved;
+    quint64 postingOffset;
+    quint64 postingSize;
+};
+
+namespace
+{
+
+const char MAGIC[4] = { 'L', 'S', 'X', '1' };
+const quint32 VERSION = 1;
+
+int compare(const char* data, quint32 length, const QByteArray& key)
+{
+    int result = std::memcmp(data, key.constData(),
+                             std::min<quint32>(length, key.size()));
+
+    if (result != 0)
+    {
+        return result;
+    }
+
+    return int(length) - key.size();
+}
+
+// [offset, offset + size) 在 [0, limit) 之内， 损坏的文件里相加可能溢出
+bool within(quint64 offset, quint64 size, quint64 limit)
+{
+    return size <= limit && offset <= limit - size;
+}
+
+} //! end anonymous namespace
+
+SearchIndex::SearchIndex()
+    : header(nullptr)
+    , units(nullptr)
+    , terms(nullptr)
+    , strings(nullptr)
+    , postings(nullptr)
+{
+}
+
+SearchIndex::~SearchIndex()
+{
+    close();
+}
+
+bool SearchIndex::open(const QString& path)
+{
+    close();
+
+    file.setFileName(path);
+
+    if (!file.open(QIODevice::ReadOnly)
+            || file.size() < qint64(sizeof(Header)))
+    {
+        file.close();
+        return false;
+    }
+
+    const uchar* data = file.map(0, file.size());
+
+    if (!data)
+    {
+        file.close();
+        return false;
+    }
+
+    auto candidate = reinterpret_cast<const Header*>(data);
+
+    quint64 expected = sizeof(Header)
+            + quint64(candidate->unitCount) * sizeof(UnitEntry)
+            + quint64(candidate->termCount) * sizeof(TermEntry)
+            + candidate->stringSize + candidate->postingSize;
+
+    if (std::memcmp(candidate->magic, MAGIC, sizeof(MAGIC)) != 0
+            || candidate->version != VERSION
+            || candidate->postingSize > quint64(file.size())
+            || expected != quint64(file.size()))
+    {
+        file.close();
+        return false;
+    }
+
+    const uchar* cursor = data + sizeof(Header);
+
+    auto unitTable = reinterpret_cast<const UnitEntry*>(cursor);
+    cursor += candidate->unitCount * sizeof(UnitEntry);
+
+    auto termTable = reinterpret_cast<const TermEntry*>(cursor);
+    cursor += candidate->termCount * sizeof(TermEntry);
+
+    // 表里的偏移都要落在各自的区域里， 查询时就不用再检查
+    for (quint32 i = 0; i < candidate->unitCount; ++i)
+    {
+        if (!within(unitTable[i].nameOffset, unitTable[i].nameLength,
+                    candidate->stringSize))
+        {
+            file.close();
+            return false;
+        }
+    }
+
+    for (quint32 i = 0; i < candidate->termCount; ++i)
+    {
+        const TermEntry& term = termTable[i];
+
+        if (!within(term.nameOffset, term.nameLength, candidate->stringSize)
+                || !within(term.postingOffset, term.postingSize,
+                           candidate->postingSize)
+                || term.unitCount > candidate->unitCount)
+        {
+            file.close();
+            return false;
+        }
+    }
+
+    header = candidate;
+    units = unitTable;
+    terms = termTable;
+
+    strings = reinterpret_cast<const char*>(cursor);
+    cursor += header->stringSize;
+
+    postings = cursor;
+
+    return true;
+}
+
+void SearchIndex::close()
+{
+    // QFile::close 会解除映射
+    file.close();
+
+    header = nullptr;
+    units = nullptr;
+    terms = nullptr;
+    strings = nullptr;
+    postings = nullptr;
+}
+
+int SearchIndex::unitCount() const
+{
+    return header ? static_cast<int>(header->unitCount) : 0;
+}
+
+QString SearchIndex::unitName(int unit) const
+{
+    return QString::fromUtf8(strings + units[unit].nameOffset,
+                             units[unit].nameLength);
+}
+
+QStringList SearchIndex::words(const QString& text)
+{
+    QStringList result;
+    Lexicon lexicon;
+
+    for (const Token& token : tokenize(text, &lexicon))
+    {
+        if (!token.skippable)
+        {
+            result.push_back(text.mid(token.offset, token.length).toLower());
+        }
+    }
+
+    return result;
+}
+
+const SearchIndex::TermEntry* SearchIndex::findTerm(const QString& word) const
+{
+    if (!header)
+    {
+        return nullptr;
+    }
+
+    QByteArray key = word.toLower().toUtf8();
+
+    const TermEntry* end = terms + header->termCount;
+
+    const TermEntry* it = std::lower_bound(
+                terms, end, key,
+                [this](const TermEntry& term, const QByteArray& key)
+    {
+        return compare(strings + term.nameOffset, term.nameLength, key) < 0;
+    });
+
+    if (it == end
+            || compare(strings + it->nameOffset, it->nameLength, key) != 0)
+    {
+        return nullptr;
+    }
+
+    return it;
+}
+
+std::vector<SearchIndex::Posting> SearchIndex::decode(
+        const TermEntry* term, bool positions) const
+{
+    std::vector<Posting> result;
+
+    result.reserve(term->unitCount);
+
+    const uchar* cursor = postings + term->postingOffset;
+    const uchar* end = cursor + term->postingSize;
+
+    int unit = -1;
+
+    while (cursor < end)
+    {
+        quint32 gap = 0;
+        quint32 count = 0;
+
+        // 映射的文件被截断或损坏时只返回读到的部分
+        if (!readNumber(&cursor, end, &gap) || !readNumber(&cursor, end, &count)
+                || count > quint32(end - cursor))
+        {
+            break;
+        }
+
+        // 单元号只增不减， 越界之后的都不要
+        if (qint64(unit) + gap >= header->unitCount)
+        {
+            break;
+        }
+
+        unit += gap;
+
+        result.push_back(Posting { unit, std::vector<quint32>() });
+
+        std::vector<quint32>& list = result.back().positions;
+
+        if (positions)
+        {
+            list.reserve(count);
+        }
+
+        quint32 position = 0;
+
+        for (quint32 i = 0; i < count; ++i)
+        {
+            quint32 delta = 0;
+
+            if (!readNumber(&cursor, end, &delta))
+            {
+                return result;
+            }
+
+            position += delta;
+
+            if (positions)
+            {
+                list.push_back(position);
+            }
+        }
+    }
+
+    return result;
+}
+
+std::vector<int> SearchIndex::findWord(const QString& word) const
+{
+    std::vector<int> result;
+
+    if (const TermEntry* term = findTerm(word))
+    {
+        for (const Posting& posting : decode(term, false))
+        {
+            result.push_back(posting.unit);
+        }
+    }
+
+    return result;
+}
+
+std::vector<int> SearchIndex::findPhrase(const QStringList& words) const
+{
+    if (words.isEmpty())
+    {
+        return std::vector<int>();
+    }
+
+    if (words.size() == 1)
+    {
+        return findWord(words.front());
+    }
+
+    std::vector<const TermEntry*> entries;
+
+    for (const QString& word : words)
+    {
+        const TermEntry* term = findTerm(word);
+
+        if (!term)
+        {
+            return std::vector<int>();
+        }
+
+        entries.push_back(term);
+    }
+
+    // 第一个词的每个位置都是候选的短语起点， 之后每个词过滤一遍
+    std::vector<Posting> candidates = decode(entries.front(), true);
+
+    for (size_t k = 1; k < entries.size() && !candidates.empty(); ++k)
+    {
+        std::vector<Posting> next = decode(entries[k], true);
+        std::vector<Posting> kept;
+
+        auto it = next.cbegin();
+
+        for (Posting& candidate : candidates)
+        {
+            while (it != next.cend() && it->unit < candidate.unit)
+            {
+                ++it;
+            }
+
+            if (it == next.cend())
+            {
+                break;
+            }
+
+            if (it->unit != candidate.unit)
+            {
+                continue;
+            }
+
+            std::vector<quint32> starts;
+
+            for (quint32 start : candidate.positions)
+            {
+                if (std::binary_search(it->positions.begin(),
+                                       it->positions.end(), start + k))
+                {
+                    starts.push_back(start);
+                }
+            }
+
+            if (!starts.empty())
+            {
+                kept.push_back(Posting { candidate.unit, std::move(starts) });
+            }
+        }
+
+        candidates.swap(kept);
+    }
+
+    std::vector<int> result;
+
+    for (const Posting& posting : candidates)
+    {
+        result.push_back(posting.unit);
+    }
+
+    return result;
+}
+
+std::vector<int> SearchIndex::search(const QString& query) const
+{
+    QString trimmed = query.trimmed();
+
+    if (trimmed.size() >= 2 && trimmed.startsWith('"')
+            && trimmed.endsWith('"'))
+    {
+        return findPhrase(words(trimmed.mid(1, trimmed.size() - 2)));
+    }
+
+    QStringList list = words(trimmed);
+
+    if (list.isEmpty())
+    {
+        return std::vector<int>();
+    }
+
+    std::vector<int> result = findWord(list.front());
+
+    for (int i = 1; i < list.size() && !result.empty(); ++i)
+    {
+        std::vector<int> other = findWord(list[i]);
+        std::vector<int> both;
+
+        std::set_intersection(result.begin(), result.end(),
+                              other.begin(), other.end(),
+                              std::back_inserter(both));
+
+        result.swap(both);
+    }
+
+    return result;
+}
+
+bool SearchIndex::build(const QStringList& units, const Reader& reader,
+                        const QString& path)
+{
+    // 各单元并行切词， 结果放在自己的位置上
+    std::vector<QStringList> texts(units.size());
+
+    {
+        QThreadPool pool;
+
+        for (int i = 0; i < units.size(); ++i)
+        {
+            pool.start(new PoolJob([&, i]()
+            {
+                texts[i] = words(reader(units[i]));
+            }));
+        }
+
+        pool.waitForDone();
+    }
+
+    struct Builder
+    {
+        int lastUnit;
+        quint32 unitCount;
+        QByteArray bytes;
+    };
+
+    QHash<QString, Builder> builders;
+
+    // 按单元号的顺序追加， 每个词的倒排表自然有序
+    for (int unit = 0; unit < units.size(); ++unit)
+    {
+        QHash<QString, std::vector<quint32>> positions;
+
+        for (int i = 0; i < texts[unit].size(); ++i)
+        {
+            positions[texts[unit][i]].push_back(i);
+        }
+
+        for (auto it = positions.cbegin(); it != positions.cend(); ++it)
+        {
+            auto builder = builders.find(it.key());
+
+            if (builder == builders.end())
+            {
+                builder = builders.insert(it.key(),
+                                          Builder { -1, 0, QByteArray() });
+            }
+
+            writeNumber(&builder->bytes, unit - builder->lastUnit);
+            writeNumber(&builder->bytes, it.value().size());
+
+            quint32 previous = 0;
+
+            for (quint32 position : it.value())
+            {
+                writeNumber(&builder->bytes, position - previous);
+                previous = position;
+            }
+
+            builder->lastUnit = unit;
+            ++builder->unitCount;
+        }
+
+        texts[unit].clear();
+    }
+
+    std::vector<std::pair<QByteArray, const Builder*>> sorted;
+
+    for (auto it = builders.cbegin(); it != builders.cend(); ++it)
+    {
+        sorted.emplace_back(it.key().toUtf8(), &it.value());
+    }
+
+    std::sort(sorted.begin(), sorted.end(),
+              [](const std::pair<QByteArray, const Builder*>& lhs,
+                 const std::pair<QByteArray, const Builder*>& rhs)
+    {
+        return lhs.first < rhs.first;
+    });
+
+    QByteArray stringPool;
+    QByteArray postingPool;
+
+    std::vector<UnitEntry> unitTable;
+    std::vector<TermEntry> termTable;
+
+    for (const QString& unit : units)
+    {
+        QByteArray utf8 = unit.toUtf8();
+
+        unitTable.push_back(UnitEntry { quint32(stringPool.size()),
+                                        quint32(utf8.size()) });
+        stringPool.append(utf8);
+    }
+
+    for (const auto& term : sorted)
+    {
+        TermEntry entry {};
+
+        entry.nameOffset = stringPool.size();
+        entry.nameLength = term.first.size();
+        entry.unitCount = term.second->unitCount;
+        entry.postingOffset = postingPool.size();
+        entry.postingSize = term.second->bytes.size();
+
+        stringPool.append(term.first);
+        postingPool.append(term.second->bytes);
+
+        termTable.push_back(entry);
+    }
+
+    Header header {};
+
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.unitCount = unitTable.size();
+    header.termCount = termTable.size();
+    header.stringSize = stringPool.size();
+    header.postingSize = postingPool.size();
+
+    // 运行中的程序可能映射着旧文件， 不能原地截断， 写好后再换上
+    QSaveFile out(path);
+
+    if (!out.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    auto write = [&](const void* data, qint64 size)
+    {
+        return out.write(static_cast<const char*>(data), size) == size;
+    };
+
+    return write(&header, sizeof(header))
+            && write(unitTable.data(), unitTable.size() * sizeof(UnitEntry))
+            && write(termTable.data(), termTable.size() * sizeof(TermEntry))
+            && write(stringPool.constData(), stringPool.size())
+            && write(postingPool.constData(), postingPool.size())
+            && out.commit();
+}
@@ -0,0 +1,85 @@
+#ifndef SEARCHINDEX_H
+#define SEARCHINDEX_H
+
+#include <functional>
+#include <vector>
+
+#include <QFile>
+#include <QString>
+#include <QStringList>
+
+// 全部原文的带位置倒排索引， 文件通过 mmap 直接使用。
+//
+// 文件布局 (本机字节序):
+//   Header
+//   UnitEntry units[unitCount]
+//   TermEntry terms[termCount]       按词的 UTF-8 字节序排序
+//   char      strings[stringSize]    单元名和词， 不以 '\0' 结尾
+//   uchar     postings[postingSize]  每个词的倒排表， 变长整数:
+//                                    (单元号差, 次数, 位置差...)...
+// 位置是单元中第几个单词， 不算分隔符
+class SearchIndex
+{
+public:
+    // 读单元的原文， 会在多个线程里同时调用
+    using Reader = std::function<QString(const QString& unit)>;
+
+    SearchIndex();
+
+    ~SearchIndex();
+
+    bool open(const QString& path);
+
+    void close();
+
+    bool isOpen() const
+    {
+        return header != nullptr;
+    }
+
+    int unitCount() const;
+
+    QString unitName(int unit) const;
+
+    // 带引号时按短语查， 否则返回包含所有词的单元。 结果按单元号排序
+    std::vector<int> search(const QString& query) const;
+
+    // 包含 word 的单元
+    std::vector<int> findWord(const QString& word) const;
+
+    // 依次包含 words 的单元
+    std::vector<int> findPhrase(const QStringList& words) const;
+
+    // units 是单元名， 查询结果用 unitName 换回
+    static bool build(const QStringList& units, const Reader& reader,
+                      const QString& path);
+
+    // 与建索引时相同的切词方式， 只留下单词， 转成小写
+    static QStringList words(const QString& text);
+
+private:
+    struct Header;
+    struct UnitEntry;
+    struct TermEntry;
+
+    // 某个单元中一个词出现的位置
+    struct Posting
+    {
+        int unit;
+        std::vector<quint32> positions;
+    };
+
+    const TermEntry* findTerm(const QString& word) const;
+
+    std::vector<Posting> decode(const TermEntry* term, bool positions) const;
+
+private:
+    QFile file;
+    const Header* header;
+    const UnitEntry* units;
+    const TermEntry* terms;
+    const char* strings;
+    const uchar* postings;
+};
+
+#endif // SEARCHINDEX_H
@@ -0,0 +1,351 @@
+#include <algorithm>
+#include <cstring>
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileInfo>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "DraftJournal.h"
+#include "common/PoolJob.h"
+#include "common/Varint.h"
+
+namespace
+{
+
+const char MAGIC[4] = { 'L', 'D', 'J', '1' };
+
+enum RecordType : char
+{
+    SNAPSHOT = 1,
+    EDIT
+};
+
+// 两次落盘之间最多隔这么久
+const int FLUSH_INTERVAL = 1000;
+
+// 日志超过这个大小， 而且是草稿的好几倍时才压缩
+const qint64 COMPACT_SIZE = 64 * 1024;
+const int COMPACT_RATIO = 4;
+
+QByteArray snapshotRecord(const QString& text)
+{
+    QByteArray record(1, SNAPSHOT);
+
+    writeText(&record, text);
+
+    return record;
+}
+
+// 写到磁盘上才返回， 断电也不丢
+bool sync(QFile* file)
+{
+    if (!file->flush())
+    {
+        return false;
+    }
+
+#ifdef Q_OS_WIN
+    return _commit(file->handle()) == 0;
+#else
+    return fsync(file->handle()) == 0;
+#endif
+}
+
+// 按日志重建草稿， 返回最后一条完整记录的结尾， 头部不对时返回 0。
+// 崩溃时最后一条可能只写了一半， 丢掉即可
+qint64 replay(const QByteArray& data, QString* text)
+{
+    text->clear();
+
+    if (data.size() < static_cast<int>(sizeof(MAGIC))
+            || std::memcmp(data.constData(), MAGIC, sizeof(MAGIC)) != 0)
+    {
+        return 0;
+    }
+
+    auto begin = reinterpret_cast<const uchar*>(data.constData());
+    auto cursor = begin + sizeof(MAGIC);
+    auto end = begin + data.size();
+    auto complete = cursor;
+
+    while (cursor < end)
+    {
+        char type = static_cast<char>(*cursor++);
+
+        if (type == SNAPSHOT)
+        {
+            if (!readText(&cursor, end, text))
+            {
+                break;
+            }
+        }
+        else if (type == EDIT)
+        {
+            quint32 position = 0;
+            quint32 removed = 0;
+            QString inserted;
+
+            if (!readNumber(&cursor, end, &position)
+                    || !readNumber(&cursor, end, &removed)
+                    || !readText(&cursor, end, &inserted))
+            {
+                break;
+            }
+
+            int at = qMin<int>(position, text->size());
+
+            text->replace(at, qMin<int>(removed, text->size() - at), inserted);
+        }
+        else
+        {
+            break;
+        }
+
+        complete = cursor;
+    }
+
+    return complete - begin;
+}
+
+} //! end anonymous namespace
+
+DraftJournal::DraftJournal(const QString& directory, QObject* parent)
+    : QObject(parent)
+    , directory(directory)
+    , written(0)
+{
+    flushTimer.setSingleShot(true);
+    flushTimer.setInterval(FLUSH_INTERVAL);
+
+    connect(&flushTimer, &QTimer::timeout, this, &DraftJournal::flush);
+
+    // 任务要按提交的顺序做
+    pool.setMaxThreadCount(1);
+}
+
+DraftJournal::~DraftJournal()
+{
+    close();
+
+    pool.waitForDone();
+}
+
+QString DraftJournal::journalPath(const QString& unit) const
+{
+    QByteArray hash = QCryptographicHash::hash(unit.toUtf8(),
+                                               QCryptographicHash::Sha1);
+
+    return directory + '/' + QString::fromLatin1(hash.toHex()) + ".journal";
+}
+
+QString DraftJournal::open(const QString& unit)
+{
+    close();
+
+    QDir().mkpath(directory);
+
+    path = journalPath(unit);
+
+    closing.erase(std::remove_if(closing.begin(), closing.end(),
+                                 [](const auto& entry)
+    {
+        return entry.second.expired();
+    }), closing.end());
+
+    // 换回刚关掉的单元时， 等后台把它最后的改动写完
+    for (const auto& entry : closing)
+    {
+        if (entry.first == path)
+        {
+            pool.waitForDone();
+            closing.clear();
+            break;
+        }
+    }
+
+    QString temporary = path + ".tmp";
+
+    // 替换旧日志时崩溃了: 旧的还在就以旧的为准， 否则新日志已经写完整
+    if (QFileInfo::exists(path))
+    {
+        QFile::remove(temporary);
+    }
+    else if (QFileInfo::exists(temporary))
+    {
+        QFile::rename(temporary, path);
+    }
+
+    auto journal = std::make_shared<QFile>(path);
+
+    qint64 complete = 0;
+
+    if (journal->open(QIODevice::ReadOnly))
+    {
+        complete = replay(journal->readAll(), &text);
+        journal->close();
+    }
+
+    if (!journal->open(QIODevice::WriteOnly | QIODevice::Append))
+    {
+        return text;
+    }
+
+    // 新建的或头部损坏的日志从一条快照重新开始
+    if (complete == 0 || text.isEmpty())
+    {
+        journal->resize(0);
+        journal->write(MAGIC, sizeof(MAGIC));
+
+        if (!text.isEmpty())
+        {
+            journal->write(snapshotRecord(text));
+        }
+
+        sync(journal.get());
+    }
+    else if (complete < journal->size())
+    {
+        // 截掉写了一半的记录， 否则新记录接在它后面， 下次重放会在那里停下
+        journal->resize(complete);
+        sync(journal.get());
+    }
+
+    written = journal->size();
+    file = journal;
+
+    return text;
+}
+
+void DraftJournal::close()
+{
+    if (!file)
+    {
+        return;
+    }
+
+    flush();
+
+    auto journal = file;
+
+    pool.start(new PoolJob([journal]()
+    {
+        journal->close();
+    }));
+
+    closing.emplace_back(path, journal);
+
+    file.reset();
+    text.clear();
+}
+
+void DraftJournal::append(int position, int removed, const QString& inserted)
+{
+    if (!file)
+    {
+        return;
+    }
+
+    int at = qBound(0, position, text.size());
+
+    removed = qBound(0, removed, text.size() - at);
+
+    text.replace(at, removed, inserted);
+
+    QByteArray record(1, EDIT);
+
+    writeNumber(&record, static_cast<quint32>(at));
+    writeNumber(&record, static_cast<quint32>(removed));
+    writeText(&record, inserted);
+
+    write(record);
+}
+
+void DraftJournal::reset(const QString& text)
+{
+    if (!file)
+    {
+        return;
+    }
+
+    this->text = text;
+
+    write(snapshotRecord(text));
+}
+
+void DraftJournal::write(const QByteArray& record)
+{
+    pending.append(record);
+
+    if (!flushTimer.isActive())
+    {
+        flushTimer.start();
+    }
+}
+
+void DraftJournal::flush()
+{
+    flushTimer.stop();
+
+    if (!file || pending.isEmpty())
+    {
+        return;
+    }
+
+    auto journal = file;
+    QByteArray records = pending;
+
+    pending.clear();
+    written += records.size();
+
+    pool.start(new PoolJob([journal, records]()
+    {
+        journal->write(records);
+        sync(journal.get());
+    }));
+
+    if (written > COMPACT_SIZE
+            && written > COMPACT_RATIO * 2 * qint64(text.size()))
+    {
+        startCompaction();
+    }
+}
+
+void DraftJournal::startCompaction()
+{
+    auto journal = file;
+    QString target = path;
+    QByteArray snapshot = QByteArray(MAGIC, sizeof(MAGIC))
+            + snapshotRecord(text);
+
+    written = snapshot.size();
+
+    // 排在之前的写入后面， 快照正好包含了日志里的所有改动， 之后的写入进新日志
+    pool.start(new PoolJob([journal, target, snapshot]()
+    {
+        QString temporary = target + ".tmp";
+        QFile out(temporary);
+
+        if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)
+                || out.write(snapshot) != snapshot.size() || !sync(&out))
+        {
+            out.close();
+            QFile::remove(temporary);
+            return;
+        }
+
+        out.close();
+        journal->close();
+
+        // 先删后改名， 中间崩溃时 open 会认领 .tmp
+        QFile::remove(target);
+        QFile::rename(temporary, target);
+
+        journal->open(QIODevice::WriteOnly | QIODevice::Append);
+    }));
+}
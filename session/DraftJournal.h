@@ -0,0 +1,79 @@
+#ifndef DRAFTJOURNAL_H
+#define DRAFTJOURNAL_H
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <QFile>
+#include <QObject>
+#include <QThreadPool>
+#include <QTimer>
+
+// 每个单元一份听写草稿的日志， 只追加编辑区的改动， 不重写整篇。
+//
+// 文件布局:
+//   char magic[4] = "LDJ1"
+//   之后每条记录: 类型 (1 字节), 参数...
+//     SNAPSHOT: 文字
+//     EDIT:     位置, 删掉的字符数, 插入的文字
+// 数字是每字节 7 位的变长整数， 文字是 UTF-8， 前面带长度。
+//
+// 改动先攒在内存里， 定时交给后台线程写入并 fsync， 界面线程不碰磁盘。
+// 日志比草稿大很多时， 在同一个线程里把当前草稿写成只有一条 SNAPSHOT
+// 的新日志， 再换掉旧的
+class DraftJournal : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DraftJournal(const QString& directory, QObject* parent = nullptr);
+
+    ~DraftJournal();
+
+    // 换到 unit 的草稿， 返回上次保存的内容， 没有时返回空
+    QString open(const QString& unit);
+
+    // 剩下的改动交给后台写完， 不等它
+    void close();
+
+    bool isOpen() const
+    {
+        return file != nullptr;
+    }
+
+    // 编辑区的一次改动
+    void append(int position, int removed, const QString& text);
+
+    // 用 text 替换整个草稿
+    void reset(const QString& text);
+
+    // 不等定时器， 马上交给后台落盘
+    void flush();
+
+private:
+    QString journalPath(const QString& unit) const;
+
+    void write(const QByteArray& record);
+
+    void startCompaction();
+
+private:
+    QString directory;
+    QString path;
+    // 打开之后只在 pool 的线程里读写， 关掉时为空
+    std::shared_ptr<QFile> file;
+    // 已经关掉、 后台可能还在写的日志。 任务做完就不再持有文件
+    std::vector<std::pair<QString, std::weak_ptr<QFile>>> closing;
+    // 按日志重建出来的草稿
+    QString text;
+    // 还没交给后台的记录
+    QByteArray pending;
+    // 日志的大小， 用来判断要不要压缩
+    qint64 written;
+    QTimer flushTimer;
+    // 写入、 fsync 和压缩都按顺序在这一个线程里做
+    QThreadPool pool;
+};
+
+#endif // DRAFTJOURNAL_H
@@ -0,0 +1,176 @@
+#include <cstring>
+
+#include "SessionLog.h"
+#include "common/Varint.h"
+
+namespace
+{
+
+const char MAGIC[4] = { 'L', 'S', 'S', '1' };
+
+// 攒够这么多字节就写一次文件
+const int FLUSH_SIZE = 4096;
+
+} //! end anonymous namespace
+
+SessionWriter::SessionWriter()
+    : last(0)
+{
+}
+
+SessionWriter::~SessionWriter()
+{
+    close();
+}
+
+bool SessionWriter::open(const QString& path)
+{
+    close();
+
+    file.setFileName(path);
+
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        return false;
+    }
+
+    buffer = QByteArray(MAGIC, sizeof(MAGIC));
+    flush();
+
+    clock.start();
+    last = 0;
+
+    return true;
+}
+
+void SessionWriter::close()
+{
+    if (file.isOpen())
+    {
+        flush();
+        file.close();
+    }
+}
+
+void SessionWriter::write(SessionEvent::Type type, quint32 position,
+                          quint32 removed, const QString& text)
+{
+    if (!file.isOpen())
+    {
+        return;
+    }
+
+    quint32 now = static_cast<quint32>(clock.elapsed());
+
+    buffer.append(static_cast<char>(type));
+    writeNumber(&buffer, now - last);
+
+    last = now;
+
+    switch (type)
+    {
+        case SessionEvent::EDIT:
+            writeNumber(&buffer, position);
+            writeNumber(&buffer, removed);
+            writeText(&buffer, text);
+            break;
+
+        case SessionEvent::SELECT:
+            writeText(&buffer, text);
+            break;
+
+        case SessionEvent::SEEK:
+            writeNumber(&buffer, position);
+            break;
+
+        case SessionEvent::SUBMIT:
+            break;
+    }
+
+    // 程序崩溃时至少留下最近一次提交之前的操作
+    if (type != SessionEvent::EDIT || buffer.size() >= FLUSH_SIZE)
+    {
+        flush();
+    }
+}
+
+void SessionWriter::flush()
+{
+    file.write(buffer);
+    file.flush();
+
+    buffer.clear();
+}
+
+bool readSession(const QString& path, std::vector<SessionEvent>* events)
+{
+    QFile file(path);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    QByteArray data = file.readAll();
+
+    if (data.size() < static_cast<int>(sizeof(MAGIC))
+            || std::memcmp(data.constData(), MAGIC, sizeof(MAGIC)) != 0)
+    {
+        return false;
+    }
+
+    auto cursor = reinterpret_cast<const uchar*>(data.constData())
+            + sizeof(MAGIC);
+    auto end = reinterpret_cast<const uchar*>(data.constData())
+            + data.size();
+
+    events->clear();
+
+    quint32 time = 0;
+
+    while (cursor < end)
+    {
+        SessionEvent event {};
+        quint32 delta = 0;
+
+        event.type = static_cast<SessionEvent::Type>(*cursor++);
+
+        bool valid = readNumber(&cursor, end, &delta);
+
+        time += delta;
+        event.time = time;
+
+        switch (event.type)
+        {
+            case SessionEvent::EDIT:
+                valid = valid && readNumber(&cursor, end, &event.position)
+                        && readNumber(&cursor, end, &event.removed)
+                        && readText(&cursor, end, &event.text);
+                break;
+
+            case SessionEvent::SELECT:
+                valid = valid && readText(&cursor, end, &event.text);
+                break;
+
+            case SessionEvent::SEEK:
+                valid = valid && readNumber(&cursor, end, &event.position);
+                break;
+
+            case SessionEvent::SUBMIT:
+                break;
+
+            default:
+                valid = false;
+        }
+
+        // 录制时程序崩溃， 最后一条只写了一半
+        if (!valid)
+        {
+            break;
+        }
+
+        events->push_back(event);
+    }
+
+    return true;
+}
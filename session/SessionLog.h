@@ -0,0 +1,74 @@
+#ifndef SESSIONLOG_H
+#define SESSIONLOG_H
+
+#include <vector>
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QString>
+
+// 界面上的一个操作， 重放时走和用户操作相同的路径
+struct SessionEvent
+{
+    enum Type : quint8
+    {
+        // 编辑区的一次改动
+        EDIT = 1,
+        // 提交评估
+        SUBMIT,
+        // 在资源树里选了一个单元
+        SELECT,
+        // 拖动进度条
+        SEEK
+    };
+
+    Type type;
+    // 距开始录制的毫秒数
+    quint32 time;
+    // EDIT 时为改动的位置， SEEK 时为进度条的值
+    quint32 position;
+    // EDIT 时删掉的字符数
+    quint32 removed;
+    // EDIT 时插入的文字， SELECT 时为 "section/unit"
+    QString text;
+};
+
+// 录制文件:
+//   char magic[4] = "LSS1"
+//   之后每个操作一条记录: 类型 (1 字节), 与上一条的时间差, 参数...
+// 数字都是每字节 7 位的变长整数， 文字是 UTF-8， 前面带长度。
+// 连续输入时每个字符只占几个字节
+class SessionWriter
+{
+public:
+    SessionWriter();
+
+    ~SessionWriter();
+
+    bool open(const QString& path);
+
+    void close();
+
+    bool isOpen() const
+    {
+        return file.isOpen();
+    }
+
+    void write(SessionEvent::Type type, quint32 position = 0,
+               quint32 removed = 0, const QString& text = QString());
+
+private:
+    void flush();
+
+private:
+    QFile file;
+    // 攒一批再写， 提交和切换单元时立即落盘
+    QByteArray buffer;
+    QElapsedTimer clock;
+    quint32 last;
+};
+
+// 读出整个录制文件， 格式不对时返回 false
+bool readSession(const QString& path, std::vector<SessionEvent>* events);
+
+#endif // SESSIONLOG_H
@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <numeric>
+
+#include <QTimer>
+
+#include "MainWindow.h"
+#include "SessionReplayer.h"
+
+namespace
+{
+
+// 最后一次提交最多等这么久
+const int GRADING_TIMEOUT = 30000;
+
+QString operationName(SessionEvent::Type type)
+{
+    switch (type)
+    {
+        case SessionEvent::EDIT:
+            return "edit";
+
+        case SessionEvent::SUBMIT:
+            return "submit";
+
+        case SessionEvent::SELECT:
+            return "select";
+
+        case SessionEvent::SEEK:
+            return "seek";
+    }
+
+    return "unknown";
+}
+
+double percentile(const std::vector<double>& sorted, double p)
+{
+    size_t i = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+
+    return sorted[std::min(i, sorted.size() - 1)];
+}
+
+} //! end anonymous namespace
+
+SessionReplayer::SessionReplayer(MainWindow* window,
+                                 std::vector<SessionEvent> events,
+                                 bool realTime, QObject* parent)
+    : QObject(parent)
+    , window(window)
+    , events(std::move(events))
+    , realTime(realTime)
+    , index(0)
+    , grading(false)
+    , cancelled(0)
+{
+    connect(window, &MainWindow::gradingDone,
+            this, &SessionReplayer::onGradingDone);
+}
+
+void SessionReplayer::start()
+{
+    index = 0;
+    grading = false;
+    cancelled = 0;
+    latencies.clear();
+
+    clock.start();
+
+    QTimer::singleShot(0, this, &SessionReplayer::next);
+}
+
+void SessionReplayer::next()
+{
+    if (index == events.size())
+    {
+        if (grading)
+        {
+            QTimer::singleShot(GRADING_TIMEOUT, this,
+                               &SessionReplayer::finish);
+        }
+        else
+        {
+            finish();
+        }
+
+        return;
+    }
+
+    const SessionEvent& event = events[index++];
+
+    if (event.type == SessionEvent::SUBMIT)
+    {
+        if (grading)
+        {
+            ++cancelled;
+        }
+
+        grading = true;
+        submitClock.start();
+
+        window->replay(event);
+    }
+    else
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        window->replay(event);
+
+        latencies[operationName(event.type)].push_back(
+                    timer.nsecsElapsed() / 1e6);
+    }
+
+    int delay = 0;
+
+    if (realTime && index < events.size())
+    {
+        delay = static_cast<int>(
+                    qMax<qint64>(0, events[index].time - clock.elapsed()));
+    }
+
+    // 即使不按原节奏也回到事件循环， 让评估结果和重绘穿插进来
+    QTimer::singleShot(delay, this, &SessionReplayer::next);
+}
+
+void SessionReplayer::onGradingDone()
+{
+    if (!grading)
+    {
+        return;
+    }
+
+    grading = false;
+
+    latencies["submit"].push_back(submitClock.nsecsElapsed() / 1e6);
+
+    if (index == events.size())
+    {
+        finish();
+    }
+}
+
+void SessionReplayer::finish()
+{
+    // 超时和评估完成可能都会走到这里
+    if (index != events.size() || !clock.isValid())
+    {
+        return;
+    }
+
+    clock.invalidate();
+
+    emit finished();
+}
+
+void SessionReplayer::report(QTextStream& os) const
+{
+    os << QString("%1 %2 %3 %4 %5 %6 %7\n")
+          .arg("operation", -10).arg("count", 7).arg("mean", 9)
+          .arg("p50", 9).arg("p90", 9).arg("p99", 9).arg("max", 9);
+
+    for (const auto& entry : latencies)
+    {
+        std::vector<double> sorted = entry.second;
+
+        std::sort(sorted.begin(), sorted.end());
+
+        double mean = std::accumulate(sorted.begin(), sorted.end(), 0.0)
+                / sorted.size();
+
+        os << QString("%1 %2 %3 %4 %5 %6 %7\n")
+              .arg(entry.first, -10)
+              .arg(static_cast<int>(sorted.size()), 7)
+              .arg(mean, 9, 'f', 2)
+              .arg(percentile(sorted, 0.5), 9, 'f', 2)
+              .arg(percentile(sorted, 0.9), 9, 'f', 2)
+              .arg(percentile(sorted, 0.99), 9, 'f', 2)
+              .arg(sorted.back(), 9, 'f', 2);
+    }
+
+    if (cancelled > 0)
+    {
+        os << cancelled << " submits cancelled by a later one\n";
+    }
+}
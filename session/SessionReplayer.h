@@ -0,0 +1,54 @@
+#ifndef SESSIONREPLAYER_H
+#define SESSIONREPLAYER_H
+
+#include <map>
+#include <vector>
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTextStream>
+
+#include "SessionLog.h"
+
+class MainWindow;
+
+// 把录下的操作按原来的节奏 (或者尽快) 交给主窗口重做，
+// 统计每种操作的延迟。 编辑、 选单元和拖进度条量的是调用本身，
+// 评估量的是从提交到结果显示出来
+class SessionReplayer : public QObject
+{
+    Q_OBJECT
+
+public:
+    SessionReplayer(MainWindow* window, std::vector<SessionEvent> events,
+                    bool realTime, QObject* parent = nullptr);
+
+    void start();
+
+    // 每种操作的次数和延迟分位数， 单位毫秒
+    void report(QTextStream& os) const;
+
+signals:
+    void finished();
+
+private:
+    void next();
+
+    void onGradingDone();
+
+    void finish();
+
+private:
+    MainWindow* window;
+    std::vector<SessionEvent> events;
+    bool realTime;
+    size_t index;
+    QElapsedTimer clock;
+    // 最近一次提交的时刻， 新的提交会取消还没出结果的旧提交
+    QElapsedTimer submitClock;
+    bool grading;
+    int cancelled;
+    std::map<QString, std::vector<double>> latencies;
+};
+
+#endif // SESSIONREPLAYER_H
@@ -0,0 +1,60 @@
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "session/DraftJournal.h"
+
+class DraftJournalTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    // 最后一条记录只写了一半: 重开时丢掉它， 之后的改动要能完整留下来
+    void reopenAfterTornRecord();
+};
+
+void DraftJournalTest::reopenAfterTornRecord()
+{
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+
+    {
+        DraftJournal journal(directory.path());
+
+        QCOMPARE(journal.open("unit"), QString());
+
+        journal.append(0, 0, "hello");
+        journal.append(5, 0, " world");
+        journal.close();
+    }
+
+    QStringList files = QDir(directory.path())
+            .entryList(QStringList("*.journal"), QDir::Files);
+    QCOMPARE(files.size(), 1);
+
+    // 模拟崩溃: 一条 EDIT 声明了 5 字节的文字， 只写进去 3 字节
+    QFile file(directory.filePath(files.front()));
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Append));
+    file.write(QByteArray("\x02\x0B\x00\x05" "abc", 7));
+    file.close();
+
+    {
+        DraftJournal journal(directory.path());
+
+        QCOMPARE(journal.open("unit"), QString("hello world"));
+
+        journal.append(11, 0, "!");
+        journal.close();
+    }
+
+    {
+        DraftJournal journal(directory.path());
+
+        QCOMPARE(journal.open("unit"), QString("hello world!"));
+    }
+}
+
+QTEST_GUILESS_MAIN(DraftJournalTest)
+
+#include "DraftJournalTest.moc"
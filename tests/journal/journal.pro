@@ -0,0 +1,27 @@
+#-------------------------------------------------
+#
+# 草稿日志的测试: 崩溃后重开、 续写、 再重开
+#
+#-------------------------------------------------
+
+QT       += core testlib
+QT       -= gui
+
+CONFIG += c++14 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_journal
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+INCLUDEPATH += ../..
+
+SOURCES += DraftJournalTest.cpp \
+    ../../common/Varint.cpp \
+    ../../session/DraftJournal.cpp
+
+HEADERS  += \
+    ../../common/PoolJob.h \
+    ../../common/Varint.h \
+    ../../session/DraftJournal.h
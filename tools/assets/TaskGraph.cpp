@@ -0,0 +1,204 @@
+#include <thread>
+
+#include "TaskGraph.h"
+
+TaskGraph::TaskGraph()
+    : first { 0, 0 }
+    , count { 0, 0 }
+    , nextTarget { { 0 }, { 0 } }
+    , ready { { 0 }, { 0 } }
+    , remaining(0)
+{
+}
+
+TaskGraph::~TaskGraph()
+{
+}
+
+TaskGraph::Id TaskGraph::add(Kind kind, std::function<void()> work,
+                             const std::vector<Id>& dependencies)
+{
+    Id id = static_cast<Id>(tasks.size());
+
+    std::unique_ptr<Task> task(new Task);
+
+    task->kind = kind;
+    task->work = std::move(work);
+    task->waiting = static_cast<int>(dependencies.size());
+
+    for (Id dependency : dependencies)
+    {
+        tasks[dependency]->successors.push_back(id);
+    }
+
+    tasks.push_back(std::move(task));
+
+    return id;
+}
+
+void TaskGraph::run(int cpuThreads, int ioThreads)
+{
+    count[CPU] = std::max(1, cpuThreads);
+    count[IO] = std::max(1, ioThreads);
+    first[IO] = 0;
+    first[CPU] = count[IO];
+
+    for (int i = 0; i < count[IO] + count[CPU]; ++i)
+    {
+        std::unique_ptr<Worker> worker(new Worker);
+
+        worker->kind = i < count[IO] ? IO : CPU;
+
+        workers.push_back(std::move(worker));
+    }
+
+    remaining = static_cast<int>(tasks.size());
+
+    // 没有依赖的任务一开始就绪， self 为 -1 表示不属于任何组
+    for (Id id = 0; id < static_cast<Id>(tasks.size()); ++id)
+    {
+        if (tasks[id]->waiting == 0)
+        {
+            schedule(id, -1);
+        }
+    }
+
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < static_cast<int>(workers.size()); ++i)
+    {
+        threads.emplace_back([this, i]() { work(i); });
+    }
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+void TaskGraph::work(int self)
+{
+    Kind kind = workers[self]->kind;
+
+    while (true)
+    {
+        Id task = 0;
+
+        if (pop(self, &task) || steal(self, &task))
+        {
+            --ready[kind];
+
+            tasks[task]->work();
+
+            finish(task, self);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(idleMutex);
+
+        idle.wait(lock, [&]
+        {
+            return remaining == 0 || ready[kind] > 0;
+        });
+
+        if (remaining == 0)
+        {
+            return;
+        }
+    }
+}
+
+void TaskGraph::schedule(Id task, int self)
+{
+    Kind kind = tasks[task]->kind;
+
+    int target = self;
+
+    if (self < 0 || workers[self]->kind != kind)
+    {
+        target = first[kind] + nextTarget[kind]++ % count[kind];
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(workers[target]->mutex);
+
+        workers[target]->queue.push_back(task);
+    }
+
+    // 先加计数再通知， 等待的线程不会错过
+    {
+        std::lock_guard<std::mutex> lock(idleMutex);
+
+        ++ready[kind];
+    }
+
+    idle.notify_all();
+}
+
+bool TaskGraph::pop(int self, Id* task)
+{
+    Worker& worker = *workers[self];
+
+    std::lock_guard<std::mutex> lock(worker.mutex);
+
+    if (worker.queue.empty())
+    {
+        return false;
+    }
+
+    *task = worker.queue.back();
+    worker.queue.pop_back();
+
+    return true;
+}
+
+bool TaskGraph::steal(int self, Id* task)
+{
+    Kind kind = workers[self]->kind;
+
+    for (int i = 1; i < count[kind]; ++i)
+    {
+        int victim = first[kind] + (self - first[kind] + i) % count[kind];
+
+        Worker& worker = *workers[victim];
+
+        std::lock_guard<std::mutex> lock(worker.mutex);
+
+        if (!worker.queue.empty())
+        {
+            *task = worker.queue.front();
+            worker.queue.pop_front();
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void TaskGraph::finish(Id task, int self)
+{
+    for (Id successor : tasks[task]->successors)
+    {
+        if (--tasks[successor]->waiting == 0)
+        {
+            schedule(successor, self);
+        }
+    }
+
+    // 释放闭包里捕获的数据
+    tasks[task]->work = nullptr;
+
+    bool last = false;
+
+    {
+        std::lock_guard<std::mutex> lock(idleMutex);
+
+        last = --remaining == 0;
+    }
+
+    if (last)
+    {
+        idle.notify_all();
+    }
+}
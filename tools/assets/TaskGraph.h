@@ -0,0 +1,82 @@
+#ifndef TASKGRAPH_H
+#define TASKGRAPH_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// 带依赖的任务图。 任务分读写磁盘 (IO) 和计算 (CPU) 两类，
+// 各自在一组线程上执行， 读下一个单元和处理上一个单元同时进行。
+//
+// 每个线程有自己的双端队列: 自己从尾部取 (刚就绪的后继往往还在缓存里)，
+// 闲着的线程从同组别人的头部偷。 就绪的任务不是本组线程产生的时候，
+// 轮流放进目标组各线程的队列
+class TaskGraph
+{
+public:
+    enum Kind
+    {
+        IO,
+        CPU
+    };
+
+    using Id = int;
+
+    TaskGraph();
+
+    ~TaskGraph();
+
+    // 依赖必须是已经加入的任务
+    Id add(Kind kind, std::function<void()> work,
+           const std::vector<Id>& dependencies = std::vector<Id>());
+
+    // 执行全部任务， 全部完成后返回。 只能调用一次
+    void run(int cpuThreads, int ioThreads);
+
+private:
+    struct Task
+    {
+        Kind kind;
+        std::function<void()> work;
+        std::vector<Id> successors;
+        std::atomic<int> waiting;
+    };
+
+    struct Worker
+    {
+        Kind kind;
+        std::mutex mutex;
+        std::deque<Id> queue;
+    };
+
+    void work(int self);
+
+    // 把 task 放进 self 的队列， 不是同组时放进目标组的某个线程
+    void schedule(Id task, int self);
+
+    bool pop(int self, Id* task);
+
+    bool steal(int self, Id* task);
+
+    void finish(Id task, int self);
+
+private:
+    std::vector<std::unique_ptr<Task>> tasks;
+    std::vector<std::unique_ptr<Worker>> workers;
+    // 每组的第一个线程和线程数
+    int first[2];
+    int count[2];
+    std::atomic<int> nextTarget[2];
+
+    // 闲着的线程在这里等新任务或者全部结束
+    std::mutex idleMutex;
+    std::condition_variable idle;
+    std::atomic<int> ready[2];
+    std::atomic<int> remaining;
+};
+
+#endif // TASKGRAPH_H
@@ -0,0 +1,50 @@
+#-------------------------------------------------
+#
+# 把 english_data 目录的派生数据预先算好， 写成 Learner 使用的 english_data.assets
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+CONFIG += c++14 console
+CONFIG -= app_bundle
+
+TARGET = assets
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+INCLUDEPATH += ../..
+
+SOURCES += main.cpp \
+    TaskGraph.cpp \
+    ../../Assessor/Alignment.cpp \
+    ../../Assessor/Assessor.cpp \
+    ../../Assessor/ResultCache.cpp \
+    ../../Assessor/Tokenizer.cpp \
+    ../../common/Varint.cpp \
+    ../../player/Mp3Header.cpp \
+    ../../player/Mp3Index.cpp \
+    ../../resource/AssetManifest.cpp \
+    ../../resource/CorpusIndex.cpp \
+    ../../resource/Prefetcher.cpp \
+    ../../resource/ResourcePack.cpp \
+    ../../resource/SearchIndex.cpp
+
+HEADERS  += \
+    TaskGraph.h \
+    ../../Assessor/Alignment.h \
+    ../../Assessor/Assessor.h \
+    ../../Assessor/ResultCache.h \
+    ../../Assessor/Tokenizer.h \
+    ../../Assessor/WordAction.h \
+    ../../common/PoolJob.h \
+    ../../common/Varint.h \
+    ../../player/Mp3Header.h \
+    ../../player/Mp3Index.h \
+    ../../resource/AssetManifest.h \
+    ../../resource/CorpusIndex.h \
+    ../../resource/Prefetcher.h \
+    ../../resource/ResourcePack.h \
+    ../../resource/SearchIndex.h
@@ -0,0 +1,352 @@
+#include <atomic>
+
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegExp>
+#include <QSet>
+#include <QTextStream>
+#include <QThread>
+
+#include "TaskGraph.h"
+#include "player/Mp3Index.h"
+#include "resource/AssetManifest.h"
+#include "resource/CorpusIndex.h"
+#include "resource/Prefetcher.h"
+#include "resource/ResourcePack.h"
+#include "resource/SearchIndex.h"
+
+namespace
+{
+
+// 读写磁盘的线程， 多了只会让磁头来回跑
+const int IO_THREADS = 2;
+
+// 一个单元的输入和派生结果， 各阶段的任务按依赖顺序访问， 不需要加锁
+struct Unit
+{
+    // 音频的完整路径和相对数据目录的名字
+    QString path;
+    QString name;
+    // 上次构建的记录， 没有时为空
+    const AssetManifest::Entry* old;
+    AssetManifest::Entry entry;
+    QByteArray audio;
+    QByteArray answerBytes;
+    // 读过的原文， 留给语料索引用
+    QString answer;
+    bool answerRead;
+    Mp3Index index;
+    bool audioChanged;
+};
+
+QString decode(const QByteArray& bytes)
+{
+    QBuffer buffer;
+    buffer.setData(bytes);
+    buffer.open(QIODevice::ReadOnly | QIODevice::Text);
+
+    // 与 CorpusIndex::readFile 的解码方式一致
+    QTextStream is(&buffer);
+
+    return is.readAll();
+}
+
+QByteArray readAll(const QString& path)
+{
+    QFile file(path);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return QByteArray();
+    }
+
+    return file.readAll();
+}
+
+} //! end anonymous namespace
+
+// 用法: assets <english_data 目录> <english_data.assets 目录>
+// 预先算好每个单元的帧索引、 时长和全库的语料索引， 输入没变的单元直接跳过。
+// 数据目录与程序旁边的 english_data 是同一个时， 语料索引也能直接用
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QStringList arguments = a.arguments();
+
+    if (arguments.size() != 3)
+    {
+        qWarning() << "usage: assets <data directory> <output directory>";
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // 与程序里 applicationDirPath 拼出的路径写法一致
+    QString dataDirectory = QFileInfo(arguments[1]).canonicalFilePath();
+    QString outputDirectory = arguments[2];
+
+    if (dataDirectory.isEmpty() || !QDir().mkpath(outputDirectory + "/seek"))
+    {
+        qWarning() << "cannot use" << arguments[1] << "and" << arguments[2];
+        return 1;
+    }
+
+    AssetManifest manifest;
+
+    // 没有或者版本不对时从头构建
+    manifest.load(outputDirectory, dataDirectory);
+
+    QHash<QString, AssetManifest::Entry> previous = manifest.entries();
+
+    // 与程序里资源树的遍历顺序相同
+    QRegExp pattern("(.+)\\.mp3");
+    std::vector<Unit> units;
+    QStringList paths;
+
+    for (const QFileInfo& sectionDir : QDir(dataDirectory)
+         .entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot))
+    {
+        for (const QFileInfo& file : QDir(sectionDir.absoluteFilePath())
+             .entryInfoList(QDir::Files))
+        {
+            if (pattern.exactMatch(file.fileName()))
+            {
+                Unit unit {};
+
+                unit.path = dataDirectory + '/' + sectionDir.fileName()
+                        + '/' + file.fileName();
+                unit.name = sectionDir.fileName() + '/' + file.fileName();
+
+                auto it = previous.constFind(unit.name);
+
+                unit.old = it == previous.constEnd() ? nullptr : &it.value();
+
+                units.push_back(unit);
+                paths.push_back(unit.path);
+            }
+        }
+    }
+
+    TaskGraph graph;
+    std::vector<TaskGraph::Id> unitTasks;
+
+    std::atomic<int> audioRead(0);
+    std::atomic<int> audioIndexed(0);
+    std::atomic<int> answersRead(0);
+
+    for (Unit& unit : units)
+    {
+        // 修改时间和大小都没变， 而且帧索引还在， 就不读音频
+        TaskGraph::Id readAudio = graph.add(TaskGraph::IO, [&]()
+        {
+            unit.entry.audioStamp = AssetManifest::fileStamp(unit.path);
+
+            if (unit.old != nullptr
+                    && unit.old->audioStamp == unit.entry.audioStamp
+                    && QFile::exists(manifest.seekPath(unit.old->audioHash)))
+            {
+                unit.entry.audioHash = unit.old->audioHash;
+                unit.entry.duration = unit.old->duration;
+                return;
+            }
+
+            unit.audio = readAll(unit.path);
+            ++audioRead;
+        });
+
+        // 只是碰了一下文件时内容哈希不变， 也不用重建
+        TaskGraph::Id indexAudio = graph.add(TaskGraph::CPU, [&]()
+        {
+            if (unit.audio.isEmpty())
+            {
+                return;
+            }
+
+            unit.entry.audioHash = ResourcePack::hash(unit.audio.constData(),
+                                                      unit.audio.size());
+
+            if (unit.old == nullptr
+                    || unit.old->audioHash != unit.entry.audioHash
+                    || !QFile::exists(manifest.seekPath(unit.old->audioHash)))
+            {
+                unit.index = Mp3Index::build(
+                            reinterpret_cast<const uchar*>(
+                                unit.audio.constData()), unit.audio.size());
+                unit.entry.duration = unit.index.duration();
+                unit.audioChanged = true;
+                ++audioIndexed;
+            }
+            else
+            {
+                unit.entry.duration = unit.old->duration;
+            }
+
+            unit.audio.clear();
+        }, { readAudio });
+
+        TaskGraph::Id writeSeek = graph.add(TaskGraph::IO, [&]()
+        {
+            if (!unit.audioChanged || !unit.index.isValid())
+            {
+                return;
+            }
+
+            if (!unit.index.save(manifest.seekPath(unit.entry.audioHash)))
+            {
+                qWarning() << "cannot write seek index of" << unit.name;
+                unit.entry.duration = 0;
+            }
+
+            unit.index = Mp3Index();
+        }, { indexAudio });
+
+        TaskGraph::Id readAnswer = graph.add(TaskGraph::IO, [&]()
+        {
+            QString path = Prefetcher::answerPath(unit.path);
+
+            unit.entry.answerStamp = CorpusIndex::fileStamp(unit.path);
+
+            if (unit.entry.answerStamp == 0
+                    || (unit.old != nullptr
+                        && unit.old->answerStamp == unit.entry.answerStamp))
+            {
+                unit.entry.answerHash = unit.entry.answerStamp == 0
+                        ? 0 : unit.old->answerHash;
+                return;
+            }
+
+            unit.answerBytes = readAll(path);
+            unit.answerRead = true;
+            ++answersRead;
+        });
+
+        TaskGraph::Id decodeAnswer = graph.add(TaskGraph::CPU, [&]()
+        {
+            if (!unit.answerRead)
+            {
+                return;
+            }
+
+            unit.entry.answerHash = ResourcePack::hash(
+                        unit.answerBytes.constData(), unit.answerBytes.size());
+            unit.answer = decode(unit.answerBytes);
+            unit.answerBytes.clear();
+        }, { readAnswer });
+
+        unitTasks.push_back(writeSeek);
+        unitTasks.push_back(decodeAnswer);
+    }
+
+    QHash<QString, int> positions;
+
+    for (int i = 0; i < static_cast<int>(units.size()); ++i)
+    {
+        positions.insert(units[i].path, i);
+    }
+
+    // 没读过的原文在这里补读， 版本戳是内容哈希， 与程序里 answerStamp 一致
+    CorpusIndex::Reader reader = [&](const QString& path)
+    {
+        const Unit& unit = units[positions.value(path)];
+
+        return unit.answerRead ? unit.answer : CorpusIndex::readFile(path);
+    };
+
+    int reparsed = 0;
+    bool searchBuilt = false;
+
+    // CorpusIndex 和 SearchIndex 内部自己并行， 这里各占一个任务
+    TaskGraph::Id corpusTask = graph.add(TaskGraph::CPU, [&]()
+    {
+        CorpusIndex corpus;
+
+        corpus.load(manifest.indexPath());
+
+        reparsed = corpus.update(paths, [&](const QString& path)
+        {
+            return units[positions.value(path)].entry.answerHash;
+        }, reader);
+
+        if (reparsed > 0 || !QFile::exists(manifest.indexPath()))
+        {
+            if (!corpus.save(manifest.indexPath()))
+            {
+                qWarning() << "cannot write corpus index";
+            }
+        }
+    }, unitTasks);
+
+    TaskGraph::Id searchTask = graph.add(TaskGraph::CPU, [&]()
+    {
+        SearchIndex search;
+
+        if (reparsed == 0 && search.open(manifest.searchPath())
+                && search.unitCount() == paths.size())
+        {
+            return;
+        }
+
+        // 写之前先解除映射
+        search.close();
+
+        searchBuilt = SearchIndex::build(paths, reader,
+                                         manifest.searchPath());
+
+        if (!searchBuilt)
+        {
+            qWarning() << "cannot write search index";
+        }
+    }, { corpusTask });
+
+    bool saved = false;
+
+    graph.add(TaskGraph::IO, [&]()
+    {
+        QHash<QString, AssetManifest::Entry> entries;
+        QSet<QString> referenced;
+
+        for (const Unit& unit : units)
+        {
+            entries.insert(unit.name, unit.entry);
+            referenced.insert(QFileInfo(manifest.seekPath(
+                                            unit.entry.audioHash)).fileName());
+        }
+
+        // 删掉的和改过的音频留下的帧索引
+        QDir seek(outputDirectory + "/seek");
+
+        for (const QString& file : seek.entryList(QDir::Files))
+        {
+            if (!referenced.contains(file))
+            {
+                seek.remove(file);
+            }
+        }
+
+        manifest.setEntries(entries);
+
+        saved = manifest.save();
+    }, { searchTask });
+
+    graph.run(QThread::idealThreadCount(), IO_THREADS);
+
+    if (!saved)
+    {
+        qWarning() << "cannot write manifest";
+        return 1;
+    }
+
+    qDebug() << units.size() << "units," << audioRead << "audio files read,"
+             << audioIndexed << "indexed," << answersRead << "answers read,"
+             << reparsed << "reparsed," << (searchBuilt ? 1 : 0)
+             << "search index built in" << timer.elapsed() << "ms";
+
+    return 0;
+}
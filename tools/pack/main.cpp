@@ -0,0 +1,51 @@
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+
+#include "resource/ResourcePack.h"
+
+// 用法: pack <english_data 目录> <english_data.pack>
+// 生成的文件放在 Learner 旁边， 启动时优先于目录使用
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QStringList arguments = a.arguments();
+
+    if (arguments.size() != 3)
+    {
+        qWarning() << "usage: pack <data directory> <output>";
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if (!ResourcePack::build(arguments[1], arguments[2]))
+    {
+        qWarning() << "cannot pack" << arguments[1] << "into" << arguments[2];
+        return 1;
+    }
+
+    ResourcePack pack;
+
+    if (!pack.open(arguments[2]))
+    {
+        qWarning() << "written pack does not load";
+        return 1;
+    }
+
+    for (int unit = 0; unit < pack.unitCount(); ++unit)
+    {
+        if (!pack.verify(unit))
+        {
+            qWarning() << "unit" << pack.unitName(unit) << "is corrupted";
+            return 1;
+        }
+    }
+
+    qDebug() << pack.sectionCount() << "sections," << pack.unitCount()
+             << "units in" << timer.elapsed() << "ms";
+
+    return 0;
+}
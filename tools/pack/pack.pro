@@ -0,0 +1,24 @@
+#-------------------------------------------------
+#
+# 把 english_data 目录打成 Learner 使用的 english_data.pack
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+CONFIG += c++14 console
+CONFIG -= app_bundle
+
+TARGET = pack
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+INCLUDEPATH += ../..
+
+SOURCES += main.cpp \
+    ../../resource/ResourcePack.cpp
+
+HEADERS  += \
+    ../../resource/ResourcePack.h
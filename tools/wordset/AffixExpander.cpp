@@ -0,0 +1,313 @@
+#include <QFile>
+#include <QTextCodec>
+#include <QTextStream>
+
+#include "AffixExpander.h"
+
+namespace
+{
+
+QTextCodec* codecFor(const QByteArray& encoding)
+{
+    if (encoding.toUpper().startsWith("UTF"))
+    {
+        return QTextCodec::codecForName("UTF-8");
+    }
+
+    QTextCodec* codec = QTextCodec::codecForName(encoding);
+
+    return codec ? codec : QTextCodec::codecForName("ISO-8859-1");
+}
+
+} //! end anonymous namespace
+
+bool AffixExpander::CharClass::matches(QChar c) const
+{
+    return any || (characters.contains(c) != negated);
+}
+
+QVector<AffixExpander::CharClass>
+AffixExpander::parseCondition(const QString& condition)
+{
+    QVector<CharClass> result;
+
+    for (int i = 0; i < condition.size(); ++i)
+    {
+        if (condition[i] == '.')
+        {
+            result.push_back(CharClass { QString(), false, true });
+        }
+        else if (condition[i] == '[')
+        {
+            int end = condition.indexOf(']', i);
+
+            if (end == -1)
+            {
+                end = condition.size();
+            }
+
+            QString inside = condition.mid(i + 1, end - i - 1);
+            bool negated = inside.startsWith('^');
+
+            result.push_back(CharClass { negated ? inside.mid(1) : inside,
+                                         negated, false });
+            i = end;
+        }
+        else
+        {
+            result.push_back(CharClass { QString(condition[i]),
+                                         false, false });
+        }
+    }
+
+    return result;
+}
+
+bool AffixExpander::loadAffix(const QString& path)
+{
+    QFile file(path);
+
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        return false;
+    }
+
+    // 先按 Latin-1 读出 SET 行， 再用正确的编码重读
+    QByteArray content = file.readAll();
+
+    for (const QByteArray& line : content.split('\n'))
+    {
+        if (line.startsWith("SET "))
+        {
+            encoding = line.mid(4).trimmed();
+        }
+    }
+
+    QTextStream is(content);
+    is.setCodec(codecFor(encoding));
+
+    // 还需要读多少条规则， 以及它们属于哪个标记
+    int pending = 0;
+    QChar current;
+
+    while (!is.atEnd())
+    {
+        QStringList fields = is.readLine()
+                .split(QRegExp("\\s+"), QString::SkipEmptyParts);
+
+        if (fields.isEmpty() || fields[0].startsWith('#'))
+        {
+            continue;
+        }
+
+        const QString& keyword = fields[0];
+
+        if (keyword == "NEEDAFFIX" && fields.size() > 1)
+        {
+            needAffix = fields[1].at(0);
+        }
+        else if (keyword == "ONLYINCOMPOUND" && fields.size() > 1)
+        {
+            onlyInCompound = fields[1].at(0);
+        }
+        else if (keyword == "FORBIDDENWORD" && fields.size() > 1)
+        {
+            forbidden = fields[1].at(0);
+        }
+        else if ((keyword == "PFX" || keyword == "SFX") && fields.size() >= 4)
+        {
+            QChar flag = fields[1].at(0);
+
+            if (pending == 0 || flag != current)
+            {
+                // 组的头一行: PFX A Y 1
+                Group& group = groups[flag];
+
+                group.prefix = keyword == "PFX";
+                group.cross = fields[2] == "Y";
+
+                current = flag;
+                pending = fields[3].toInt();
+            }
+            else if (fields.size() >= 5)
+            {
+                // 规则行: SFX N e ion e
+                QString stripped = fields[2] == "0" ? QString() : fields[2];
+                QString affix = fields[3].section('/', 0, 0);
+
+                if (affix == "0")
+                {
+                    affix.clear();
+                }
+
+                groups[flag].rules.push_back(
+                            Rule { stripped.size(), stripped, affix,
+                                   parseCondition(fields[4]) });
+                --pending;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool AffixExpander::applies(const Group& group, const Rule& rule,
+                            const QString& stem)
+{
+    int n = rule.condition.size();
+
+    if (stem.size() < n || stem.size() <= rule.strip)
+    {
+        return false;
+    }
+
+    if (group.prefix)
+    {
+        if (!stem.startsWith(rule.stripped))
+        {
+            return false;
+        }
+
+        for (int i = 0; i < n; ++i)
+        {
+            if (!rule.condition[i].matches(stem[i]))
+            {
+                return false;
+            }
+        }
+    }
+    else
+    {
+        if (!stem.endsWith(rule.stripped))
+        {
+            return false;
+        }
+
+        int offset = stem.size() - n;
+
+        for (int i = 0; i < n; ++i)
+        {
+            if (!rule.condition[i].matches(stem[offset + i]))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+QString AffixExpander::apply(const Group& group, const Rule& rule,
+                             const QString& stem)
+{
+    if (group.prefix)
+    {
+        return rule.affix + stem.mid(rule.strip);
+    }
+    else
+    {
+        return stem.left(stem.size() - rule.strip) + rule.affix;
+    }
+}
+
+QStringList AffixExpander::expand(const QString& dictionaryPath) const
+{
+    QStringList forms;
+
+    QFile file(dictionaryPath);
+
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        return forms;
+    }
+
+    QTextStream is(&file);
+    is.setCodec(codecFor(encoding));
+
+    // 第一行是词数
+    is.readLine();
+
+    while (!is.atEnd())
+    {
+        QString entry = is.readLine().section(QRegExp("\\s"), 0, 0);
+
+        if (entry.isEmpty())
+        {
+            continue;
+        }
+
+        int slash = entry.indexOf('/');
+
+        QString stem = slash == -1 ? entry : entry.left(slash);
+        QString flags = slash == -1 ? QString() : entry.mid(slash + 1);
+
+        if ((!forbidden.isNull() && flags.contains(forbidden))
+                || (!onlyInCompound.isNull() && flags.contains(onlyInCompound)))
+        {
+            continue;
+        }
+
+        if (needAffix.isNull() || !flags.contains(needAffix))
+        {
+            forms.push_back(stem);
+        }
+
+        // 可以再加前缀的后缀形式
+        QStringList crossable;
+
+        for (QChar flag : flags)
+        {
+            auto iter = groups.find(flag);
+
+            if (iter == groups.end() || iter->prefix)
+            {
+                continue;
+            }
+
+            for (const Rule& rule : iter->rules)
+            {
+                if (applies(*iter, rule, stem))
+                {
+                    QString form = apply(*iter, rule, stem);
+
+                    forms.push_back(form);
+
+                    if (iter->cross)
+                    {
+                        crossable.push_back(form);
+                    }
+                }
+            }
+        }
+
+        for (QChar flag : flags)
+        {
+            auto iter = groups.find(flag);
+
+            if (iter == groups.end() || !iter->prefix)
+            {
+                continue;
+            }
+
+            for (const Rule& rule : iter->rules)
+            {
+                if (!applies(*iter, rule, stem))
+                {
+                    continue;
+                }
+
+                forms.push_back(apply(*iter, rule, stem));
+
+                if (iter->cross)
+                {
+                    for (const QString& form : crossable)
+                    {
+                        forms.push_back(apply(*iter, rule, form));
+                    }
+                }
+            }
+        }
+    }
+
+    return forms;
+}
@@ -0,0 +1,63 @@
+#ifndef AFFIXEXPANDER_H
+#define AFFIXEXPANDER_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// 按 hunspell 的 .aff 规则把 .dic 中的词干展开成所有词形。
+// 只支持 en_US 用到的部分: 单字符标记、 PFX/SFX、 交叉组合，
+// 以及 NEEDAFFIX / ONLYINCOMPOUND / FORBIDDENWORD。 后缀上的续接标记会被忽略，
+// 漏掉的词形由运行时的 hunspell 兜底
+class AffixExpander
+{
+public:
+    bool loadAffix(const QString& path);
+
+    // 返回展开后的全部词形 (可能有重复)
+    QStringList expand(const QString& dictionaryPath) const;
+
+private:
+    // 条件中的一个位置: '.'、 单个字符、 [abc] 或 [^abc]
+    struct CharClass
+    {
+        QString characters;
+        bool negated;
+        bool any;
+
+        bool matches(QChar c) const;
+    };
+
+    struct Rule
+    {
+        int strip;
+        QString stripped;
+        QString affix;
+        QVector<CharClass> condition;
+    };
+
+    struct Group
+    {
+        bool prefix;
+        bool cross;
+        QVector<Rule> rules;
+    };
+
+    static QVector<CharClass> parseCondition(const QString& condition);
+
+    static bool applies(const Group& group, const Rule& rule,
+                        const QString& stem);
+
+    static QString apply(const Group& group, const Rule& rule,
+                         const QString& stem);
+
+private:
+    QByteArray encoding;
+    QHash<QChar, Group> groups;
+    QChar needAffix;
+    QChar onlyInCompound;
+    QChar forbidden;
+};
+
+#endif // AFFIXEXPANDER_H
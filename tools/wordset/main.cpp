@@ -0,0 +1,71 @@
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+
+#include "AffixExpander.h"
+#include "SuggestionIndex.h"
+#include "WordSet.h"
+
+// 用法: wordset en_US.aff en_US.dic en_US
+// 生成 en_US.words 和 en_US.suggest， 和 .aff/.dic 放在一起，
+// SpellChecker 启动时直接映射
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QStringList arguments = a.arguments();
+
+    if (arguments.size() != 4)
+    {
+        qWarning() << "usage: wordset <aff> <dic> <output base>";
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    AffixExpander expander;
+
+    if (!expander.loadAffix(arguments[1]))
+    {
+        qWarning() << "cannot read" << arguments[1];
+        return 1;
+    }
+
+    QStringList forms = expander.expand(arguments[2]);
+
+    if (forms.isEmpty())
+    {
+        qWarning() << "no words expanded from" << arguments[2];
+        return 1;
+    }
+
+    QString wordsPath = arguments[3] + ".words";
+    QString suggestPath = arguments[3] + ".suggest";
+
+    if (!WordSet::build(forms, wordsPath))
+    {
+        qWarning() << "cannot write" << wordsPath;
+        return 1;
+    }
+
+    WordSet check;
+
+    if (!check.open(wordsPath))
+    {
+        qWarning() << "written set does not load";
+        return 1;
+    }
+
+    qDebug() << check.size() << "word forms in" << timer.elapsed() << "ms";
+
+    if (!SuggestionIndex::build(forms, suggestPath))
+    {
+        qWarning() << "cannot write" << suggestPath;
+        return 1;
+    }
+
+    qDebug() << "suggestion index in" << timer.elapsed() << "ms";
+
+    return 0;
+}
@@ -0,0 +1,28 @@
+#-------------------------------------------------
+#
+# 把 en_US.aff/.dic 展开成 SpellChecker 使用的 en_US.words 和 en_US.suggest
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+CONFIG += c++14 console
+CONFIG -= app_bundle
+
+TARGET = wordset
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+INCLUDEPATH += ../..
+
+SOURCES += main.cpp \
+    AffixExpander.cpp \
+    ../../SuggestionIndex.cpp \
+    ../../WordSet.cpp
+
+HEADERS  += \
+    AffixExpander.h \
+    ../../SuggestionIndex.h \
+    ../../WordSet.h